@@ -0,0 +1,27 @@
+#include "Arena.hpp"
+
+#include <cstdlib>
+#include <new>
+
+char* Arena::new_chunk(size_t bytes){
+	// oversized requests get a chunk of their own, so the current chunk keeps its free space
+	if(bytes>chunk_size/4){
+		char* big = static_cast<char*>(std::malloc(bytes));
+		if(big==nullptr)
+			throw std::bad_alloc();
+		chunks.push_back(big);
+		return big;
+	}
+	char* chunk = static_cast<char*>(std::malloc(chunk_size));
+	if(chunk==nullptr)
+		throw std::bad_alloc();
+	chunks.push_back(chunk);
+	cursor = chunk+bytes;
+	limit = chunk+chunk_size;
+	return chunk;
+}
+
+Arena::~Arena(){
+	for(char* chunk : chunks)
+		std::free(chunk);
+}
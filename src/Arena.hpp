@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Bump allocator for short lived expressions. While an Arena::Scope is active on a thread, every
+// CompactVector that thread allocates (ie, every Expr it builds) takes its memory from the arena.
+// Freeing arena memory is a no-op; the whole region goes back to the heap when the Arena is
+// destroyed. Exprs built in a scope must be destroyed before their arena, and anything that has to
+// outlive it must be copied out with promote (see Expr.hpp).
+class Arena{
+	std::vector<char*> chunks;
+	char* cursor = nullptr;
+	char* limit = nullptr;
+	size_t chunk_size;
+	size_t used = 0;
+
+	inline static thread_local Arena* _current = nullptr;
+
+	char* new_chunk(size_t bytes);
+
+public:
+	static constexpr size_t default_chunk_size = 64*1024;
+
+	Arena(size_t chunk_size=default_chunk_size):chunk_size(chunk_size){}
+	Arena(const Arena&)=delete;
+	Arena& operator=(const Arena&)=delete;
+	~Arena();
+
+	void* allocate(size_t bytes){
+		bytes = (bytes+alignof(std::max_align_t)-1) & ~(alignof(std::max_align_t)-1);
+		used += bytes;
+		if(static_cast<size_t>(limit-cursor)<bytes)
+			return new_chunk(bytes);
+		char* ret = cursor;
+		cursor += bytes;
+		return ret;
+	}
+
+	// bytes handed out so far, and the number of heap allocations backing them
+	size_t bytes_used() const { return used; }
+	size_t chunk_count() const { return chunks.size(); }
+
+	// the arena new expressions on this thread are built in; nullptr for the heap
+	static Arena* current() { return _current; }
+
+	// makes an arena current for the lifetime of the scope (nullptr to build on the heap)
+	struct Scope{
+		Arena* previous;
+		Scope(Arena* arena):previous(_current){ _current = arena; }
+		Scope(Arena& arena):Scope(&arena){}
+		Scope(const Scope&)=delete;
+		~Scope(){ _current = previous; }
+	};
+};
@@ -0,0 +1,540 @@
+#include "BigInt.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+typedef BigInt::limb_t limb_t;
+typedef BigInt::wide_t wide_t;
+
+// magnitude helpers on raw limb spans; outputs may alias the first operand exactly
+
+// out = a+b, with an>=bn; out has an limbs; returns the carry
+static limb_t add_mag(const limb_t* a, size_t an, const limb_t* b, size_t bn, limb_t* out){
+	wide_t carry = 0;
+	for(size_t i=0;i<an;i++){
+		wide_t t = wide_t(a[i])+(i<bn ? b[i] : 0)+carry;
+		out[i] = limb_t(t);
+		carry = t>>32;
+	}
+	return limb_t(carry);
+}
+
+// out = a-b, with a>=b (so an>=bn); out has an limbs. out may also alias b exactly
+static void sub_mag(const limb_t* a, size_t an, const limb_t* b, size_t bn, limb_t* out){
+	limb_t borrow = 0;
+	for(size_t i=0;i<an;i++){
+		wide_t sub = wide_t(i<bn ? b[i] : 0)+borrow;
+		borrow = wide_t(a[i])<sub;
+		out[i] = limb_t(wide_t(a[i])-sub);
+	}
+}
+
+// out[offset..outn) += src; anything carried past outn is dropped (callers know it is zero)
+static void add_at(limb_t* out, size_t outn, size_t offset, const limb_t* src, size_t srcn){
+	wide_t carry = 0;
+	size_t i = offset;
+	for(size_t k=0;k<srcn && i<outn;k++,i++){
+		wide_t t = wide_t(out[i])+src[k]+carry;
+		out[i] = limb_t(t);
+		carry = t>>32;
+	}
+	for(;carry && i<outn;i++){
+		wide_t t = wide_t(out[i])+carry;
+		out[i] = limb_t(t);
+		carry = t>>32;
+	}
+}
+
+// t -= s, where the result is known to be non-negative
+static void sub_in_place(limb_t* t, size_t tn, const limb_t* s, size_t sn){
+	limb_t borrow = 0;
+	for(size_t i=0;i<tn;i++){
+		wide_t sub = wide_t(i<sn ? s[i] : 0)+borrow;
+		if(sub==0 && i>=sn)
+			break;
+		borrow = wide_t(t[i])<sub;
+		t[i] = limb_t(wide_t(t[i])-sub);
+	}
+}
+
+static void schoolbook_mul(const limb_t* a, size_t an, const limb_t* b, size_t bn, limb_t* out){
+	std::fill(out,out+an+bn,0);
+	for(size_t i=0;i<an;i++){
+		wide_t carry = 0;
+		for(size_t j=0;j<bn;j++){
+			wide_t t = wide_t(a[i])*b[j]+out[i+j]+carry;
+			out[i+j] = limb_t(t);
+			carry = t>>32;
+		}
+		out[i+bn] = limb_t(carry);
+	}
+}
+
+// out = a*b; out has an+bn limbs and must not alias either operand
+static void mul_mag(const limb_t* a, size_t an, const limb_t* b, size_t bn, limb_t* out){
+	if(an<bn){
+		std::swap(a,b);
+		std::swap(an,bn);
+	}
+	if(bn<BigInt::KARATSUBA_THRESHOLD){
+		schoolbook_mul(a,an,b,bn,out);
+		return;
+	}
+	size_t m = an/2;
+	if(bn<=m){
+		// too lopsided to split both; a = a1*B^m + a0, so a*b = a0*b + (a1*b)*B^m
+		mul_mag(a,m,b,bn,out);
+		std::fill(out+m+bn,out+an+bn,0);
+		std::vector<limb_t> high(an-m+bn);
+		mul_mag(a+m,an-m,b,bn,high.data());
+		add_at(out,an+bn,m,high.data(),high.size());
+		return;
+	}
+	// a = a1*B^m + a0, b = b1*B^m + b0
+	// a*b = z2*B^2m + z1*B^m + z0, with z1 = (a0+a1)*(b0+b1) - z0 - z2
+	const limb_t* a0 = a;
+	const limb_t* a1 = a+m;
+	const limb_t* b0 = b;
+	const limb_t* b1 = b+m;
+	size_t a1n = an-m;
+	size_t b1n = bn-m;
+	mul_mag(a0,m,b0,m,out);
+	mul_mag(a1,a1n,b1,b1n,out+2*m);
+
+	std::vector<limb_t> sa(std::max(m,a1n)+1);
+	std::vector<limb_t> sb(std::max(m,b1n)+1);
+	if(a1n>=m)
+		sa.back() = add_mag(a1,a1n,a0,m,sa.data());
+	else
+		sa.back() = add_mag(a0,m,a1,a1n,sa.data());
+	if(b1n>=m)
+		sb.back() = add_mag(b1,b1n,b0,m,sb.data());
+	else
+		sb.back() = add_mag(b0,m,b1,b1n,sb.data());
+
+	std::vector<limb_t> z1(sa.size()+sb.size());
+	mul_mag(sa.data(),sa.size(),sb.data(),sb.size(),z1.data());
+	sub_in_place(z1.data(),z1.size(),out,2*m);
+	sub_in_place(z1.data(),z1.size(),out+2*m,a1n+b1n);
+	add_at(out,an+bn,m,z1.data(),z1.size());
+}
+
+// divides in place by a single limb; returns the remainder
+static limb_t div_small(limb_t* a, size_t an, limb_t divisor){
+	wide_t rem = 0;
+	for(size_t i=an;i-->0;){
+		wide_t cur = (rem<<32)|a[i];
+		a[i] = limb_t(cur/divisor);
+		rem = cur%divisor;
+	}
+	return limb_t(rem);
+}
+
+// a = a*factor + addend; a has room for one more limb at a[an], which receives the carry
+static void mul_small_add(limb_t* a, size_t an, limb_t factor, limb_t addend){
+	wide_t carry = addend;
+	for(size_t i=0;i<an;i++){
+		wide_t t = wide_t(a[i])*factor+carry;
+		a[i] = limb_t(t);
+		carry = t>>32;
+	}
+	a[an] = limb_t(carry);
+}
+
+void BigInt::reserve(uint32_t n){
+	if(n<=_capacity)
+		return;
+	limb_t* fresh = new limb_t[n];
+	std::copy(data(),data()+_size,fresh);
+	if(_capacity>INLINE_LIMBS)
+		delete[] _heap;
+	_heap = fresh;
+	_capacity = n;
+}
+
+void BigInt::resize(uint32_t n){
+	reserve(n);
+	if(n>_size)
+		std::fill(data()+_size,data()+n,0);
+	_size = n;
+}
+
+void BigInt::trim(){
+	const limb_t* d = data();
+	while(_size>0 && d[_size-1]==0)
+		_size--;
+	if(_size==0)
+		_negative = false;
+}
+
+BigInt::BigInt(int64_t v){
+	uint64_t mag = v<0 ? 0-uint64_t(v) : uint64_t(v);
+	_negative = v<0;
+	_inline[0] = limb_t(mag);
+	_inline[1] = limb_t(mag>>32);
+	_size = 2;
+	trim();
+}
+
+BigInt::BigInt(const string& decimal){
+	size_t start = 0;
+	bool negative = false;
+	if(!decimal.empty() && decimal[0]=='-'){
+		negative = true;
+		start = 1;
+	}
+	if(start==decimal.size())
+		throw std::invalid_argument("BigInt: no digits in '"+decimal+"'");
+	// 9 digits at a time, each step multiplies by 10^digits
+	reserve(uint32_t((decimal.size()-start)/9+2));
+	for(size_t pos=start;pos<decimal.size();){
+		size_t len = std::min<size_t>(9,decimal.size()-pos);
+		limb_t chunk = 0;
+		limb_t scale = 1;
+		for(size_t k=0;k<len;k++){
+			char c = decimal[pos+k];
+			if(c<'0' || c>'9')
+				throw std::invalid_argument("BigInt: invalid digit in '"+decimal+"'");
+			chunk = chunk*10+limb_t(c-'0');
+			scale *= 10;
+		}
+		mul_small_add(data(),_size,scale,chunk);
+		_size++;
+		trim();
+		pos += len;
+	}
+	_negative = negative && _size>0;
+}
+
+BigInt::BigInt(const BigInt& b){
+	reserve(b._size);
+	std::copy(b.data(),b.data()+b._size,data());
+	_size = b._size;
+	_negative = b._negative;
+}
+
+BigInt::BigInt(BigInt&& b) noexcept{
+	*this = std::move(b);
+}
+
+BigInt& BigInt::operator=(const BigInt& b){
+	if(this==&b)
+		return *this;
+	_size = 0;
+	reserve(b._size);
+	std::copy(b.data(),b.data()+b._size,data());
+	_size = b._size;
+	_negative = b._negative;
+	return *this;
+}
+
+BigInt& BigInt::operator=(BigInt&& b) noexcept{
+	if(this==&b)
+		return *this;
+	if(_capacity>INLINE_LIMBS)
+		delete[] _heap;
+	if(b._capacity>INLINE_LIMBS){
+		_heap = b._heap;
+		_capacity = b._capacity;
+	}
+	else{
+		std::copy(b._inline,b._inline+b._size,_inline);
+		_capacity = INLINE_LIMBS;
+	}
+	_size = b._size;
+	_negative = b._negative;
+	b._capacity = INLINE_LIMBS;
+	b._size = 0;
+	b._negative = false;
+	return *this;
+}
+
+BigInt::~BigInt(){
+	if(_capacity>INLINE_LIMBS)
+		delete[] _heap;
+}
+
+size_t BigInt::bit_length() const {
+	if(_size==0)
+		return 0;
+	return size_t(_size-1)*32+(32-std::countl_zero(data()[_size-1]));
+}
+
+bool BigInt::fits_int64() const {
+	if(_size>2)
+		return false;
+	uint64_t mag = 0;
+	for(size_t i=0;i<_size;i++)
+		mag |= uint64_t(data()[i])<<(32*i);
+	return _negative ? mag<=uint64_t(1)<<63 : mag<uint64_t(1)<<63;
+}
+
+int64_t BigInt::to_int64() const {
+	uint64_t mag = 0;
+	for(size_t i=0;i<_size;i++)
+		mag |= uint64_t(data()[i])<<(32*i);
+	return _negative ? int64_t(0-mag) : int64_t(mag);
+}
+
+double BigInt::to_double() const {
+	// the top 64 significant bits, scaled; everything below is beyond a double's precision anyway
+	size_t bits = bit_length();
+	if(bits==0)
+		return 0;
+	size_t shift = bits>64 ? bits-64 : 0;
+	uint64_t top = 0;
+	for(size_t bit=shift;bit<bits;bit+=32){
+		size_t limb = bit/32;
+		size_t off = bit%32;
+		uint64_t piece = data()[limb]>>off;
+		if(off>0 && limb+1<_size)
+			piece |= uint64_t(data()[limb+1])<<(32-off);
+		top |= (piece & 0xFFFFFFFFull)<<(bit-shift);
+	}
+	double mag = std::ldexp(double(top),int(shift));
+	return _negative ? -mag : mag;
+}
+
+string BigInt::to_string() const {
+	if(_size==0)
+		return "0";
+	std::vector<limb_t> mag(data(),data()+_size);
+	size_t n = mag.size();
+	std::vector<limb_t> chunks;
+	while(n>0){
+		chunks.push_back(div_small(mag.data(),n,1000000000));
+		while(n>0 && mag[n-1]==0)
+			n--;
+	}
+	string ret = _negative ? "-" : "";
+	ret += std::to_string(chunks.back());
+	for(size_t i=chunks.size()-1;i-->0;){
+		string digits = std::to_string(chunks[i]);
+		ret += string(9-digits.size(),'0')+digits;
+	}
+	return ret;
+}
+
+size_t BigInt::hash() const {
+	uint64_t h = 14695981039346656037ULL^_negative;
+	for(size_t i=0;i<_size;i++){
+		h ^= data()[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+BigInt BigInt::operator-() const {
+	BigInt ret = *this;
+	ret._negative = !_negative && _size>0;
+	return ret;
+}
+
+int BigInt::compare_magnitude(const BigInt& a, const BigInt& b){
+	if(a._size!=b._size)
+		return a._size<b._size ? -1 : 1;
+	for(size_t i=a._size;i-->0;){
+		if(a.data()[i]!=b.data()[i])
+			return a.data()[i]<b.data()[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+void BigInt::add_signed(const BigInt& b, bool b_negative){
+	if(b._size==0)
+		return;
+	if(this==&b){
+		BigInt copy = b;
+		add_signed(copy,b_negative);
+		return;
+	}
+	if(_negative==b_negative || _size==0){
+		uint32_t n = std::max(_size,b._size);
+		resize(n+1);
+		data()[n] = add_mag(data(),n,b.data(),b._size,data());
+		_negative = b_negative;
+		trim();
+		return;
+	}
+	int cmp = compare_magnitude(*this,b);
+	if(cmp==0){
+		_size = 0;
+		_negative = false;
+	}
+	else if(cmp>0){
+		sub_mag(data(),_size,b.data(),b._size,data());
+		trim();
+	}
+	else{
+		uint32_t n = _size;
+		resize(b._size);
+		sub_mag(b.data(),b._size,data(),n,data());
+		_negative = b_negative;
+		trim();
+	}
+}
+
+BigInt& BigInt::operator+=(const BigInt& b){
+	add_signed(b,b._negative);
+	return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& b){
+	add_signed(b,!b._negative);
+	return *this;
+}
+
+BigInt& BigInt::operator*=(const BigInt& b){
+	return *this = *this*b;
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b){
+	BigInt ret;
+	if(a._size==0 || b._size==0)
+		return ret;
+	ret.resize(a._size+b._size);
+	mul_mag(a.data(),a._size,b.data(),b._size,ret.data());
+	ret._negative = a._negative!=b._negative;
+	ret.trim();
+	return ret;
+}
+
+void BigInt::divmod(const BigInt& dividend, const BigInt& divisor, BigInt& quotient, BigInt& remainder){
+	if(divisor._size==0)
+		throw std::domain_error("BigInt: division by zero");
+	bool q_negative = dividend._negative!=divisor._negative;
+	bool r_negative = dividend._negative;
+	if(compare_magnitude(dividend,divisor)<0){
+		remainder = dividend;
+		quotient = BigInt();
+		return;
+	}
+
+	const size_t m = dividend._size;
+	const size_t n = divisor._size;
+	BigInt q;
+	q.resize(uint32_t(m-n+1));
+	if(n==1){
+		BigInt r = dividend;
+		limb_t rem = div_small(r.data(),m,divisor.data()[0]);
+		r._size = uint32_t(m);
+		q = std::move(r);
+		remainder = BigInt(int64_t(rem));
+	}
+	else{
+		// Knuth's algorithm D: normalize so the divisor's top bit is set, then produce one quotient limb per step
+		const wide_t base = wide_t(1)<<32;
+		int s = std::countl_zero(divisor.data()[n-1]);
+		std::vector<limb_t> vn(n);
+		std::vector<limb_t> un(m+1);
+		const limb_t* v = divisor.data();
+		const limb_t* u = dividend.data();
+		for(size_t i=n-1;i>0;i--)
+			vn[i] = (v[i]<<s)|(s ? limb_t(wide_t(v[i-1])>>(32-s)) : 0);
+		vn[0] = v[0]<<s;
+		un[m] = s ? limb_t(wide_t(u[m-1])>>(32-s)) : 0;
+		for(size_t i=m-1;i>0;i--)
+			un[i] = (u[i]<<s)|(s ? limb_t(wide_t(u[i-1])>>(32-s)) : 0);
+		un[0] = u[0]<<s;
+
+		limb_t* qd = q.data();
+		for(size_t j=m-n+1;j-->0;){
+			wide_t num = (wide_t(un[j+n])<<32)|un[j+n-1];
+			wide_t qhat = num/vn[n-1];
+			wide_t rhat = num%vn[n-1];
+			while(qhat>=base || qhat*vn[n-2]>((rhat<<32)|un[j+n-2])){
+				qhat--;
+				rhat += vn[n-1];
+				if(rhat>=base)
+					break;
+			}
+			// un[j..j+n] -= qhat*vn
+			int64_t k = 0;
+			int64_t t;
+			for(size_t i=0;i<n;i++){
+				wide_t p = qhat*vn[i];
+				t = int64_t(un[i+j])-k-int64_t(p&0xFFFFFFFF);
+				un[i+j] = limb_t(t);
+				k = int64_t(p>>32)-(t>>32);
+			}
+			t = int64_t(un[j+n])-k;
+			un[j+n] = limb_t(t);
+			qd[j] = limb_t(qhat);
+			if(t<0){
+				// qhat was one too large; add one divisor back
+				qd[j]--;
+				wide_t carry = 0;
+				for(size_t i=0;i<n;i++){
+					wide_t sum = wide_t(un[i+j])+vn[i]+carry;
+					un[i+j] = limb_t(sum);
+					carry = sum>>32;
+				}
+				un[j+n] = limb_t(un[j+n]+carry);
+			}
+		}
+
+		BigInt r;
+		r.resize(uint32_t(n));
+		limb_t* rd = r.data();
+		for(size_t i=0;i<n;i++)
+			rd[i] = (un[i]>>s)|(s ? limb_t(wide_t(un[i+1])<<(32-s)) : 0);
+		remainder = std::move(r);
+	}
+	q.trim();
+	remainder.trim();
+	q._negative = q_negative && q._size>0;
+	remainder._negative = r_negative && remainder._size>0;
+	quotient = std::move(q);
+}
+
+BigInt operator/(const BigInt& a, const BigInt& b){
+	BigInt q,r;
+	BigInt::divmod(a,b,q,r);
+	return q;
+}
+
+BigInt operator%(const BigInt& a, const BigInt& b){
+	BigInt q,r;
+	BigInt::divmod(a,b,q,r);
+	return r;
+}
+
+BigInt BigInt::pow(BigInt base, uint64_t exponent){
+	BigInt ret = 1;
+	while(exponent){
+		if(exponent&1)
+			ret = ret*base;
+		exponent >>= 1;
+		if(exponent)
+			base = base*base;
+	}
+	return ret;
+}
+
+BigInt BigInt::gcd(BigInt a, BigInt b){
+	a._negative = false;
+	b._negative = false;
+	while(!b.is_zero()){
+		BigInt q,r;
+		divmod(a,b,q,r);
+		a = std::move(b);
+		b = std::move(r);
+	}
+	return a;
+}
+
+bool operator==(const BigInt& a, const BigInt& b){
+	return a._negative==b._negative && BigInt::compare_magnitude(a,b)==0;
+}
+
+std::strong_ordering operator<=>(const BigInt& a, const BigInt& b){
+	if(a._negative!=b._negative)
+		return a._negative ? std::strong_ordering::less : std::strong_ordering::greater;
+	int cmp = BigInt::compare_magnitude(a,b);
+	if(a._negative)
+		cmp = -cmp;
+	return cmp<0 ? std::strong_ordering::less : cmp>0 ? std::strong_ordering::greater : std::strong_ordering::equal;
+}
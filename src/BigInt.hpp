@@ -0,0 +1,89 @@
+#pragma once
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using std::string;
+
+// Arbitrary precision integer, stored as a sign and a magnitude in base 2^32 limbs (least significant
+// first). Values of up to INLINE_LIMBS limbs live inside the object; larger ones are on the heap.
+// Division truncates toward zero and the remainder takes the sign of the dividend, like int64_t.
+class BigInt{
+public:
+	typedef uint32_t limb_t;
+	typedef uint64_t wide_t;
+	static constexpr uint32_t INLINE_LIMBS = 4;
+	// operands with fewer limbs than this are multiplied by schoolbook
+	static constexpr size_t KARATSUBA_THRESHOLD = 32;
+
+private:
+	// limbs in use, without leading zero limbs; 0 for the value 0
+	uint32_t _size = 0;
+	uint32_t _capacity = INLINE_LIMBS;
+	// never set for 0
+	bool _negative = false;
+	union{
+		limb_t _inline[INLINE_LIMBS];
+		limb_t* _heap;
+	};
+
+	limb_t* data() { return _capacity>INLINE_LIMBS ? _heap : _inline; }
+	const limb_t* data() const { return _capacity>INLINE_LIMBS ? _heap : _inline; }
+	void reserve(uint32_t n);
+	// new limbs are zero
+	void resize(uint32_t n);
+	void trim();
+	void add_signed(const BigInt& b, bool b_negative);
+	static int compare_magnitude(const BigInt& a, const BigInt& b);
+
+public:
+	BigInt(){}
+	BigInt(int64_t v);
+	// decimal digits with an optional leading '-'; throws std::invalid_argument
+	explicit BigInt(const string& decimal);
+	BigInt(const BigInt& b);
+	BigInt(BigInt&& b) noexcept;
+	BigInt& operator=(const BigInt& b);
+	BigInt& operator=(BigInt&& b) noexcept;
+	~BigInt();
+
+	bool is_zero() const { return _size==0; }
+	bool is_negative() const { return _negative; }
+	bool is_odd() const { return _size>0 && (data()[0]&1); }
+	size_t limb_count() const { return _size; }
+	size_t bit_length() const;
+
+	bool fits_int64() const;
+	// only valid if fits_int64()
+	int64_t to_int64() const;
+	// nearest double, or +-inf if out of range
+	double to_double() const;
+	string to_string() const;
+	size_t hash() const;
+
+	BigInt operator-() const;
+	BigInt& operator+=(const BigInt& b);
+	BigInt& operator-=(const BigInt& b);
+	BigInt& operator*=(const BigInt& b);
+	friend BigInt operator+(BigInt a, const BigInt& b){ return a+=b; }
+	friend BigInt operator-(BigInt a, const BigInt& b){ return a-=b; }
+	friend BigInt operator*(const BigInt& a, const BigInt& b);
+	friend BigInt operator/(const BigInt& a, const BigInt& b);
+	friend BigInt operator%(const BigInt& a, const BigInt& b);
+
+	// throws std::domain_error if divisor is 0
+	static void divmod(const BigInt& dividend, const BigInt& divisor, BigInt& quotient, BigInt& remainder);
+	static BigInt pow(BigInt base, uint64_t exponent);
+	// always non-negative; gcd(0,0) is 0
+	static BigInt gcd(BigInt a, BigInt b);
+
+	friend bool operator==(const BigInt& a, const BigInt& b);
+	friend std::strong_ordering operator<=>(const BigInt& a, const BigInt& b);
+};
+
+inline string to_string(const BigInt& v){ return v.to_string(); }
+
+template<>
+struct std::hash<BigInt>{
+	size_t operator()(const BigInt& v) const { return v.hash(); }
+};
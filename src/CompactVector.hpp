@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+#include "Arena.hpp"
+#include "Profiler.hpp"
+
+// Contiguous growable array with a 16 byte footprint (pointer + 32-bit size and capacity) and
+// noexcept moves. Nothing is allocated while it is empty, and reserve allocates exactly what it
+// is asked for, so a node of fixed arity costs one allocation sized to its children.
+// Children can't be stored inline in an Expr (it would contain itself), so this is the closest
+// a node can get to a small-vector.
+// Memory comes from the current Arena when one is active, and from the heap otherwise. At most
+// max_size() elements, since the top bit of the capacity is taken; past that throws std::length_error.
+template<typename T>
+class CompactVector{
+	T* _data = nullptr;
+	uint32_t _size = 0;
+	// the top bit marks _data as arena memory, which is never freed individually
+	uint32_t _capacity = 0;
+	static constexpr uint32_t ARENA_BIT = 1u<<31;
+
+	// allocates n elements and returns the matching _capacity value
+	static T* allocate(size_t n, uint32_t& cap){
+		if(n>max_size())
+			throw std::length_error("CompactVector past max_size()");
+		if(Profiler::on())
+			Profiler::count_allocation();
+		if(Arena* arena = Arena::current()){
+			cap = static_cast<uint32_t>(n)|ARENA_BIT;
+			return static_cast<T*>(arena->allocate(sizeof(T)*n));
+		}
+		void* mem = std::malloc(sizeof(T)*n);
+		if(mem==nullptr)
+			throw std::bad_alloc();
+		cap = static_cast<uint32_t>(n);
+		return static_cast<T*>(mem);
+	}
+
+	void deallocate(){
+		if(_data!=nullptr && !(_capacity&ARENA_BIT))
+			std::free(_data);
+	}
+
+	void grow_to(size_t cap){
+		uint32_t fresh_cap;
+		T* fresh = allocate(cap,fresh_cap);
+		for(uint32_t n=0;n<_size;n++){
+			new (fresh+n) T(std::move(_data[n]));
+			_data[n].~T();
+		}
+		deallocate();
+		_data = fresh;
+		_capacity = fresh_cap;
+	}
+
+	size_t next_capacity() const {
+		return capacity()==0 ? 1 : capacity()*2;
+	}
+
+public:
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	CompactVector()=default;
+	CompactVector(const CompactVector& b){
+		if(b._size==0)
+			return;
+		_data = allocate(b._size,_capacity);
+		for(;_size<b._size;_size++){
+			new (_data+_size) T(b._data[_size]);
+		}
+	}
+	CompactVector(CompactVector&& b) noexcept:_data(b._data),_size(b._size),_capacity(b._capacity){
+		b._data = nullptr;
+		b._size = 0;
+		b._capacity = 0;
+	}
+	~CompactVector(){
+		clear();
+		deallocate();
+	}
+
+	CompactVector& operator=(const CompactVector& b){
+		if(this!=&b){
+			CompactVector tmp(b);
+			swap(tmp);
+		}
+		return *this;
+	}
+	CompactVector& operator=(CompactVector&& b) noexcept{
+		CompactVector tmp(std::move(b));
+		swap(tmp);
+		return *this;
+	}
+
+	void swap(CompactVector& b) noexcept{
+		std::swap(_data,b._data);
+		std::swap(_size,b._size);
+		std::swap(_capacity,b._capacity);
+	}
+
+	static constexpr size_t max_size() { return ARENA_BIT-1; }
+	size_t size() const { return _size; }
+	size_t capacity() const { return _capacity&~ARENA_BIT; }
+	bool in_arena() const { return _capacity&ARENA_BIT; }
+	bool empty() const { return _size==0; }
+
+	T* data() { return _data; }
+	const T* data() const { return _data; }
+	iterator begin() { return _data; }
+	iterator end() { return _data+_size; }
+	const_iterator begin() const { return _data; }
+	const_iterator end() const { return _data+_size; }
+
+	T& operator[](size_t n) { return _data[n]; }
+	const T& operator[](size_t n) const { return _data[n]; }
+	T& front() { return _data[0]; }
+	const T& front() const { return _data[0]; }
+	T& back() { return _data[_size-1]; }
+	const T& back() const { return _data[_size-1]; }
+
+	void reserve(size_t cap){
+		if(cap>capacity())
+			grow_to(cap);
+	}
+
+	template<typename...ARGS>
+	T& emplace_back(ARGS&&...args){
+		if(_size==capacity()){
+			// construct first, in case args refer to an element of this
+			T tmp(std::forward<ARGS>(args)...);
+			grow_to(next_capacity());
+			return *new (_data+_size++) T(std::move(tmp));
+		}
+		return *new (_data+_size++) T(std::forward<ARGS>(args)...);
+	}
+	void push_back(const T& v){ emplace_back(v); }
+	void push_back(T&& v){ emplace_back(std::move(v)); }
+
+	void pop_back(){
+		_data[--_size].~T();
+	}
+
+	iterator insert(const_iterator pos, const T& v){
+		size_t idx = pos-_data;
+		emplace_back(v);
+		std::rotate(_data+idx,_data+_size-1,_data+_size);
+		return _data+idx;
+	}
+
+	iterator erase(const_iterator pos){
+		size_t idx = pos-_data;
+		std::move(_data+idx+1,_data+_size,_data+idx);
+		pop_back();
+		return _data+idx;
+	}
+
+	void clear(){
+		while(_size>0)
+			pop_back();
+	}
+};
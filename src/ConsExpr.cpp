@@ -0,0 +1,129 @@
+#include "ConsExpr.hpp"
+
+#include <mutex>
+#include <unordered_set>
+
+struct ConsExpr::Key{
+	const Type* type;
+	uni_value_t value;
+	hash_t hash;
+	const std::vector<ConsExpr>& children;
+};
+
+struct ConsExpr::NodeHash{
+	using is_transparent = void;
+	size_t operator()(const Node* node) const { return node->hash; }
+	size_t operator()(const Key& key) const { return key.hash; }
+};
+
+struct ConsExpr::NodeEqual{
+	using is_transparent = void;
+	static bool equal(const Type* type, uni_value_t value, const std::vector<ConsExpr>& children, const Node* b){
+		if(type!=b->type || value!=b->value || children.size()!=b->children.size())
+			return false;
+		for(size_t n=0;n<children.size();n++){
+			if(children[n].node!=b->children[n].node)
+				return false;
+		}
+		return true;
+	}
+	bool operator()(const Node* a, const Node* b) const { return a==b; }
+	bool operator()(const Key& a, const Node* b) const { return equal(a.type,a.value,a.children,b); }
+	bool operator()(const Node* a, const Key& b) const { return equal(b.type,b.value,b.children,a); }
+};
+
+struct ConsExpr::Table{
+	std::mutex mtx;
+	std::unordered_set<const Node*,NodeHash,NodeEqual> nodes;
+};
+
+ConsExpr::Table& ConsExpr::table(){
+	static Table table;
+	return table;
+}
+
+const ConsExpr::Node* ConsExpr::intern(const Type* type, uni_value_t value, std::vector<ConsExpr>&& children){
+	if(!type->is_value_type())
+		value = 0;
+
+	// same as Expr::hash, so that ConsExpr(ex).hash()==ex.hash()
+	hash_t h = Expr::hash_mix(0,reinterpret_cast<hash_t>(type));
+	if(type->is_value_type()){
+		h = Expr::hash_mix(h,value);
+	}
+	for(const ConsExpr& child : children){
+		h = Expr::hash_mix(h,child.hash());
+	}
+	if(h==0)
+		h = 1;
+
+	Table& tbl = table();
+	std::lock_guard lock(tbl.mtx);
+	auto found = tbl.nodes.find(Key{type,value,h,children});
+	if(found!=tbl.nodes.end()){
+		// a node whose count already reached zero is being freed by another thread; never revive it
+		size_t refs = (*found)->refs.load(std::memory_order_relaxed);
+		while(refs!=0){
+			if((*found)->refs.compare_exchange_weak(refs,refs+1,std::memory_order_relaxed))
+				return *found;
+		}
+		tbl.nodes.erase(found);
+	}
+	// the node holds its own reference to the value, the same as an Expr would
+	if(type->f_retain!=nullptr)
+		type->f_retain(value);
+	Node* node = new Node{type,value,h,std::move(children),1};
+	tbl.nodes.insert(node);
+	return node;
+}
+
+void ConsExpr::release(const Node* node){
+	if(node->refs.fetch_sub(1,std::memory_order_acq_rel)!=1)
+		return;
+	{
+		Table& tbl = table();
+		std::lock_guard lock(tbl.mtx);
+		auto found = tbl.nodes.find(node);
+		if(found!=tbl.nodes.end())
+			tbl.nodes.erase(found);
+	}
+	// releases the children outside of the lock
+	if(node->type->f_release!=nullptr)
+		node->type->f_release(node->value);
+	delete node;
+}
+
+ConsExpr::ConsExpr():node(intern(&Undefined,0,{})){}
+
+ConsExpr::ConsExpr(const Expr& expr){
+	std::vector<ConsExpr> children;
+	children.reserve(expr.child_count());
+	for(const Expr& child : expr){
+		children.emplace_back(child);
+	}
+	node = intern(&expr.type(),expr._value,std::move(children));
+}
+
+Expr ConsExpr::expr() const {
+	CompactVector<Expr> children;
+	children.reserve(node->children.size());
+	for(const ConsExpr& child : node->children){
+		children.push_back(child.expr());
+	}
+	if(node->type->f_retain!=nullptr)
+		node->type->f_retain(node->value);
+	return Expr(node->type,std::move(children),node->value);
+}
+
+const ConsExpr& ConsExpr::operator[](size_t n) const{
+	if(n<node->children.size())
+		return node->children[n];
+	else
+		throw ExprError(expr(),"expr does not have a child at index "+std::to_string(n));
+}
+
+size_t ConsExpr::live_nodes(){
+	Table& tbl = table();
+	std::lock_guard lock(tbl.mtx);
+	return tbl.nodes.size();
+}
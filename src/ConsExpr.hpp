@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "Expr.hpp"
+
+// An immutable, hash-consed expression. Structurally identical ConsExprs share a single node,
+// so comparison is a pointer compare and copying is a refcount bump. A node is freed as soon as
+// no ConsExpr refers to it. Opt-in: build one from an Expr, and convert back with expr().
+class ConsExpr {
+	struct Node{
+		const Type* type;
+		uni_value_t value;
+		hash_t hash;
+		std::vector<ConsExpr> children;
+		mutable std::atomic<size_t> refs;
+	};
+	const Node* node;
+
+	struct Key;
+	struct NodeHash;
+	struct NodeEqual;
+	struct Table;
+	static Table& table();
+
+	static const Node* intern(const Type* type, uni_value_t value, std::vector<ConsExpr>&& children);
+	static void release(const Node* node);
+	explicit ConsExpr(const Node* node):node(node){}
+
+public:
+
+	ConsExpr();
+	ConsExpr(const Expr& expr);
+	ConsExpr(const ConsExpr& b):node(b.node){ node->refs.fetch_add(1,std::memory_order_relaxed); }
+	ConsExpr(ConsExpr&& b) noexcept:node(b.node){ b.node=nullptr; }
+	~ConsExpr(){ if(node!=nullptr) release(node); }
+
+	ConsExpr& operator=(const ConsExpr& b){
+		ConsExpr tmp(b);
+		std::swap(node,tmp.node);
+		return *this;
+	}
+	ConsExpr& operator=(ConsExpr&& b) noexcept{
+		std::swap(node,b.node);
+		return *this;
+	}
+
+	// rebuilds an ordinary (mutable) Expr with the same structure
+	Expr expr() const;
+
+	const Type& type() const { return *node->type; }
+	hash_t hash() const { return node->hash; }
+	bool is_identical_to(const ConsExpr& b) const { return node==b.node; }
+	bool operator==(const ConsExpr& b) const { return node==b.node; }
+
+	typedef std::vector<ConsExpr>::const_iterator ConstIterator;
+	ConstIterator begin() const { return node->children.begin(); }
+	ConstIterator end() const { return node->children.end(); }
+
+	const ConsExpr& operator[](size_t n) const;
+	size_t child_count() const { return node->children.size(); }
+
+	// number of distinct nodes currently alive
+	static size_t live_nodes();
+};
+
+inline string to_string(const ConsExpr& expr){ return to_string(expr.expr()); }
+
+template<>
+struct std::hash<ConsExpr>{
+	hash_t operator ()(const ConsExpr& ex) const {
+		return ex.hash();
+	}
+};
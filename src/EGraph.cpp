@@ -0,0 +1,400 @@
+#include "EGraph.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+
+// commutative nodes with more children than this are only matched in order
+static constexpr size_t max_permuted_children = 6;
+
+static Expr with_children(const Type& type, std::vector<Expr> children){
+	Expr ret = type();
+	for(size_t n=0;n<children.size();n++)
+		ret.set_child(n,std::move(children[n]));
+	return ret;
+}
+
+size_t EGraph::ENodeHash::operator()(const ENode& node) const {
+	hash_t h = Expr::hash_mix(reinterpret_cast<uintptr_t>(node.type),node.leaf.hash());
+	for(id_t child : node.children)
+		h = Expr::hash_mix(h,child);
+	return h;
+}
+
+double EGraph::size_cost(const ENode& node, const double* child_costs){
+	double ret = 1;
+	for(size_t n=0;n<node.children.size();n++)
+		ret += child_costs[n];
+	return ret;
+}
+
+EGraph::id_t EGraph::find(id_t id) const {
+	while(_parent[id]!=id){
+		// path halving
+		_parent[id] = _parent[_parent[id]];
+		id = _parent[id];
+	}
+	return id;
+}
+
+EGraph::ENode EGraph::canonical(ENode node) const {
+	for(id_t& child : node.children)
+		child = find(child);
+	return node;
+}
+
+EGraph::id_t EGraph::add(ENode node){
+	node = canonical(std::move(node));
+	auto found = _memo.find(node);
+	if(found!=_memo.end())
+		return find(found->second);
+
+	id_t id = _parent.size();
+	_parent.push_back(id);
+	_classes.emplace_back();
+	_class_count++;
+	for(id_t child : node.children)
+		_classes[child].parents.emplace_back(node,id);
+	_classes[id].nodes.push_back(node);
+	_memo.emplace(std::move(node),id);
+	return id;
+}
+
+EGraph::id_t EGraph::add(const Expr& expr){
+	ENode node{&expr.type(),expr.child_count()==0 ? expr : Expr(),{}};
+	node.children.reserve(expr.child_count());
+	for(const Expr& child : expr)
+		node.children.push_back(add(child));
+	return add(std::move(node));
+}
+
+bool EGraph::merge(id_t a, id_t b){
+	a = find(a);
+	b = find(b);
+	if(a==b)
+		return false;
+	// the smaller class is moved into the bigger one
+	if(_classes[a].nodes.size()+_classes[a].parents.size()<_classes[b].nodes.size()+_classes[b].parents.size())
+		std::swap(a,b);
+	_parent[b] = a;
+	_class_count--;
+	EClass& from = _classes[b];
+	EClass& to = _classes[a];
+	to.nodes.insert(to.nodes.end(),std::make_move_iterator(from.nodes.begin()),std::make_move_iterator(from.nodes.end()));
+	to.parents.insert(to.parents.end(),std::make_move_iterator(from.parents.begin()),std::make_move_iterator(from.parents.end()));
+	from = EClass();
+	_pending.push_back(a);
+	return true;
+}
+
+void EGraph::repair(id_t id){
+	std::vector<std::pair<ENode,id_t>> parents = std::move(_classes[id].parents);
+	_classes[id].parents.clear();
+	for(auto& [node,parent] : parents){
+		_memo.erase(node);
+		node = canonical(std::move(node));
+		_memo[node] = find(parent);
+	}
+	// parents that became the same node are congruent, so their classes are merged
+	std::unordered_map<ENode,id_t,ENodeHash> unique;
+	for(auto& [node,parent] : parents){
+		auto [found,inserted] = unique.emplace(node,parent);
+		if(!inserted){
+			merge(found->second,parent);
+			found->second = find(parent);
+		}
+	}
+	std::vector<std::pair<ENode,id_t>>& kept = _classes[find(id)].parents;
+	for(auto& [node,parent] : unique)
+		kept.emplace_back(node,find(parent));
+}
+
+bool EGraph::Search::step(){
+	// the clock is only read every so often, since a step can be very cheap
+	if(!stopped && ++steps%64==0 && std::chrono::steady_clock::now()>=deadline)
+		stopped = true;
+	return stopped;
+}
+
+bool EGraph::rebuild(time_point deadline){
+	size_t steps = 0;
+	auto out_of_time = [&](){ return ++steps%64==0 && std::chrono::steady_clock::now()>=deadline; };
+	while(!_pending.empty()){
+		std::vector<id_t> todo;
+		std::swap(todo,_pending);
+		for(id_t& id : todo)
+			id = find(id);
+		std::sort(todo.begin(),todo.end());
+		todo.erase(std::unique(todo.begin(),todo.end()),todo.end());
+		for(size_t n=0;n<todo.size();n++){
+			if(out_of_time()){
+				_pending.insert(_pending.end(),todo.begin()+n,todo.end());
+				return false;
+			}
+			repair(todo[n]);
+		}
+	}
+	for(id_t id=0;id<_classes.size();id++){
+		if(find(id)!=id)
+			continue;
+		if(out_of_time())
+			return false;
+		std::unordered_set<ENode,ENodeHash> seen;
+		std::vector<ENode> nodes;
+		for(ENode& node : _classes[id].nodes){
+			node = canonical(std::move(node));
+			if(seen.insert(node).second)
+				nodes.push_back(node);
+		}
+		_classes[id].nodes = std::move(nodes);
+	}
+	return true;
+}
+
+const Expr* EGraph::constant(id_t id) const {
+	for(const ENode& node : _classes[find(id)].nodes){
+		if(node.children.empty() && node.type->is_constant())
+			return &node.leaf;
+	}
+	return nullptr;
+}
+
+static const EGraph::id_t* find_subst(const std::vector<std::pair<Expr,EGraph::id_t>>& subst, const Expr& variable){
+	for(const auto& [var,id] : subst){
+		if(var==variable)
+			return &id;
+	}
+	return nullptr;
+}
+
+void EGraph::ematch(const Expr& pattern, id_t id, const Subst& subst, std::vector<Subst>& out, Search& search) const {
+	if(search.step())
+		return;
+	id = find(id);
+	if(Rule::is_variable(pattern)){
+		if(const id_t* bound = find_subst(subst,pattern)){
+			if(find(*bound)==id)
+				out.push_back(subst);
+		}
+		else{
+			out.push_back(subst);
+			out.back().emplace_back(pattern,id);
+		}
+		return;
+	}
+	for(const ENode& node : _classes[id].nodes){
+		if(search.stopped)
+			return;
+		if(node.type!=&pattern.type() || node.children.size()!=pattern.child_count())
+			continue;
+		if(node.children.empty()){
+			if(node.leaf==pattern)
+				out.push_back(subst);
+			continue;
+		}
+		std::vector<size_t> order(node.children.size());
+		std::iota(order.begin(),order.end(),0);
+		if(!pattern.type().is_commutative() || order.size()>max_permuted_children){
+			ematch_children(pattern,node,order,0,subst,out,search);
+			continue;
+		}
+		do{
+			ematch_children(pattern,node,order,0,subst,out,search);
+		}while(!search.step() && std::next_permutation(order.begin(),order.end()));
+	}
+}
+
+// matches pattern[index...] to node.children[order[index]...]
+void EGraph::ematch_children(const Expr& pattern, const ENode& node, const std::vector<size_t>& order, size_t index,
+		const Subst& subst, std::vector<Subst>& out, Search& search) const {
+	if(index==order.size()){
+		out.push_back(subst);
+		return;
+	}
+	std::vector<Subst> partial;
+	ematch(pattern[index],node.children[order[index]],subst,partial,search);
+	for(const Subst& next : partial){
+		if(search.step())
+			return;
+		ematch_children(pattern,node,order,index+1,next,out,search);
+	}
+}
+
+EGraph::id_t EGraph::add_pattern(const Expr& pattern, const Subst& subst){
+	if(Rule::is_variable(pattern))
+		return find(*find_subst(subst,pattern));
+	ENode node{&pattern.type(),pattern.child_count()==0 ? pattern : Expr(),{}};
+	node.children.reserve(pattern.child_count());
+	for(const Expr& child : pattern)
+		node.children.push_back(add_pattern(child,subst));
+	return add(std::move(node));
+}
+
+bool EGraph::fold_constants(time_point deadline){
+	// found first, since adding the results can move the classes
+	std::vector<std::pair<id_t,Expr>> folds;
+	for(id_t id=0;id<_classes.size();id++){
+		if(id%64==63 && std::chrono::steady_clock::now()>=deadline)
+			break;
+		if(find(id)!=id || constant(id)!=nullptr)
+			continue;
+		for(const ENode& node : _classes[id].nodes){
+			if(node.type->f_perform==nullptr || node.children.empty())
+				continue;
+			std::vector<Expr> children;
+			for(id_t child : node.children){
+				const Expr* value = constant(child);
+				if(value==nullptr)
+					break;
+				children.push_back(*value);
+			}
+			if(children.size()!=node.children.size())
+				continue;
+			Expr ex = with_children(*node.type,std::move(children));
+			Expr result = node.type->f_perform(ex,false);
+			if(result.child_count()==0 && result.type().is_constant()){
+				folds.emplace_back(id,std::move(result));
+				break;
+			}
+		}
+	}
+	bool changed = false;
+	for(const auto& [id,result] : folds)
+		changed |= merge(id,add(result));
+	return changed;
+}
+
+EGraph::Report EGraph::saturate(const RuleSet& rules, const Limits& limits){
+	time_point deadline = std::chrono::steady_clock::now()+limits.max_time;
+	auto out_of_time = [&](){ return std::chrono::steady_clock::now()>=deadline; };
+	if(!rebuild(deadline))
+		return {TIME_LIMIT,0};
+	// where the last iteration's search stopped, if it was cut short
+	size_t resume_rule = 0;
+	id_t resume_class = 0;
+	for(size_t iteration=0;;iteration++){
+		if(iteration==limits.max_iterations)
+			return {ITERATION_LIMIT,iteration};
+
+		// every match is found in the graph as it was at the start of the iteration, then applied. No more
+		// are collected than the node limit, since each one can add nodes; if that cuts the search short,
+		// the next iteration picks it up where this one stopped, so every rule and class gets its turn.
+		Search search{deadline,limits.max_nodes};
+		std::vector<std::tuple<const Rule*,id_t,Subst>> matches;
+		bool truncated = false;
+		const std::vector<Rule>& all = rules.rules();
+		for(size_t n=0;n<all.size() && !truncated;n++){
+			size_t r = (resume_rule+n)%all.size();
+			for(id_t id=n==0 ? resume_class : 0;id<_classes.size();id++){
+				if(find(id)!=id)
+					continue;
+				std::vector<Subst> found;
+				ematch(all[r].left,id,Subst(),found,search);
+				if(search.stopped)
+					return {TIME_LIMIT,iteration};
+				if(matches.size()+found.size()>search.max_matches){
+					// the rest of this class's matches (all of them, unless it's the only class) wait
+					truncated = true;
+					resume_rule = r;
+					resume_class = id;
+					if(matches.empty()){
+						found.resize(search.max_matches);
+						resume_class = id+1;
+						for(Subst& subst : found)
+							matches.emplace_back(&all[r],id,std::move(subst));
+					}
+					break;
+				}
+				for(Subst& subst : found)
+					matches.emplace_back(&all[r],id,std::move(subst));
+			}
+		}
+		if(!truncated){
+			resume_rule = 0;
+			resume_class = 0;
+		}
+
+		bool changed = false;
+		for(size_t n=0;n<matches.size();n++){
+			const auto& [rule,id,subst] = matches[n];
+			changed |= merge(id,add_pattern(rule->right,subst));
+			if(node_count()>limits.max_nodes){
+				rebuild(deadline);
+				return {NODE_LIMIT,iteration+1};
+			}
+			if(n%256==255 && out_of_time()){
+				rebuild(deadline);
+				return {TIME_LIMIT,iteration+1};
+			}
+		}
+		if(!rebuild(deadline))
+			return {TIME_LIMIT,iteration+1};
+		changed |= fold_constants(deadline);
+		if(!rebuild(deadline))
+			return {TIME_LIMIT,iteration+1};
+		// matches left out may still change something
+		if(!changed && !truncated)
+			return {SATURATED,iteration+1};
+		if(out_of_time())
+			return {TIME_LIMIT,iteration+1};
+	}
+}
+
+static Expr build(const EGraph& graph, EGraph::id_t id, const std::vector<const EGraph::ENode*>& best){
+	const EGraph::ENode* node = best[graph.find(id)];
+	ASSERT(node!=nullptr);
+	if(node->children.empty())
+		return node->leaf;
+	std::vector<Expr> children;
+	children.reserve(node->children.size());
+	for(EGraph::id_t child : node->children)
+		children.push_back(build(graph,child,best));
+	return with_children(*node->type,std::move(children));
+}
+
+EGraph::Report EGraph::saturate(const RuleSet& rules){
+	return saturate(rules,Limits());
+}
+
+Expr EGraph::extract(id_t id, CostFunction cost) const {
+	const double infinity = std::numeric_limits<double>::infinity();
+	std::vector<double> costs(_classes.size(),infinity);
+	std::vector<const ENode*> best(_classes.size(),nullptr);
+	// costs only go down, and each is more than its children's, so this settles
+	bool changed = true;
+	std::vector<double> child_costs;
+	while(changed){
+		changed = false;
+		for(id_t c=0;c<_classes.size();c++){
+			if(find(c)!=c)
+				continue;
+			for(const ENode& node : _classes[c].nodes){
+				child_costs.clear();
+				for(id_t child : node.children)
+					child_costs.push_back(costs[find(child)]);
+				if(std::find(child_costs.begin(),child_costs.end(),infinity)!=child_costs.end())
+					continue;
+				double node_cost = cost(node,child_costs.data());
+				if(node_cost<costs[c]){
+					costs[c] = node_cost;
+					best[c] = &node;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	return build(*this,id,best);
+}
+
+Expr EGraph::simplify(const Expr& expr, const RuleSet& rules, const Limits& limits, CostFunction cost){
+	EGraph graph;
+	id_t root = graph.add(expr);
+	graph.saturate(rules,limits);
+	return graph.extract(root,cost);
+}
+
+Expr EGraph::simplify(const Expr& expr, const RuleSet& rules){
+	return simplify(expr,rules,Limits());
+}
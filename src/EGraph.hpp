@@ -0,0 +1,113 @@
+#pragma once
+
+#include "RuleSet.hpp"
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+// An e-graph: a set of equivalence classes of exprs, where a node's children are classes rather than
+// exprs, so one graph holds every form the rules can reach without copying shared parts. Nodes are
+// hashconsed (one node per type, leaf value and child classes) and classes are merged with union-find.
+// saturate applies rules until nothing new is found or a limit is hit; extract then picks the
+// cheapest expr of a class.
+class EGraph{
+public:
+	typedef uint32_t id_t;
+
+	struct ENode{
+		const Type* type;
+		// the whole expr, for nodes with no children
+		Expr leaf;
+		std::vector<id_t> children;
+		bool operator==(const ENode& b) const { return type==b.type && leaf==b.leaf && children==b.children; }
+	};
+	struct ENodeHash{
+		size_t operator()(const ENode& node) const;
+	};
+
+	// cost of a node, given the costs of its children; must be more than any of theirs
+	typedef double (*CostFunction)(const ENode& node, const double* child_costs);
+	// the number of nodes
+	static double size_cost(const ENode& node, const double* child_costs);
+
+	struct Limits{
+		size_t max_nodes = 10000;
+		size_t max_iterations = 30;
+		std::chrono::milliseconds max_time{100};
+	};
+	enum StopReason{ SATURATED, NODE_LIMIT, ITERATION_LIMIT, TIME_LIMIT };
+	struct Report{
+		StopReason stop;
+		size_t iterations;
+	};
+
+private:
+	// variables of a pattern and the classes they matched
+	typedef std::vector<std::pair<Expr,id_t>> Subst;
+	struct EClass{
+		std::vector<ENode> nodes;
+		// nodes with this class as a child, and their classes
+		std::vector<std::pair<ENode,id_t>> parents;
+	};
+
+	typedef std::chrono::steady_clock::time_point time_point;
+	// bounds one round of e-matching: it stops at the deadline, or once it has max_matches
+	struct Search{
+		time_point deadline;
+		size_t max_matches;
+		size_t matches = 0;
+		size_t steps = 0;
+		bool stopped = false;
+		// counts a step, checking the clock every so often; true once the search should stop
+		bool step();
+	};
+
+	mutable std::vector<id_t> _parent;
+	std::vector<EClass> _classes;
+	std::unordered_map<ENode,id_t,ENodeHash> _memo;
+	// merged classes whose parents haven't been repaired yet
+	std::vector<id_t> _pending;
+	size_t _class_count = 0;
+
+	ENode canonical(ENode node) const;
+	id_t add(ENode node);
+	void repair(id_t id);
+	// a constant in the class, or nullptr
+	const Expr* constant(id_t id) const;
+	void ematch(const Expr& pattern, id_t id, const Subst& subst, std::vector<Subst>& out, Search& search) const;
+	void ematch_children(const Expr& pattern, const ENode& node, const std::vector<size_t>& order, size_t index,
+		const Subst& subst, std::vector<Subst>& out, Search& search) const;
+	id_t add_pattern(const Expr& pattern, const Subst& subst);
+	// merges each class whose nodes have constant children with the result of performing them, as many
+	// as it gets to by the deadline
+	bool fold_constants(time_point deadline);
+	// rebuild, stopping at the deadline; false if it did, with the rest left for the next rebuild
+	bool rebuild(time_point deadline);
+
+public:
+	id_t add(const Expr& expr);
+	id_t find(id_t id) const;
+	// true if a and b were in different classes; call rebuild before matching or extracting
+	bool merge(id_t a, id_t b);
+	// restores the invariants that merging breaks: congruent nodes share a class, and each node is
+	// stored once, with its children as canonical ids
+	void rebuild(){ rebuild(time_point::max()); }
+
+	size_t node_count() const { return _memo.size(); }
+	size_t class_count() const { return _class_count; }
+
+	// applies rules (Rule semantics: variables end in '_', commutative children match in any order) to
+	// every class until nothing changes or a limit is reached, folding constant nodes on the way. An
+	// iteration applies at most max_nodes matches. Matching, folding and rebuilding all watch the clock,
+	// so it returns soon after max_time; the graph may then not be fully rebuilt, which extract allows.
+	Report saturate(const RuleSet& rules, const Limits& limits);
+	Report saturate(const RuleSet& rules);
+	// the cheapest expr in the class of id; congruent classes that haven't been merged yet (as after a
+	// saturate that ran out of time) only make it miss some choices
+	Expr extract(id_t id, CostFunction cost = size_cost) const;
+
+	// the cheapest form of expr that rules can reach within limits
+	static Expr simplify(const Expr& expr, const RuleSet& rules, const Limits& limits, CostFunction cost = size_cost);
+	static Expr simplify(const Expr& expr, const RuleSet& rules);
+};
@@ -9,10 +9,24 @@ Expr::Expr(float_value_t v){
 Expr::Expr(bool_value_t v){
 	*this=Bool(v);
 }
+Expr::Expr(const BigInt& v){
+	if(v.fits_int64())
+		*this=Integer(v.to_int64());
+	else
+		*this=BigInteger(v);
+}
+Expr::Expr(const Fraction& v){
+	if(v.is_integer())
+		*this=Expr(v.numerator());
+	else
+		*this=Rational(v);
+}
 
 Expr& Expr::operator[](size_t n){
-	if(n<_children.size())
+	if(n<_children.size()){
+		clear_hash();
 		return _children[n];
+	}
 	else
 		throw ExprError(*this,"expr does not have a child at index "+std::to_string(n));
 }
@@ -28,48 +42,79 @@ void Expr::add_child(const Expr& expr){
 		throw ExprError(*this,string("an expr of type ")+type().name+" must have exactly "+std::to_string(type().arity)+" children");
 	}
 	_children.push_back(expr);
+	clear_hash();
+}
+
+void Expr::add_child(Expr&& expr){
+	if(type().arity!=Type::INFINITARY){
+		throw ExprError(*this,string("an expr of type ")+type().name+" must have exactly "+std::to_string(type().arity)+" children");
+	}
+	_children.push_back(std::move(expr));
+	clear_hash();
+}
+
+void Expr::set_child(size_t n, Expr&& expr){
+	if(type().arity==Type::INFINITARY && n==_children.size())
+		add_child(std::move(expr));
+	else
+		(*this)[n] = std::move(expr);
 }
 
 Expr::Iterator Expr::insert_child(const ConstIterator& pos, const Expr& expr){
 	if(type().arity!=Type::INFINITARY){
 		throw ExprError(*this,string("an expr of type ")+type().name+" must have exactly "+std::to_string(type().arity)+" children");
 	}
-	return Iterator(_children.insert(pos.iter,expr));
+	clear_hash();
+	return Iterator(_children.insert(pos.iter,expr),this);
 }
 
 Expr::Iterator Expr::remove_child(const ConstIterator& pos){
 	if(type().arity!=Type::INFINITARY){
 		throw ExprError(*this,string("an expr of type ")+type().name+" must have exactly "+std::to_string(type().arity)+" children");
 	}
-	return Iterator(_children.erase(pos.iter));
+	clear_hash();
+	return Iterator(_children.erase(pos.iter),this);
 }
 
 hash_t Expr::hash() const {
 	static_assert(sizeof(hash_t)==8,"Expr::hash algorithm assumes a 64-bit hash_t");
 	static_assert(sizeof(hash_t)==sizeof(void*));
 	static_assert(sizeof(hash_t)==sizeof(uni_value_t));
-	hash_t h = reinterpret_cast<hash_t>(&type());
-	h = (h<<19)^(h>>45);
+	hash_t memo = _hash.load(std::memory_order_relaxed);
+	if(memo!=0)
+		return memo;
+	hash_t h = hash_mix(0,reinterpret_cast<hash_t>(&type()));
 	if(type().is_value_type()){
-		h^=_value;
-		h = (h<<19)^(h>>45);
+		h = hash_mix(h,_value);
 	}
 	for(const Expr& child : _children){
-		h^=child.hash();
-		h = (h<<19)^(h>>45);
+		h = hash_mix(h,child.hash());
 	}
+	// 0 is reserved for 'not computed'
+	h = h==0 ? 1 : h;
+	_hash.store(h,std::memory_order_relaxed);
 	return h;
 }
 
+size_t Expr::node_count() const {
+	size_t ret = 1;
+	for(const Expr& child : _children)
+		ret += child.node_count();
+	return ret;
+}
+
 bool Expr::is_identical_to(const Expr& b) const {
 	if(type()!=b.type())
 		return false;
 	if(child_count()!=b.child_count())
 		return false;
+	hash_t a_hash = _hash.load(std::memory_order_relaxed), b_hash = b._hash.load(std::memory_order_relaxed);
+	if(a_hash!=0 && b_hash!=0 && a_hash!=b_hash)
+		return false;
 	if(type().is_value_type())
 		return _value==b._value;
-	std::deque<Expr>::const_iterator a_iter = _children.begin();
-	std::deque<Expr>::const_iterator b_iter = b._children.begin();
+	const Expr* a_iter = _children.begin();
+	const Expr* b_iter = b._children.begin();
 	while(a_iter!=_children.end()){
 		if(!a_iter->is_identical_to(*b_iter))
 			return false;
@@ -78,3 +123,8 @@ bool Expr::is_identical_to(const Expr& b) const {
 	}
 	return true;
 }
+
+Expr promote(const Expr& expr){
+	Arena::Scope heap(nullptr);
+	return expr;
+}
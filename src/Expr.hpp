@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <iosfwd>
 #include <string>
-#include <deque>
+
+#include "CompactVector.hpp"
 
 #include "error.hpp"
 #include "Type.hpp"
@@ -11,41 +14,80 @@ using std::string;
 
 class Expr {
 	const Type* _type = &Undefined;
-	std::deque<Expr> _children;
+	CompactVector<Expr> _children;
 	uni_value_t _value=0;
+	// memoized hash(); 0 if not yet computed. Cleared by anything that hands out mutable access
+	// to the children. References to children kept across a hash() call bypass this. Atomic, since
+	// shared exprs are hashed from several threads at once; every thread computes the same value, so
+	// relaxed loads and stores are enough.
+	mutable std::atomic<hash_t> _hash=0;
+
+	void clear_hash() const { _hash.store(0,std::memory_order_relaxed); }
 
 	// for Type to directly initialize an Expr
-	Expr(const Type* _t, std::deque<Expr>&& _c, uni_value_t _v):
+	Expr(const Type* _t, CompactVector<Expr>&& _c, uni_value_t _v):
 		_type(_t), _children(std::move(_c)), _value(_v) {}
 
 public:
 
 	Expr()=default;
-	Expr(const Expr&)=default;
-	Expr(Expr&& ex):_type(ex._type),_children(std::move(ex._children)),_value(ex._value){
+	Expr(const Expr& ex):_type(ex._type),_children(ex._children),_value(ex._value),_hash(ex._hash.load(std::memory_order_relaxed)){
+		if(_type->f_retain!=nullptr)
+			_type->f_retain(_value);
+	}
+	Expr(Expr&& ex) noexcept:_type(ex._type),_children(std::move(ex._children)),_value(ex._value),_hash(ex._hash.load(std::memory_order_relaxed)){
 		ex._type=&Undefined;
+		ex._hash.store(0,std::memory_order_relaxed);
+	}
+	~Expr(){
+		if(_type->f_release!=nullptr)
+			_type->f_release(_value);
 	}
 	Expr(const string& str);
 	Expr(int_value_t);
 	Expr(float_value_t);
 	Expr(bool_value_t);
+	// an Integer if it fits, otherwise a BigInteger
+	Expr(const BigInt&);
+	// a Rational, or an integer if the denominator is 1
+	Expr(const Fraction&);
 
 	const Type& type() const {return *_type; }
 	bool is_identical_to(const Expr& expr) const;
 	hash_t hash() const;
+	// one mixing step of hash(); shared with ConsExpr so both produce the same hashes
+	static hash_t hash_mix(hash_t h, hash_t v){
+		h^=v;
+		return (h<<19)^(h>>45);
+	}
 
-	Expr& operator=(const Expr&)=default;
-	Expr& operator=(Expr&& b) {
-		_type=b._type;
-		_children=std::move(b._children);
+	Expr& operator=(const Expr& b){
+		if(this!=&b)
+			*this = Expr(b);
+		return *this;
+	}
+	Expr& operator=(Expr&& b) noexcept {
+		if(this==&b)
+			return *this;
+		// b may be one of this's children, so everything is taken from it before the old children go
+		const Type* type = b._type;
+		CompactVector<Expr> children = std::move(b._children);
+		b._type = &Undefined;
+		if(_type->f_release!=nullptr)
+			_type->f_release(_value);
+		_type = type;
 		_value = b._value;
+		_hash.store(b._hash.load(std::memory_order_relaxed),std::memory_order_relaxed);
+		b._hash.store(0,std::memory_order_relaxed);
+		_children = std::move(children);
 		return *this;
 	};
 	bool operator==(const Expr& expr) const{ return is_identical_to(expr); }
 
 	class Iterator{
-		std::deque<Expr>::iterator iter;
-		Iterator(std::deque<Expr>::iterator it):iter(it){}
+		Expr* iter = nullptr;
+		const Expr* parent = nullptr;
+		Iterator(Expr* it, const Expr* parent):iter(it),parent(parent){}
 	public:
 		Iterator()=default;
 		Iterator(const Iterator&)=default;
@@ -54,19 +96,19 @@ public:
 		Iterator& operator=(Iterator&&)=default;
 		bool operator == (const Iterator& b) const { return iter==b.iter; }
 		bool operator != (const Iterator& b) const { return iter!=b.iter; }
-		Expr& operator * () const { return *iter; }
-		Expr* operator -> () const { return &*iter; }
+		Expr& operator * () const { parent->clear_hash(); return *iter; }
+		Expr* operator -> () const { parent->clear_hash(); return &*iter; }
 		Iterator& operator ++ () { ++iter; return *this; }
-		Iterator operator ++ (int) { return Iterator(iter++); }
+		Iterator operator ++ (int) { return Iterator(iter++,parent); }
 		Iterator& operator -- () { --iter; return *this; }
-		Iterator operator -- (int) { return Iterator(iter--); }
+		Iterator operator -- (int) { return Iterator(iter--,parent); }
 		friend class Expr;
 		friend class ConstIterator;
 	};
 
 	class ConstIterator{
-		std::deque<Expr>::const_iterator iter;
-		ConstIterator(std::deque<Expr>::const_iterator it):iter(it){}
+		const Expr* iter = nullptr;
+		ConstIterator(const Expr* it):iter(it){}
 	public:
 		ConstIterator()=default;
 		ConstIterator(const ConstIterator&)=default;
@@ -86,19 +128,27 @@ public:
 		friend class Expr;
 	};
 
-	Iterator begin() { return Iterator(_children.begin()); }
-	Iterator end() { return Iterator(_children.end()); }
+	Iterator begin() { return Iterator(_children.begin(),this); }
+	Iterator end() { return Iterator(_children.end(),this); }
 	ConstIterator begin() const { return ConstIterator(_children.begin()); }
 	ConstIterator end() const { return ConstIterator(_children.end()); }
 
 	Expr& operator[](size_t n);
 	const Expr& operator[](size_t n) const;
 	size_t child_count() const { return _children.size(); }
+	// nodes in the whole tree, this one included
+	size_t node_count() const;
 	void add_child(const Expr& expr);
+	void add_child(Expr&& expr);
+	// for filling in a new expr of any type, child by child: appends the nth child of an infinitary
+	// type, and replaces the placeholder a fixed arity type comes with
+	void set_child(size_t n, Expr&& expr);
 	Iterator insert_child(const ConstIterator& pos, const Expr& expr);
 	Iterator remove_child(const ConstIterator& iter);
 
 	friend class _ExprToFromStringImpl;
+	friend class ConsExpr;
+	friend Expr promote(const Expr&);
 	friend class Type;
 	template<typename T>
 	friend class ValueType;
@@ -107,12 +157,31 @@ public:
 
 string to_string(const Expr& expr);
 
+// Limits for printing exprs too large to show whole; each is unlimited by default. What's past them
+// is elided as "…[n nodes]", with the number of nodes left out.
+struct PrintLimits{
+	// once this many bytes have been written, everything not yet written is elided
+	size_t max_bytes = SIZE_MAX;
+	// subtrees nested deeper than this are elided
+	size_t max_depth = SIZE_MAX;
+	// a node's children after the first max_width are elided together (for chains like a + b + c)
+	size_t max_width = SIZE_MAX;
+};
+string to_string(const Expr& expr, const PrintLimits& limits);
+// writes the same as to_string(expr,limits), a few KB at a time; the output can overshoot max_bytes
+// by up to the last leaf or piece of operator text
+void print(std::ostream& out, const Expr& expr, const PrintLimits& limits);
+
+// deep copies an expression onto the heap, so that it can outlive the Arena it was built in
+Expr promote(const Expr& expr);
+
 
 
 struct ExprError : public NamedError{
 	Expr subject;
-	ExprError(Expr subject, string what):
-		NamedError("ExprError", what + "\nwith expression: "+to_string(subject)),subject(std::move(subject)){}
+	// the subject is promoted, since the error may be caught outside of the Arena it lives in
+	ExprError(const Expr& subject, string what):
+		NamedError("ExprError", what + "\nwith expression: "+to_string(subject)),subject(promote(subject)){}
 };
 
 struct SyntaxError : public NamedError{
@@ -135,5 +204,8 @@ template<typename...Ts> requires (std::same_as<Expr,Ts>&&...)
 Expr Type::operator()(Ts...args) const{
 	if(arity!=INFINITARY)
 		ASSERT_EQUAL(sizeof...(Ts),arity);
-	return Expr(this, {std::move(args)...},0);
+	CompactVector<Expr> children;
+	children.reserve(sizeof...(Ts));
+	(children.push_back(std::move(args)),...);
+	return Expr(this,std::move(children),0);
 }
@@ -0,0 +1,147 @@
+#include "ExprGenerator.hpp"
+
+#include <algorithm>
+
+ExprGenerator::Mix ExprGenerator::default_mix(){
+	return {
+		{&Add,4},{&Mul,4},{&Sub,1},{&Div,1},{&Neg,1},{&Pow,1},
+		{&Symbol,4},{&Integer,3},{&Float,1}
+	};
+}
+
+ExprGenerator::Mix ExprGenerator::parse_mix(const string& spec){
+	Mix mix;
+	size_t start = 0;
+	while(start<spec.size()){
+		size_t end = std::min(spec.find(',',start),spec.size());
+		string item = spec.substr(start,end-start);
+		start = end+1;
+		size_t eq = item.find('=');
+		if(eq==string::npos)
+			throw GeneratorError("Expected Type=weight, got '"+item+"'");
+		string name = item.substr(0,eq);
+		auto found = std::find_if(all_types.begin(),all_types.end(),[&](const Type* type){ return name==type->name; });
+		if(found==all_types.end())
+			throw GeneratorError("Unknown type '"+name+"'");
+		unsigned weight;
+		try{
+			size_t used;
+			weight = std::stoul(item.substr(eq+1),&used);
+			if(used!=item.size()-eq-1)
+				throw std::invalid_argument(item);
+		}
+		catch(const std::logic_error&){
+			throw GeneratorError("Expected a weight after '"+name+"=', got '"+item.substr(eq+1)+"'");
+		}
+		mix.emplace_back(*found,weight);
+	}
+	return mix;
+}
+
+string ExprGenerator::to_string(const Mix& mix){
+	string ret;
+	for(const auto& [type,weight] : mix){
+		if(!ret.empty())
+			ret += ',';
+		ret += string(type->name)+"="+std::to_string(weight);
+	}
+	return ret;
+}
+
+ExprGenerator::ExprGenerator(const Options& options):options(options),rng(options.seed){
+	for(const auto& [type,weight] : options.mix){
+		if(weight==0)
+			continue;
+		if(type==&Symbol || type==&Integer || type==&Float || (!type->is_value_type() && type->arity==Type::NULLARY)){
+			leaves.emplace_back(type,weight);
+			leaf_total += weight;
+		}
+		else if(!type->is_value_type() && type!=&Undefined){
+			operators.emplace_back(type,weight);
+			operator_total += weight;
+		}
+		else{
+			throw GeneratorError("Can't generate "+string(type->name));
+		}
+	}
+	if(leaves.empty())
+		throw GeneratorError("The mix needs at least one leaf type");
+	if(options.max_width<2)
+		throw GeneratorError("max_width must be at least 2");
+	for(size_t n=0;n<std::max<size_t>(options.symbols,1);n++){
+		string name;
+		for(size_t k=n+1;k>0;k=(k-1)/26)
+			name.insert(name.begin(),char('a'+(k-1)%26));
+		names.push_back(name);
+	}
+}
+
+size_t ExprGenerator::below(size_t n){
+	return rng()%n;
+}
+
+const Type* ExprGenerator::pick(const Mix& from, unsigned total){
+	size_t at = below(total);
+	for(const auto& [type,weight] : from){
+		if(at<weight)
+			return type;
+		at -= weight;
+	}
+	ERROR("weights don't add up to their total");
+}
+
+Expr ExprGenerator::leaf(){
+	const Type* type = pick(leaves,leaf_total);
+	if(type==&Symbol)
+		return Symbol(names[below(names.size())]);
+	if(type==&Integer)
+		return Integer(int_value_t(1+below(9)));
+	if(type==&Float)
+		return Float(float_value_t(1+below(64))/8);
+	return (*type)();
+}
+
+Expr ExprGenerator::node(size_t size, size_t depth, const Type* parent){
+	if(size<=1 || depth==0 || operators.empty())
+		return leaf();
+	const Type* type = pick(operators,operator_total);
+	// the parser would flatten it into its parent, so the expr wouldn't survive printing and parsing
+	if(type==parent && type->is_associative()){
+		if(operators.size()==1)
+			return leaf();
+		while(type==parent)
+			type = pick(operators,operator_total);
+	}
+	if(type==&Pow)
+		return Pow(node(size-2,depth-1,type),Integer(int_value_t(2+below(2))));
+
+	size_t remaining = size-1;
+	size_t count;
+	if(type->arity==Type::INFINITARY)
+		count = remaining<2 ? 2 : 2+below(std::min(options.max_width,remaining)-1);
+	else
+		count = type->arity;
+	remaining = std::max(remaining,count);
+
+	// every child gets one node, and the rest is shared out by random weights
+	std::vector<size_t> shares(count);
+	size_t weight_total = 0;
+	for(size_t& share : shares)
+		weight_total += share = 1+below(8);
+	size_t extra = remaining-count;
+	size_t given = 0;
+	for(size_t n=0;n+1<count;n++){
+		shares[n] = 1+extra*shares[n]/weight_total;
+		given += shares[n];
+	}
+	shares.back() = remaining-given;
+
+	Expr ret = (*type)();
+	for(size_t n=0;n<count;n++)
+		ret.set_child(n,node(shares[n],depth-1,type));
+	return ret;
+}
+
+Expr ExprGenerator::operator()(){
+	return node(options.size,options.max_depth,nullptr);
+}
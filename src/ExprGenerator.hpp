@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Expr.hpp"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+struct GeneratorError : public NamedError{
+	GeneratorError(string what):NamedError("GeneratorError",std::move(what)){}
+};
+
+// Seeded random expressions, for benchmarks and tests. The same options give the same sequence of
+// exprs on every run and platform (the generator draws from mt19937_64 without std distributions).
+// Each expr has about size nodes and is nested at most max_depth deep; which types make it up, and how
+// often, is set by mix. Symbol, Integer, Float and nullary types (like Pi) are leaves; other types are
+// operators. Integers are 1 to 9 and Floats multiples of 1/8, so they print and parse back exactly; a
+// Pow's exponent is always an Integer of 2 or 3, so performing doesn't blow up into huge numbers; and an
+// associative type is never a direct child of itself, so the parser doesn't flatten it. With the default
+// mix, parsing a generated expr's text gives back the same expr.
+class ExprGenerator{
+public:
+	typedef std::vector<std::pair<const Type*,unsigned>> Mix;
+
+	struct Options{
+		uint64_t seed = 1;
+		size_t size = 100;
+		size_t max_depth = 16;
+		// children of an infinitary node (at least 2)
+		size_t max_width = 4;
+		// distinct Symbol names (a, b, ..., z, aa, ab, ...)
+		size_t symbols = 8;
+		// relative weight of each type
+		Mix mix = default_mix();
+	};
+
+	// Add, Mul, Sub, Div, Neg and Pow over Symbols, Integers and Floats
+	static Mix default_mix();
+	// a mix from "Type=weight,Type=weight,..." (by type name); throws GeneratorError
+	static Mix parse_mix(const string& spec);
+	// the inverse of parse_mix
+	static string to_string(const Mix& mix);
+
+	// throws GeneratorError if the mix has no leaves, or a type that can't be generated
+	ExprGenerator(const Options& options);
+
+	// the next expr of the sequence, built in the current Arena
+	Expr operator()();
+
+private:
+	Options options;
+	std::mt19937_64 rng;
+	Mix leaves, operators;
+	unsigned leaf_total = 0, operator_total = 0;
+	std::vector<string> names;
+
+	// uniform in [0,n)
+	size_t below(size_t n);
+	const Type* pick(const Mix& from, unsigned total);
+	Expr leaf();
+	Expr node(size_t size, size_t depth, const Type* parent);
+};
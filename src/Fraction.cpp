@@ -0,0 +1,128 @@
+#include "Fraction.hpp"
+
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+// v as an int64_t, if it fits with room to negate (std::gcd and abs are undefined for INT64_MIN)
+static bool small(const BigInt& v, int64_t& out){
+	if(!v.fits_int64())
+		return false;
+	out = v.to_int64();
+	return out!=std::numeric_limits<int64_t>::min();
+}
+
+Fraction::Fraction(BigInt num, BigInt den):_num(std::move(num)),_den(std::move(den)){
+	if(_den.is_zero())
+		throw std::domain_error("Fraction: zero denominator");
+	normalize();
+}
+
+void Fraction::normalize(){
+	int64_t n,d;
+	if(small(_num,n) && small(_den,d)){
+		int64_t g = std::gcd(n,d);
+		if(d<0)
+			g = -g;
+		_num = n/g;
+		_den = d/g;
+		return;
+	}
+	BigInt g = BigInt::gcd(_num,_den);
+	if(_den.is_negative())
+		g = -g;
+	_num = _num/g;
+	_den = _den/g;
+}
+
+double Fraction::to_double() const {
+	return _num.to_double()/_den.to_double();
+}
+
+string Fraction::to_string() const {
+	if(is_integer())
+		return _num.to_string();
+	return _num.to_string()+"/"+_den.to_string();
+}
+
+Fraction Fraction::operator-() const {
+	Fraction ret = *this;
+	ret._num = -ret._num;
+	return ret;
+}
+
+Fraction& Fraction::operator+=(const Fraction& b){
+	int64_t n1,d1,n2,d2;
+	if(small(_num,n1) && small(_den,d1) && small(b._num,n2) && small(b._den,d2)){
+		// n1/d1 + n2/d2 = (n1*(d2/g) + n2*(d1/g)) / (d1/g*d2)
+		int64_t g = std::gcd(d1,d2);
+		int64_t left,right,num,den;
+		if(!__builtin_mul_overflow(n1,d2/g,&left) && !__builtin_mul_overflow(n2,d1/g,&right) &&
+			!__builtin_add_overflow(left,right,&num) && !__builtin_mul_overflow(d1/g,d2,&den)){
+			_num = num;
+			_den = den;
+			normalize();
+			return *this;
+		}
+	}
+	_num = _num*b._den+b._num*_den;
+	_den = _den*b._den;
+	normalize();
+	return *this;
+}
+
+Fraction& Fraction::operator*=(const Fraction& b){
+	int64_t n1,d1,n2,d2;
+	if(small(_num,n1) && small(_den,d1) && small(b._num,n2) && small(b._den,d2)){
+		// cancelling across first keeps the result normalized
+		int64_t g1 = std::gcd(n1,d2);
+		int64_t g2 = std::gcd(n2,d1);
+		if(g1==0)
+			g1 = 1;
+		if(g2==0)
+			g2 = 1;
+		int64_t num,den;
+		if(!__builtin_mul_overflow(n1/g1,n2/g2,&num) && !__builtin_mul_overflow(d1/g2,d2/g1,&den)){
+			_num = num;
+			_den = den;
+			if(num==0)
+				_den = 1;
+			return *this;
+		}
+	}
+	_num = _num*b._num;
+	_den = _den*b._den;
+	normalize();
+	return *this;
+}
+
+Fraction& Fraction::operator/=(const Fraction& b){
+	if(b.is_zero())
+		throw std::domain_error("Fraction: division by zero");
+	Fraction inverse;
+	inverse._num = b._den;
+	inverse._den = b._num;
+	if(inverse._den.is_negative()){
+		inverse._num = -inverse._num;
+		inverse._den = -inverse._den;
+	}
+	return *this *= inverse;
+}
+
+Fraction Fraction::pow(const Fraction& base, int64_t exponent){
+	uint64_t magnitude = exponent<0 ? 0-uint64_t(exponent) : uint64_t(exponent);
+	// already normalized: powers of coprime numbers stay coprime
+	Fraction ret;
+	ret._num = BigInt::pow(base._num,magnitude);
+	ret._den = BigInt::pow(base._den,magnitude);
+	if(exponent<0){
+		if(base.is_zero())
+			throw std::domain_error("Fraction: zero to a negative power");
+		std::swap(ret._num,ret._den);
+		if(ret._den.is_negative()){
+			ret._num = -ret._num;
+			ret._den = -ret._den;
+		}
+	}
+	return ret;
+}
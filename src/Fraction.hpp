@@ -0,0 +1,52 @@
+#pragma once
+#include "BigInt.hpp"
+
+// Exact rational number, always normalized: the denominator is positive and shares no factor with
+// the numerator (so 0 is 0/1). Arithmetic runs on int64_t while every part fits, and only falls
+// back to BigInt when a step would overflow.
+class Fraction{
+	BigInt _num = 0;
+	BigInt _den = 1;
+
+	void normalize();
+
+public:
+	Fraction(){}
+	Fraction(BigInt v):_num(std::move(v)){}
+	// throws std::domain_error if den is 0
+	Fraction(BigInt num, BigInt den);
+
+	const BigInt& numerator() const { return _num; }
+	const BigInt& denominator() const { return _den; }
+	bool is_integer() const { return _den==1; }
+	bool is_zero() const { return _num.is_zero(); }
+	bool is_negative() const { return _num.is_negative(); }
+	double to_double() const;
+	// "n/d", or just "n" for an integer
+	string to_string() const;
+	size_t hash() const { return _num.hash()*31+_den.hash(); }
+
+	Fraction operator-() const;
+	Fraction& operator+=(const Fraction& b);
+	Fraction& operator-=(const Fraction& b){ return *this += -b; }
+	Fraction& operator*=(const Fraction& b);
+	// throws std::domain_error if b is 0
+	Fraction& operator/=(const Fraction& b);
+	friend Fraction operator+(Fraction a, const Fraction& b){ return a+=b; }
+	friend Fraction operator-(Fraction a, const Fraction& b){ return a-=b; }
+	friend Fraction operator*(Fraction a, const Fraction& b){ return a*=b; }
+	friend Fraction operator/(Fraction a, const Fraction& b){ return a/=b; }
+
+	// throws std::domain_error for 0 to a negative power
+	static Fraction pow(const Fraction& base, int64_t exponent);
+
+	friend bool operator==(const Fraction& a, const Fraction& b){ return a._num==b._num && a._den==b._den; }
+	friend std::strong_ordering operator<=>(const Fraction& a, const Fraction& b){ return a._num*b._den <=> b._num*a._den; }
+};
+
+inline string to_string(const Fraction& v){ return v.to_string(); }
+
+template<>
+struct std::hash<Fraction>{
+	size_t operator()(const Fraction& v) const { return v.hash(); }
+};
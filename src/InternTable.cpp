@@ -0,0 +1,165 @@
+#include "InternTable.hpp"
+#include "BigInt.hpp"
+#include "Fraction.hpp"
+
+#include <bit>
+
+template<typename T, typename View>
+typename BasicInternTable<T,View>::Entry& BasicInternTable<T,View>::Shard::entry(uint32_t index) const {
+	size_t block = std::bit_width(index/first_block+1)-1;
+	size_t start = first_block*((size_t(1)<<block)-1);
+	return blocks[block].load(std::memory_order_acquire)[index-start];
+}
+
+template<typename T, typename View>
+uint32_t BasicInternTable<T,View>::Shard::add_entry(){
+	if(!free.empty()){
+		uint32_t index = free.back();
+		free.pop_back();
+		return index;
+	}
+	uint32_t index = entry_count++;
+	size_t block = std::bit_width(index/first_block+1)-1;
+	if(blocks[block].load(std::memory_order_relaxed)==nullptr)
+		blocks[block].store(new Entry[first_block<<block],std::memory_order_release);
+	return index;
+}
+
+template<typename T, typename View>
+void BasicInternTable<T,View>::Shard::grow(){
+	std::vector<uint32_t> old = std::move(slots);
+	slots.assign(std::max<size_t>(old.size()*2,16),0);
+	size_t mask = slots.size()-1;
+	for(uint32_t occupant : old){
+		if(occupant==0)
+			continue;
+		size_t slot = (entry(occupant-1).hash>>shard_bits)&mask;
+		while(slots[slot]!=0)
+			slot = (slot+1)&mask;
+		slots[slot] = occupant;
+	}
+}
+
+template<typename T, typename View>
+void BasicInternTable<T,View>::Shard::erase_slot(size_t slot){
+	// backward shift: pull later entries of the run into the hole, as long as that doesn't move
+	// one before its home slot, so every probe still finds what it's looking for without tombstones
+	size_t mask = slots.size()-1;
+	size_t hole = slot;
+	for(size_t next=(hole+1)&mask;slots[next]!=0;next=(next+1)&mask){
+		size_t home = (entry(slots[next]-1).hash>>shard_bits)&mask;
+		if(((next-home)&mask)>=((next-hole)&mask)){
+			slots[hole] = slots[next];
+			hole = next;
+		}
+	}
+	slots[hole] = 0;
+	count--;
+}
+
+template<typename T, typename View>
+BasicInternTable<T,View>::Shard::~Shard(){
+	for(std::atomic<Entry*>& block : blocks)
+		delete[] block.load();
+}
+
+template<typename T, typename View>
+BasicInternTable<T,View>::BasicInternTable():shards(new Shard[shard_count]){
+	// id 0 (index 0 of shard 0) is the default value; it's never in an index, so it's never found or freed
+	shards[0].add_entry();
+}
+
+template<typename T, typename View>
+size_t BasicInternTable<T,View>::hash(View value){
+	return std::hash<std::remove_cvref_t<View>>()(value);
+}
+
+template<typename T, typename View>
+typename BasicInternTable<T,View>::Entry& BasicInternTable<T,View>::entry(id_t id) const {
+	return shards[id&(shard_count-1)].entry(id>>shard_bits);
+}
+
+template<typename T, typename View>
+typename BasicInternTable<T,View>::id_t BasicInternTable<T,View>::intern(View value){
+	static const T default_value;
+	if(value==default_value)
+		return 0;
+	size_t h = hash(value);
+	size_t shard_index = h&(shard_count-1);
+	Shard& shard = shards[shard_index];
+	std::lock_guard lock(shard.mtx);
+	// grown first, so that the slot the probe ends on is where a new string goes
+	if((shard.count+1)*2>shard.slots.size())
+		shard.grow();
+	size_t mask = shard.slots.size()-1;
+	for(size_t slot=(h>>shard_bits)&mask;;slot=(slot+1)&mask){
+		uint32_t occupant = shard.slots[slot];
+		if(occupant==0){
+			uint32_t index = shard.add_entry();
+			Entry& fresh = shard.entry(index);
+			fresh.value = T(value);
+			fresh.hash = h;
+			fresh.refs.store(1,std::memory_order_relaxed);
+			fresh.live = true;
+			shard.slots[slot] = index+1;
+			shard.count++;
+			return (id_t(index)<<shard_bits)|shard_index;
+		}
+		Entry& found = shard.entry(occupant-1);
+		if(found.hash==h && found.value==value){
+			// may revive an entry whose last reference is being released; reclaim checks again under the lock
+			found.refs.fetch_add(1,std::memory_order_relaxed);
+			return (id_t(occupant-1)<<shard_bits)|shard_index;
+		}
+	}
+}
+
+template<typename T, typename View>
+const T& BasicInternTable<T,View>::get(id_t id) const {
+	return entry(id).value;
+}
+
+template<typename T, typename View>
+void BasicInternTable<T,View>::retain(id_t id){
+	if(id!=0)
+		entry(id).refs.fetch_add(1,std::memory_order_relaxed);
+}
+
+template<typename T, typename View>
+void BasicInternTable<T,View>::release(id_t id){
+	if(id!=0 && entry(id).refs.fetch_sub(1,std::memory_order_acq_rel)==1)
+		reclaim(id);
+}
+
+template<typename T, typename View>
+void BasicInternTable<T,View>::reclaim(id_t id){
+	Shard& shard = shards[id&(shard_count-1)];
+	uint32_t index = id>>shard_bits;
+	std::lock_guard lock(shard.mtx);
+	Entry& dead = shard.entry(index);
+	// someone may have interned it again, or freed it already, since the count reached zero
+	if(!dead.live || dead.refs.load(std::memory_order_acquire)!=0)
+		return;
+	size_t mask = shard.slots.size()-1;
+	size_t slot = (dead.hash>>shard_bits)&mask;
+	while(shard.slots[slot]!=index+1)
+		slot = (slot+1)&mask;
+	shard.erase_slot(slot);
+	dead.live = false;
+	dead.value = T();
+	shard.free.push_back(index);
+}
+
+template<typename T, typename View>
+size_t BasicInternTable<T,View>::size() const {
+	size_t ret = 1;
+	for(size_t n=0;n<shard_count;n++){
+		std::lock_guard lock(shards[n].mtx);
+		ret += shards[n].count;
+	}
+	return ret;
+}
+
+template class BasicInternTable<string,std::string_view>;
+template class BasicInternTable<BigInt>;
+template class BasicInternTable<Fraction>;
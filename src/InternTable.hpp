@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+using std::string;
+
+// Interned values with reference counts, shared by every thread. An id stays valid, and get() keeps
+// returning the same value, for as long as someone holds a reference to it (intern returns one;
+// retain and release add and drop them). When the last reference goes, the entry is freed and its
+// id can be handed out again. Id 0 is the default value (like the empty string), which is never freed.
+//
+// The table is split into shards by hash, each with its own lock and its own open addressing index,
+// so threads interning different values rarely contend. Lookups take a View (a string_view, for
+// strings) and probe the index once, inserting into the empty slot they end on if the value is new.
+// get, retain and release (unless it drops the last reference) take no lock at all.
+template<typename T, typename View=const T&> class BasicInternTable{
+public:
+	typedef uint64_t id_t;
+
+private:
+	static constexpr size_t shard_bits = 6;
+	static constexpr size_t shard_count = size_t(1)<<shard_bits;
+	// entries are kept in blocks that never move, the nth holding first_block<<n
+	static constexpr size_t first_block = 64;
+	static constexpr size_t max_blocks = 32;
+
+	struct Entry{
+		T value;
+		size_t hash = 0;
+		std::atomic<uint32_t> refs = 0;
+		bool live = false;
+	};
+
+	struct Shard{
+		std::mutex mtx;
+		// entry index+1 for each slot, or 0 if it's empty; a power of two in size
+		std::vector<uint32_t> slots;
+		size_t count = 0;
+		std::array<std::atomic<Entry*>,max_blocks> blocks = {};
+		uint32_t entry_count = 0;
+		std::vector<uint32_t> free;
+
+		Entry& entry(uint32_t index) const;
+		uint32_t add_entry();
+		void grow();
+		void erase_slot(size_t slot);
+		~Shard();
+	};
+	std::unique_ptr<Shard[]> shards;
+
+	static size_t hash(View value);
+	Entry& entry(id_t id) const;
+	void reclaim(id_t id);
+
+public:
+	BasicInternTable();
+	BasicInternTable(const BasicInternTable&)=delete;
+	BasicInternTable& operator=(const BasicInternTable&)=delete;
+
+	// the id of value, interning it if it isn't already; the caller owns one reference to it
+	id_t intern(View value);
+	// the value of an id the caller holds a reference to
+	const T& get(id_t id) const;
+	void retain(id_t id);
+	void release(id_t id);
+
+	// the number of values currently interned (including the default value)
+	size_t size() const;
+};
+
+// Symbol names
+typedef BasicInternTable<string,std::string_view> InternTable;
@@ -0,0 +1,263 @@
+#include "NativeProgram.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/stat.h>
+
+// translates the bytecode into straight-line code, one local per stack slot value
+static string generate_source(const Program& program){
+	std::ostringstream src;
+	src<<"#include <cmath>\n#include <cfloat>\n";
+	src<<"extern \"C\" int symbolic_eval(const double* v, double* out){\n";
+	src<<"\tbool undefined = false;\n";
+
+	std::vector<string> stack;
+	size_t next = 0;
+	auto fresh = [&](){ return "t"+std::to_string(next++); };
+	char buf[64];
+	for(const Program::Instruction& ins : program.code()){
+		string t = fresh();
+		switch(ins.op){
+			case Program::CONST:
+				// hex float, so the constant is exact
+				snprintf(buf,sizeof(buf),"%a",program.constants()[ins.arg]);
+				src<<"\tconst double "<<t<<" = "<<buf<<";\n";
+				break;
+			case Program::VAR:
+				src<<"\tconst double "<<t<<" = v["<<ins.arg<<"];\n";
+				break;
+			case Program::UNDEF:
+				src<<"\tundefined = true;\n\tconst double "<<t<<" = 0;\n";
+				break;
+			case Program::ADD:
+			case Program::MUL:{
+				// same order as add_perform/mul_perform: start from 0 (or 1) and fold left to right
+				src<<"\tdouble "<<t<<" = "<<(ins.op==Program::ADD ? "0" : "1")<<";\n";
+				for(size_t n=stack.size()-ins.arg;n<stack.size();n++)
+					src<<"\t"<<t<<(ins.op==Program::ADD ? " += " : " *= ")<<stack[n]<<";\n";
+				stack.resize(stack.size()-ins.arg);
+				break;
+			}
+			case Program::SUB:
+				src<<"\tconst double "<<t<<" = "<<stack[stack.size()-2]<<" - "<<stack.back()<<";\n";
+				stack.resize(stack.size()-2);
+				break;
+			case Program::DIV:
+				src<<"\tif(std::fabs("<<stack.back()<<")<DBL_EPSILON) undefined = true;\n";
+				src<<"\tconst double "<<t<<" = "<<stack[stack.size()-2]<<" / "<<stack.back()<<";\n";
+				stack.resize(stack.size()-2);
+				break;
+			case Program::NEG:
+				src<<"\tconst double "<<t<<" = -"<<stack.back()<<";\n";
+				stack.pop_back();
+				break;
+			case Program::POW:
+				src<<"\tif("<<stack[stack.size()-2]<<"<0) undefined = true;\n";
+				src<<"\tconst double "<<t<<" = std::pow("<<stack[stack.size()-2]<<","<<stack.back()<<");\n";
+				stack.resize(stack.size()-2);
+				break;
+		}
+		stack.push_back(t);
+	}
+	src<<"\tif(undefined) return 0;\n";
+	src<<"\t*out = "<<stack.back()<<";\n";
+	src<<"\treturn 1;\n}\n";
+	return src.str();
+}
+
+// FNV-1a; the generated source is a function of the expression's structure and symbol order only,
+// so this is stable across runs (unlike Expr::hash, which mixes in Type addresses)
+static hash_t source_hash(const string& source){
+	hash_t h = 14695981039346656037ULL;
+	for(unsigned char c : source){
+		h ^= c;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static string compiler(){
+	if(const char* cxx = getenv("SYMBOLIC_CXX"))
+		return cxx;
+	if(const char* cxx = getenv("CXX"))
+		return cxx;
+	return "c++";
+}
+
+// whether path is a directory (not a link to one) that only this user can get into
+static bool is_private_dir(const string& path){
+	struct stat st;
+	return lstat(path.c_str(),&st)==0 && S_ISDIR(st.st_mode) && st.st_uid==geteuid() && (st.st_mode&077)==0;
+}
+
+// makes dir with mode 0700 if it isn't there; false if it can't, or if what's there isn't private
+static bool make_private_dir(const string& path){
+	if(mkdir(path.c_str(),0700)!=0 && errno!=EEXIST)
+		return false;
+	return is_private_dir(path);
+}
+
+// The directory compiled objects are cached in: $SYMBOLIC_CACHE_DIR, or symbolic under
+// $XDG_CACHE_HOME (by default ~/.cache), then native in that. Empty if there's no home, or if any
+// directory of ours in it isn't private, since anything in it gets loaded into the process.
+static string native_cache_dir(){
+	string root;
+	if(const char* dir = getenv("SYMBOLIC_CACHE_DIR"); dir!=nullptr && dir[0]=='/'){
+		root = dir;
+	}
+	else{
+		string base;
+		if(const char* xdg = getenv("XDG_CACHE_HOME"); xdg!=nullptr && xdg[0]=='/'){
+			base = xdg;
+		}
+		else{
+			const char* home = getenv("HOME");
+			if(home==nullptr || home[0]!='/'){
+				const passwd* pw = getpwuid(geteuid());
+				home = pw==nullptr ? nullptr : pw->pw_dir;
+			}
+			if(home==nullptr || home[0]!='/')
+				return "";
+			base = string(home)+"/.cache";
+			// ~/.cache is shared with other programs, so only needs to exist
+			if(mkdir(base.c_str(),0700)!=0 && errno!=EEXIST)
+				return "";
+		}
+		root = base+"/symbolic";
+	}
+	if(!make_private_dir(root))
+		return "";
+	string native = root+"/native";
+	if(!make_private_dir(native))
+		return "";
+	return native;
+}
+
+// compiled into every object next to symbolic_eval, so a cached object can be checked against the
+// source it's loaded for; the name only has a 64 bit hash of it
+static string embed_source(const string& source){
+	return source+"extern \"C\" const char symbolic_source[] = R\"symbolic("+source+")symbolic\";\n";
+}
+
+// dlopens path if it's a regular file of this user's that no one else can write to, and was compiled
+// from source
+static void* load_private_object(const string& path, const string& source){
+	int fd = open(path.c_str(),O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+	if(fd<0)
+		return nullptr;
+	struct stat st;
+	bool ok = fstat(fd,&st)==0 && S_ISREG(st.st_mode) && st.st_uid==geteuid() && (st.st_mode&022)==0;
+	close(fd);
+	if(!ok)
+		return nullptr;
+	void* handle = dlopen(path.c_str(),RTLD_NOW|RTLD_LOCAL);
+	if(handle==nullptr)
+		return nullptr;
+	const char* compiled = static_cast<const char*>(dlsym(handle,"symbolic_source"));
+	void* function = dlsym(handle,"symbolic_eval");
+	if(compiled==nullptr || compiled!=source || function==nullptr){
+		dlclose(handle);
+		return nullptr;
+	}
+	return function;
+}
+
+// compiles source into the cache (unless it's there already) and loads it; nullptr if it can't
+static void* compile_and_load(const string& source, hash_t key){
+	namespace fs = std::filesystem;
+	string dir = native_cache_dir();
+	if(dir.empty())
+		return nullptr;
+	char name[32];
+	snprintf(name,sizeof(name),"%016llx",static_cast<unsigned long long>(key));
+	string so = dir+"/"+name+".so";
+	// what's there may be from another source with the same hash (or from before sources were
+	// embedded); then it's rebuilt, and replaced
+	if(void* function = load_private_object(so,source))
+		return function;
+
+	// build under a name of this process and thread and rename into place, so concurrent builds never
+	// load a partial file
+	static std::atomic<unsigned> builds = 0;
+	string tag = string(name)+"-"+std::to_string(getpid())+"-"+std::to_string(builds++);
+	string cpp = dir+"/"+tag+".cpp";
+	string tmp = dir+"/"+tag+".so";
+	std::error_code ec;
+	std::ofstream(cpp)<<embed_source(source);
+	string command = compiler()+" -std=c++17 -O2 -ffp-contract=off -shared -fPIC -o '"+tmp+"' '"+cpp+"' >/dev/null 2>&1";
+	int status = system(command.c_str());
+	fs::remove(cpp,ec);
+	if(status!=0 || chmod(tmp.c_str(),0700)!=0){
+		fs::remove(tmp,ec);
+		return nullptr;
+	}
+	fs::rename(tmp,so,ec);
+	if(ec){
+		fs::remove(tmp,ec);
+		return nullptr;
+	}
+	return load_private_object(so,source);
+}
+
+// loaded functions, by their whole source; shared objects are never unloaded. Failures aren't kept, so
+// a compiler that's missing for a while only costs native code while it is.
+struct NativeCache{
+	std::mutex mtx;
+	std::unordered_map<string,void*> functions;
+};
+
+static NativeCache& native_cache(){
+	static NativeCache cache;
+	return cache;
+}
+
+NativeProgram::NativeProgram(const Expr& expr):_program(expr){
+	load();
+}
+
+NativeProgram::NativeProgram(const Expr& expr, std::vector<string> symbols):_program(expr,std::move(symbols)){
+	load();
+}
+
+void NativeProgram::load(){
+	_source = generate_source(_program);
+	_key = source_hash(_source);
+
+	NativeCache& cache = native_cache();
+	{
+		std::lock_guard lock(cache.mtx);
+		auto found = cache.functions.find(_source);
+		if(found!=cache.functions.end()){
+			_function = reinterpret_cast<function_t>(found->second);
+			return;
+		}
+	}
+
+	// without the lock, so other formulas don't wait on this one's compiler; if two threads build the
+	// same one, the first to finish is kept
+	void* function = compile_and_load(_source,_key);
+	if(function==nullptr)
+		return;
+	std::lock_guard lock(cache.mtx);
+	auto [entry,added] = cache.functions.emplace(_source,function);
+	_function = reinterpret_cast<function_t>(entry->second);
+}
+std::optional<float_value_t> NativeProgram::operator()(const float_value_t* values) const {
+	if(_function==nullptr)
+		return _program(values);
+	float_value_t out;
+	if(_function(values,&out)==0)
+		return std::nullopt;
+	return out;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Program.hpp"
+
+// A Program translated to C++, compiled into a shared object by the system compiler and loaded with
+// dlopen. Same semantics as Program (and so perform_approx). Shared objects are cached by the generated
+// source, in memory, and in a per-user directory ($SYMBOLIC_CACHE_DIR, or $XDG_CACHE_HOME/symbolic, by
+// default ~/.cache/symbolic) under a hash of it, so each formula is compiled once. Each object carries
+// its source, and one whose source doesn't match isn't used. The cache is made with mode 0700, and
+// nothing is loaded from it unless it and the object are owned by this user and private to them. If no
+// compiler is available (or compiling fails, or the cache isn't private) it interprets the Program
+// instead, and tries compiling again the next time. The compiler is taken from $SYMBOLIC_CXX, then
+// $CXX, then 'c++'.
+class NativeProgram{
+	Program _program;
+	typedef int (*function_t)(const float_value_t* values, float_value_t* out);
+	function_t _function = nullptr;
+	string _source;
+	hash_t _key = 0;
+
+	void load();
+
+public:
+	NativeProgram(const Expr& expr);
+	NativeProgram(const Expr& expr, std::vector<string> symbols);
+
+	const Program& program() const { return _program; }
+	const std::vector<string>& symbols() const { return _program.symbols(); }
+	// the generated C++
+	const string& source() const { return _source; }
+	// false if this fell back to the interpreter
+	bool is_native() const { return _function!=nullptr; }
+
+	// evaluates with values[n] bound to symbols()[n]; empty if the result is Undefined
+	std::optional<float_value_t> operator()(const float_value_t* values) const;
+};
@@ -0,0 +1,191 @@
+#include "Pipeline.hpp"
+#include "actions.hpp"
+#include "Tracer.hpp"
+
+#include <deque>
+#include <future>
+
+namespace{
+
+// what went wrong with a line, as the kernel would name it
+string describe(const std::exception& err){
+	if(const NamedError* named = dynamic_cast<const NamedError*>(&err))
+		return named->name+": "+named->what();
+	return string("std::runtime_error: ")+err.what();
+}
+
+struct Parsed{
+	Session::Line line;
+	Expr expr;
+};
+
+struct Printed{
+	string text;
+	string error;
+};
+
+template<typename T>
+struct Stage{
+	size_t number;
+	std::future<T> result;
+};
+
+// runs task on the group, with its result (or exception) delivered through a future
+template<typename T, typename F>
+std::future<T> submit(ThreadPool::TaskGroup& group, F task){
+	auto promise = std::make_shared<std::promise<T>>();
+	std::future<T> ret = promise->get_future();
+	group.run([promise,task=std::move(task)](){
+		try{
+			promise->set_value(task());
+		}
+		catch(...){
+			promise->set_exception(std::current_exception());
+		}
+	});
+	return ret;
+}
+
+template<typename T>
+std::future<T> ready(T value){
+	std::promise<T> promise;
+	promise.set_value(std::move(value));
+	return promise.get_future();
+}
+
+}
+
+Pipeline::Pipeline(Session& session, size_t workers, size_t depth):
+	session(session), pool(std::max<size_t>(workers,1)), group(pool), depth(std::max<size_t>(depth,1)) {}
+
+size_t Pipeline::run(std::istream& in, std::ostream& out, std::ostream& err, const string& source){
+	std::deque<Stage<Parsed>> parsing;
+	std::deque<Stage<Printed>> printing;
+	size_t errors = 0;
+
+	auto report = [&](size_t number, const string& error){
+		out.flush();
+		err<<source<<":"<<number<<": "<<error<<endl;
+		errors++;
+	};
+
+	auto print_one = [&](){
+		Stage<Printed> stage = std::move(printing.front());
+		printing.pop_front();
+		try{
+			Printed printed = stage.result.get();
+			out<<printed.text;
+			if(!printed.error.empty())
+				report(stage.number,printed.error);
+		}
+		catch(const std::exception& error){
+			report(stage.number,describe(error));
+		}
+	};
+
+	auto print = [&](size_t number, std::future<Printed> result){
+		if(printing.size()>=depth)
+			print_one();
+		printing.push_back({number,std::move(result)});
+	};
+
+	auto apply_one = [&](){
+		Stage<Parsed> stage = std::move(parsing.front());
+		parsing.pop_front();
+		Tracer::Span span("apply_line");
+		span.set_arg("line",stage.number);
+		try{
+			Parsed parsed = stage.result.get();
+			if(parsed.line.kind==Session::Line::COMMAND){
+				{
+					Arena arena;
+					Arena::Scope arena_scope(arena);
+					session.run_command(parsed.line);
+				}
+				print(stage.number,ready(Printed{session.output.str(),""}));
+				session.output.str("");
+			}
+			else if(parsed.line.kind==Session::Line::DECLARATION){
+				const string& name = parsed.line.name;
+				std::vector<string> recomputed = session.workspace.define(name,parsed.expr);
+				if(!session.echo_vars)
+					return;
+				recomputed.insert(recomputed.begin(),name);
+				// copied out here, since the workspace may change before the workers get to them
+				std::vector<std::pair<string,Expr>> values;
+				for(const string& each : recomputed)
+					values.emplace_back(each,session.workspace[each]);
+				bool perform = this->perform;
+				PrintLimits limits = session.print_limits;
+				print(stage.number,submit<Printed>(group,[values=std::move(values),perform,limits,number=stage.number](){
+					Tracer::Span span("print_line");
+					span.set_arg("line",number);
+					Arena arena;
+					Arena::Scope arena_scope(arena);
+					Printed printed;
+					try{
+						for(const auto& [name,value] : values)
+							printed.text += name+":\t"+to_string(perform ? ::perform(value) : value,limits)+"\n";
+					}
+					catch(const std::exception& error){
+						printed.error = describe(error);
+					}
+					return printed;
+				}));
+			}
+		}
+		catch(const std::exception& error){
+			// as in the kernel, a failed line prints only its error
+			session.output.str("");
+			print(stage.number,ready(Printed{"",describe(error)}));
+		}
+	};
+
+	string text;
+	size_t number = 0;
+	while(std::getline(in,text)){
+		number++;
+		if(Tracer::on())
+			Tracer::collect();
+		// a command can change how the lines around it are handled (like $profile or $trace), so every
+		// line before it is parsed, applied and printed first, and the lines after it wait for it
+		bool command = false;
+		try{
+			command = Session::split_line(text).kind==Session::Line::COMMAND;
+		}
+		catch(const std::exception&){
+			// reported when the line is parsed
+		}
+		if(command){
+			while(!parsing.empty())
+				apply_one();
+			while(!printing.empty())
+				print_one();
+		}
+		else if(parsing.size()>=depth)
+			apply_one();
+		parsing.push_back({number,submit<Parsed>(group,[text,number](){
+			Tracer::Span span("parse_line");
+			if(span.is_active()){
+				span.set_arg("line",number);
+				span.set_text(text);
+			}
+			Parsed parsed;
+			parsed.line = Session::split_line(text);
+			if(parsed.line.kind==Session::Line::DECLARATION)
+				parsed.expr = Expr(parsed.line.rest);
+			return parsed;
+		})});
+		if(command){
+			apply_one();
+			while(!printing.empty())
+				print_one();
+		}
+	}
+	while(!parsing.empty())
+		apply_one();
+	while(!printing.empty())
+		print_one();
+	out.flush();
+	return errors;
+}
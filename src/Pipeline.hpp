@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Session.hpp"
+#include "ThreadPool.hpp"
+
+#include <iostream>
+
+// Runs lines through a Session the way the kernel does, as a three stage pipeline: lines are split and
+// parsed on worker threads, applied to the session one at a time in input order (declarations and
+// commands see everything before them), and then echoed declarations are performed and printed on
+// worker threads again. Each stage holds at most depth lines, so memory stays bounded however long the
+// input is, and output (and each line's error) is written in input order. Echoes are printed within the
+// session's print_limits, as the kernel's are.
+class Pipeline{
+	Session& session;
+	ThreadPool pool;
+	ThreadPool::TaskGroup group;
+	size_t depth;
+
+public:
+	// perform echoed declarations before printing them; if off, they print as the kernel echoes them
+	bool perform = true;
+
+	Pipeline(Session& session, size_t workers=std::thread::hardware_concurrency(), size_t depth=64);
+
+	// Runs every line of in. Output goes to out, and each failed line is reported on err as
+	// "source:line: ErrorName: message". Returns the number of lines that failed.
+	size_t run(std::istream& in, std::ostream& out, std::ostream& err, const string& source="<stdin>");
+};
@@ -0,0 +1,346 @@
+#include "Polynomial.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+static void collect_symbols(const Expr& expr, std::set<string>& out){
+	if(expr.type()==Symbol)
+		out.insert(Symbol.value(expr));
+	for(const Expr& child : expr)
+		collect_symbols(child,out);
+}
+
+static std::vector<string> sorted_symbols(const Expr& expr){
+	std::set<string> symbols;
+	collect_symbols(expr,symbols);
+	return std::vector<string>(symbols.begin(),symbols.end());
+}
+
+static bool is_rational(const Expr& ex){
+	return ex.type().f_get_rational!=nullptr;
+}
+
+// whether ex can be a polynomial node, given that all of its children are polynomials
+static bool node_is_polynomial(const Expr& ex){
+	const Type& type = ex.type();
+	if(type==Symbol || is_rational(ex))
+		return true;
+	if(type==Add || type==Sub || type==Mul || type==Neg)
+		return true;
+	if(type==Div)
+		return is_rational(ex[1]) && !ex[1].type().f_get_rational(ex[1]).is_zero();
+	if(type==Pow)
+		return ex[1].type().f_get_int!=nullptr && ex[1].type().f_get_int(ex[1])>=0;
+	return false;
+}
+
+bool Polynomial::is_polynomial(const Expr& expr){
+	for(const Expr& child : expr){
+		if(!is_polynomial(child))
+			return false;
+	}
+	return node_is_polynomial(expr);
+}
+
+Polynomial::Polynomial(std::vector<string> symbols){
+	if(symbols.size()>MAX_SYMBOLS)
+		throw ExprError(Expr(),"a polynomial can have at most "+std::to_string(MAX_SYMBOLS)+" symbols");
+	_bits = symbols.empty() ? 64 : 64/symbols.size();
+	_symbols = std::make_shared<const std::vector<string>>(std::move(symbols));
+}
+
+Polynomial::Polynomial(const Expr& expr):Polynomial(expr,sorted_symbols(expr)){}
+
+Polynomial::Polynomial(const Expr& expr, std::vector<string> symbols):Polynomial(std::move(symbols)){
+	if(!is_polynomial(expr))
+		throw ExprError(expr,"not a polynomial");
+	_terms = convert(expr)._terms;
+}
+
+Polynomial Polynomial::convert(const Expr& expr) const {
+	const Type& type = expr.type();
+	Polynomial ret = zero();
+	if(type==Symbol){
+		string name = Symbol.value(expr);
+		auto found = std::find(symbols().begin(),symbols().end(),name);
+		if(found==symbols().end())
+			throw ExprError(expr,"symbol '"+name+"' is not one of the polynomial's symbols");
+		ret._terms.emplace(monomial_t(1)<<((found-symbols().begin())*_bits),BigInt(1));
+	}
+	else if(is_rational(expr)){
+		ret.add_term(0,type.f_get_rational(expr));
+	}
+	else if(type==Add){
+		for(const Expr& child : expr)
+			ret += convert(child);
+	}
+	else if(type==Mul){
+		ret.add_term(0,BigInt(1));
+		for(const Expr& child : expr)
+			ret = ret*convert(child);
+	}
+	else if(type==Sub){
+		ret = convert(expr[0])-convert(expr[1]);
+	}
+	else if(type==Neg){
+		ret = -convert(expr[0]);
+	}
+	else if(type==Div){
+		ret = convert(expr[0]);
+		ret *= Fraction(1)/expr[1].type().f_get_rational(expr[1]);
+	}
+	else if(type==Pow){
+		ret = convert(expr[0]).pow(expr[1].type().f_get_int(expr[1]));
+	}
+	else{
+		throw ExprError(expr,"not a polynomial");
+	}
+	return ret;
+}
+
+void Polynomial::add_term(monomial_t monomial, const Fraction& coefficient){
+	if(coefficient.is_zero())
+		return;
+	auto [found,inserted] = _terms.try_emplace(monomial,coefficient);
+	if(!inserted){
+		found->second += coefficient;
+		if(found->second.is_zero())
+			_terms.erase(found);
+	}
+}
+
+std::vector<uint64_t> Polynomial::degrees() const {
+	std::vector<uint64_t> ret(symbols().size(),0);
+	for(const auto& [monomial,coefficient] : _terms){
+		for(size_t n=0;n<ret.size();n++)
+			ret[n] = std::max(ret[n],exponent(monomial,n));
+	}
+	return ret;
+}
+
+Polynomial::monomial_t Polynomial::monomial(const std::vector<uint64_t>& exponents) const {
+	ASSERT_EQUAL(exponents.size(),symbols().size());
+	monomial_t ret = 0;
+	for(size_t n=0;n<exponents.size();n++){
+		if(exponents[n]>field_mask())
+			throw ExprError(Expr(),"exponent "+std::to_string(exponents[n])+" is too large for a polynomial over "+std::to_string(symbols().size())+" symbols");
+		ret |= exponents[n]<<(n*_bits);
+	}
+	return ret;
+}
+
+Fraction Polynomial::coefficient(const std::vector<uint64_t>& exponents) const {
+	auto found = _terms.find(monomial(exponents));
+	return found==_terms.end() ? Fraction() : found->second;
+}
+
+Polynomial Polynomial::operator-() const {
+	Polynomial ret = *this;
+	for(auto& [monomial,coefficient] : ret._terms)
+		coefficient = -coefficient;
+	return ret;
+}
+
+Polynomial& Polynomial::operator+=(const Polynomial& b){
+	ASSERT(symbols()==b.symbols());
+	for(const auto& [monomial,coefficient] : b._terms)
+		add_term(monomial,coefficient);
+	return *this;
+}
+
+Polynomial& Polynomial::operator-=(const Polynomial& b){
+	ASSERT(symbols()==b.symbols());
+	for(const auto& [monomial,coefficient] : b._terms)
+		add_term(monomial,-coefficient);
+	return *this;
+}
+
+Polynomial& Polynomial::operator*=(const Fraction& b){
+	if(b.is_zero()){
+		_terms.clear();
+		return *this;
+	}
+	for(auto& [monomial,coefficient] : _terms)
+		coefficient *= b;
+	return *this;
+}
+
+size_t Polynomial::coefficient_bits() const {
+	size_t ret = 0;
+	for(const auto& [monomial,coefficient] : _terms)
+		ret = std::max(ret,coefficient.numerator().bit_length()+coefficient.denominator().bit_length());
+	return ret;
+}
+
+Polynomial operator*(const Polynomial& a, const Polynomial& b){
+	ASSERT(a.symbols()==b.symbols());
+	// packed monomials multiply by adding, which is only safe if no field can carry into the next
+	std::vector<uint64_t> da = a.degrees();
+	std::vector<uint64_t> db = b.degrees();
+	for(size_t n=0;n<da.size();n++){
+		if(db[n]>a.field_mask()-da[n])
+			throw ExprError(Expr(),"exponent of '"+a.symbols()[n]+"' is too large for a polynomial over "+std::to_string(da.size())+" symbols");
+	}
+
+	if(a.is_zero() || b.is_zero())
+		return a.zero();
+	if(b.term_count()>Polynomial::max_products/a.term_count())
+		throw ExprError(Expr(),"product of polynomials with "+std::to_string(a.term_count())+" and "+std::to_string(b.term_count())+" terms is too large to expand");
+	size_t products = a.term_count()*b.term_count();
+	size_t words = (a.coefficient_bits()+b.coefficient_bits())/64+1;
+	if(words>Polynomial::max_work/products/words)
+		throw ExprError(Expr(),"product of polynomials with "+std::to_string(a.term_count())+" and "+std::to_string(b.term_count())+" terms has coefficients too large to expand");
+
+	const Polynomial& outer = a.term_count()<=b.term_count() ? a : b;
+	const Polynomial& inner = &outer==&a ? b : a;
+	Polynomial ret = a.zero();
+	ret._terms.reserve(std::min<size_t>(products,size_t(1)<<20));
+	for(const auto& [ma,ca] : outer._terms){
+		for(const auto& [mb,cb] : inner._terms)
+			ret.add_term(ma+mb,ca*cb);
+	}
+	return ret;
+}
+
+Polynomial Polynomial::pow(uint64_t exponent) const {
+	for(uint64_t degree : degrees()){
+		if(degree>0 && exponent>field_mask()/degree)
+			throw ExprError(Expr(),"power "+std::to_string(exponent)+" is too large for a polynomial over "+std::to_string(symbols().size())+" symbols");
+	}
+	Polynomial ret = zero();
+	ret.add_term(0,BigInt(1));
+	Polynomial base = *this;
+	while(exponent){
+		if(exponent&1)
+			ret = ret*base;
+		exponent >>= 1;
+		if(exponent)
+			base = base*base;
+	}
+	return ret;
+}
+
+// one term: each symbol's power in symbol order, then the coefficient (left out if 1)
+static Expr term_to_expr(const Polynomial& poly, Polynomial::monomial_t monomial, const Fraction& coefficient){
+	Expr ret = Mul();
+	for(size_t n=0;n<poly.symbols().size();n++){
+		uint64_t e = poly.exponent(monomial,n);
+		if(e==1)
+			ret.add_child(Symbol(poly.symbols()[n]));
+		else if(e>1)
+			ret.add_child(Pow(Symbol(poly.symbols()[n]),Integer(e)));
+	}
+	if(ret.child_count()==0)
+		return Expr(coefficient);
+	if(coefficient!=Fraction(1))
+		ret.add_child(Expr(coefficient));
+	if(ret.child_count()==1)
+		return ret[0];
+	return ret;
+}
+
+Expr Polynomial::to_expr() const {
+	// highest total degree first, then by exponents in symbol order
+	std::vector<std::pair<std::vector<uint64_t>,const std::pair<const monomial_t,Fraction>*>> order;
+	order.reserve(_terms.size());
+	for(const auto& term : _terms){
+		std::vector<uint64_t> key;
+		key.reserve(symbols().size()+1);
+		uint64_t total = 0;
+		for(size_t n=0;n<symbols().size();n++)
+			total += exponent(term.first,n);
+		key.push_back(total);
+		for(size_t n=0;n<symbols().size();n++)
+			key.push_back(exponent(term.first,n));
+		order.emplace_back(std::move(key),&term);
+	}
+	std::sort(order.begin(),order.end(),[](const auto& a, const auto& b){ return a.first>b.first; });
+
+	if(order.empty())
+		return Integer(0);
+	if(order.size()==1)
+		return term_to_expr(*this,order[0].second->first,order[0].second->second);
+	Expr ret = Add();
+	for(const auto& [key,term] : order)
+		ret.add_child(term_to_expr(*this,term->first,term->second));
+	return ret;
+}
+
+Expr Polynomial::collect(const string& symbol) const {
+	auto found = std::find(symbols().begin(),symbols().end(),symbol);
+	if(found==symbols().end())
+		return to_expr();
+	size_t index = found-symbols().begin();
+	monomial_t field = field_mask()<<(index*_bits);
+
+	std::map<uint64_t,Polynomial,std::greater<uint64_t>> groups;
+	for(const auto& [monomial,coefficient] : _terms){
+		auto group = groups.try_emplace(exponent(monomial,index),zero()).first;
+		group->second.add_term(monomial&~field,coefficient);
+	}
+
+	Expr ret = Add();
+	for(const auto& [power,group] : groups){
+		Expr coefficient = group.to_expr();
+		if(power==0){
+			if(coefficient.type()==Add){
+				for(const Expr& term : coefficient)
+					ret.add_child(term);
+			}
+			else{
+				ret.add_child(coefficient);
+			}
+			continue;
+		}
+		Expr term = Mul(power==1 ? Symbol(symbol) : Pow(Symbol(symbol),Integer(power)));
+		if(coefficient.type()==Mul){
+			for(const Expr& factor : coefficient)
+				term.add_child(factor);
+		}
+		else if(coefficient!=Integer(1)){
+			term.add_child(coefficient);
+		}
+		ret.add_child(term.child_count()==1 ? Expr(term[0]) : term);
+	}
+	if(ret.child_count()==1)
+		return ret[0];
+	return ret;
+}
+
+// returns whether ex is a polynomial; if not, its polynomial children have been expanded
+static bool expand_subtrees(Expr& ex){
+	std::vector<bool> polynomial(ex.child_count());
+	bool all = true;
+	for(size_t n=0;n<ex.child_count();n++){
+		polynomial[n] = expand_subtrees(ex[n]);
+		all = all && polynomial[n];
+	}
+	if(all && node_is_polynomial(ex))
+		return true;
+	for(size_t n=0;n<ex.child_count();n++){
+		if(polynomial[n] && ex[n].child_count()>0){
+			// too many symbols or too high a power to pack; left as it is
+			try{
+				ex[n] = Polynomial(ex[n]).to_expr();
+			}
+			catch(const ExprError&){}
+		}
+	}
+	return false;
+}
+
+void _expand(Expr& expr){
+	if(expand_subtrees(expr) && expr.child_count()>0){
+		try{
+			expr = Polynomial(expr).to_expr();
+		}
+		catch(const ExprError&){}
+	}
+}
+
+const Action& make_expand(){
+	static ModAction act(_expand);
+	return act;
+}
+const Action& expand = make_expand();
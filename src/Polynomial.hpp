@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Expr.hpp"
+#include "actions.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Sparse multivariate polynomial with exact (Fraction) coefficients, as a hash map from monomials to
+// coefficients. A monomial packs the exponent of every symbol into one uint64_t, 64/symbols().size()
+// bits each, so multiplying two monomials is one integer add (a Kronecker substitution). Operations
+// that would overflow a field throw ExprError instead, and so do products past a budget (max_products
+// term products, or max_work weighted by the size of the coefficients), so expanding something like
+// (x+1)^1000000 gives up within a second or so rather than hanging. Both operands of an operation must
+// be over the same symbols.
+class Polynomial{
+public:
+	typedef uint64_t monomial_t;
+	// at most this many symbols (one bit of exponent each)
+	static constexpr size_t MAX_SYMBOLS = 64;
+	// most term products one multiplication may do (and so most terms its result can have)
+	inline static size_t max_products = size_t(1)<<22;
+	// most work one multiplication may do: its term products, each weighted by the square of the
+	// size of its coefficients in 64 bit words (about what multiplying and reducing them costs)
+	inline static size_t max_work = size_t(1)<<26;
+
+private:
+	// shared by every polynomial derived from the same conversion
+	std::shared_ptr<const std::vector<string>> _symbols;
+	uint32_t _bits = 64;
+	// never holds a zero coefficient
+	std::unordered_map<monomial_t,Fraction> _terms;
+
+	Polynomial(std::shared_ptr<const std::vector<string>> symbols, uint32_t bits):_symbols(std::move(symbols)),_bits(bits){}
+	// the zero polynomial over the same symbols
+	Polynomial zero() const { return Polynomial(_symbols,_bits); }
+	uint64_t field_mask() const { return _bits==64 ? ~uint64_t(0) : (uint64_t(1)<<_bits)-1; }
+	void add_term(monomial_t monomial, const Fraction& coefficient);
+	Polynomial convert(const Expr& expr) const;
+	// largest exponent of each symbol
+	std::vector<uint64_t> degrees() const;
+	// most bits any coefficient takes (numerator and denominator together)
+	size_t coefficient_bits() const;
+
+public:
+	// the zero polynomial; throws ExprError for more than MAX_SYMBOLS symbols
+	explicit Polynomial(std::vector<string> symbols);
+	// over the symbols of expr, in sorted order; throws ExprError if expr isn't a polynomial
+	explicit Polynomial(const Expr& expr);
+	Polynomial(const Expr& expr, std::vector<string> symbols);
+
+	// if expr is built from Symbols and exact constants with Add, Sub, Mul, Neg, Div by a nonzero
+	// constant and Pow to a non-negative integer constant
+	static bool is_polynomial(const Expr& expr);
+
+	const std::vector<string>& symbols() const { return *_symbols; }
+	size_t term_count() const { return _terms.size(); }
+	bool is_zero() const { return _terms.empty(); }
+	const std::unordered_map<monomial_t,Fraction>& terms() const { return _terms; }
+	uint64_t exponent(monomial_t monomial, size_t symbol) const { return (monomial>>(symbol*_bits))&field_mask(); }
+	// throws ExprError if an exponent doesn't fit
+	monomial_t monomial(const std::vector<uint64_t>& exponents) const;
+	Fraction coefficient(const std::vector<uint64_t>& exponents) const;
+
+	Polynomial operator-() const;
+	Polynomial& operator+=(const Polynomial& b);
+	Polynomial& operator-=(const Polynomial& b);
+	Polynomial& operator*=(const Fraction& b);
+	friend Polynomial operator+(Polynomial a, const Polynomial& b){ return a+=b; }
+	friend Polynomial operator-(Polynomial a, const Polynomial& b){ return a-=b; }
+	friend Polynomial operator*(const Polynomial& a, const Polynomial& b);
+	Polynomial pow(uint64_t exponent) const;
+	bool operator==(const Polynomial& b) const { return symbols()==b.symbols() && _terms==b._terms; }
+
+	// the expanded sum, highest total degree first, each term as its symbols' powers then the coefficient
+	Expr to_expr() const;
+	// sum of c_k*symbol^k, highest k first, with each c_k expanded over the other symbols
+	Expr collect(const string& symbol) const;
+};
+
+// Replaces every maximal polynomial subtree with its expansion (through Polynomial), leaving the rest
+// of the tree alone. A faster alternative to expanding products of sums through the tree.
+extern const Action& expand;
@@ -0,0 +1,150 @@
+#include "Profiler.hpp"
+#include "Type.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Each thread counts into its own table, so threads never wait on each other while profiling; the
+// tables are only summed up when they're read. A table outlives its thread, to keep its counts.
+struct ThreadTable{
+	std::mutex mtx;
+	std::unordered_map<const Type*,Profiler::Counters> counters[Profiler::PHASE_COUNT];
+};
+
+struct AllTables{
+	std::mutex mtx;
+	std::vector<std::shared_ptr<ThreadTable>> tables;
+};
+
+static AllTables& all_tables(){
+	// leaked, since threads can still be recording as statics are destroyed
+	static AllTables* all = new AllTables;
+	return *all;
+}
+
+static ThreadTable& thread_table(){
+	thread_local std::shared_ptr<ThreadTable> table = [](){
+		auto ret = std::make_shared<ThreadTable>();
+		AllTables& all = all_tables();
+		std::lock_guard lock(all.mtx);
+		all.tables.push_back(ret);
+		return ret;
+	}();
+	return *table;
+}
+
+static uint64_t now_ns(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::Scope::start(){
+	outer = _current;
+	_current = this;
+	start_allocations = _allocations;
+	start_ns = now_ns();
+}
+
+void Profiler::Scope::finish(){
+	uint64_t ns = now_ns()-start_ns;
+	uint64_t allocations = _allocations-start_allocations;
+	_current = outer;
+	if(type==nullptr && outer!=nullptr && outer->phase==phase){
+		// part of the outer Scope's own time, rather than a call of the phase
+		outer->inner_ns += inner_ns;
+		outer->inner_allocations += inner_allocations;
+		return;
+	}
+	if(outer!=nullptr){
+		outer->inner_ns += ns;
+		outer->inner_allocations += allocations;
+	}
+	Counters counters;
+	counters.calls = 1;
+	counters.nodes = nodes;
+	counters.allocations = allocations-inner_allocations;
+	counters.ns = ns-inner_ns;
+	record(phase,type,counters);
+}
+
+void Profiler::record(Phase phase, const Type* type, const Counters& counters){
+	ThreadTable& table = thread_table();
+	std::lock_guard lock(table.mtx);
+	table.counters[phase][type] += counters;
+}
+
+void Profiler::reset(){
+	AllTables& all = all_tables();
+	std::lock_guard lock(all.mtx);
+	for(const auto& table : all.tables){
+		std::lock_guard table_lock(table->mtx);
+		for(auto& counters : table->counters)
+			counters.clear();
+	}
+}
+
+// every thread's counters for one phase, added together
+static std::unordered_map<const Type*,Profiler::Counters> sum_phase(Profiler::Phase phase){
+	std::unordered_map<const Type*,Profiler::Counters> ret;
+	AllTables& all = all_tables();
+	std::lock_guard lock(all.mtx);
+	for(const auto& table : all.tables){
+		std::lock_guard table_lock(table->mtx);
+		for(const auto& [type,counters] : table->counters[phase])
+			ret[type] += counters;
+	}
+	return ret;
+}
+
+Profiler::Counters Profiler::get(Phase phase, const Type* type){
+	auto summed = sum_phase(phase);
+	auto found = summed.find(type);
+	return found==summed.end() ? Counters() : found->second;
+}
+
+const char* Profiler::phase_name(Phase phase){
+	switch(phase){
+		case PARSE: return "parse";
+		case PERFORM: return "perform";
+		case PRINT: return "print";
+		default: return "?";
+	}
+}
+
+void Profiler::report(std::ostream& out){
+	char line[160];
+	for(int p=0;p<PHASE_COUNT;p++){
+		Phase phase = Phase(p);
+		auto summed = sum_phase(phase);
+		Counters total;
+		for(const auto& [type,counters] : summed){
+			total.ns += counters.ns;
+			total.allocations += counters.allocations;
+		}
+		auto whole = summed.find(nullptr);
+		if(whole!=summed.end()){
+			total.calls = whole->second.calls;
+			total.nodes = whole->second.nodes;
+		}
+		std::snprintf(line,sizeof(line),"%s: %llu calls, %llu nodes, %llu allocations, %.3f ms\n",phase_name(phase),
+			(unsigned long long)total.calls,(unsigned long long)total.nodes,(unsigned long long)total.allocations,total.ns/1e6);
+		out<<line;
+		if(summed.empty())
+			continue;
+
+		std::vector<std::pair<const Type*,Counters>> rows(summed.begin(),summed.end());
+		std::sort(rows.begin(),rows.end(),[](const auto& a, const auto& b){ return a.second.ns>b.second.ns; });
+		std::snprintf(line,sizeof(line),"  %-14s %10s %10s %12s %12s %10s\n","type","calls","nodes","allocations","ms","ns/node");
+		out<<line;
+		for(const auto& [type,counters] : rows){
+			std::snprintf(line,sizeof(line),"  %-14s %10llu %10llu %12llu %12.3f %10.1f\n",type==nullptr ? "(other)" : type->name,
+				(unsigned long long)counters.calls,(unsigned long long)counters.nodes,(unsigned long long)counters.allocations,
+				counters.ns/1e6,counters.nodes==0 ? 0.0 : double(counters.ns)/counters.nodes);
+			out<<line;
+		}
+	}
+}
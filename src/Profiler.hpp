@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+class Type;
+
+// Opt-in counters for where parsing, performing and printing spend their time, by Type. Each
+// instrumented call opens a Scope, which (while profiling is on) adds its calls, nodes, node
+// allocations and time to its phase and Type. Times and allocations are self: a Scope's own, less
+// those of the Scopes opened inside it on the same thread, so a phase's rows add up to its total. A
+// Scope without a Type is a whole call of its phase, unless it's inside another Scope of the same
+// phase, in which case it's just part of that one. While profiling is off a Scope is one relaxed load
+// and a branch; building with -DSYMBOLIC_NO_PROFILE removes even that.
+class Profiler{
+public:
+	enum Phase:uint8_t{PARSE,PERFORM,PRINT,PHASE_COUNT};
+
+	struct Counters{
+		uint64_t calls = 0;
+		uint64_t nodes = 0;
+		// children arrays allocated (on the heap or in an Arena)
+		uint64_t allocations = 0;
+		uint64_t ns = 0;
+		Counters& operator+=(const Counters& b){
+			calls += b.calls;
+			nodes += b.nodes;
+			allocations += b.allocations;
+			ns += b.ns;
+			return *this;
+		}
+	};
+
+	static bool on(){
+#ifdef SYMBOLIC_NO_PROFILE
+		return false;
+#else
+		return __builtin_expect(_on.load(std::memory_order_relaxed),false);
+#endif
+	}
+	static void set(bool on){ _on.store(on,std::memory_order_relaxed); }
+	// zeroes every counter, on every thread
+	static void reset();
+	// the counters of one phase and Type, summed over threads; nullptr is the phase's own time, outside
+	// of any Type's Scope (its calls and nodes are those of the phase as a whole)
+	static Counters get(Phase phase, const Type* type);
+	// a table per phase, of every Type with counts, slowest first
+	static void report(std::ostream& out);
+	static const char* phase_name(Phase phase);
+
+	static void count_allocation(){ _allocations++; }
+
+	class Scope{
+		Phase phase;
+		const Type* type;
+		bool active;
+		uint64_t nodes = 1;
+		uint64_t start_ns, start_allocations;
+		// what the Scopes opened inside this one took
+		uint64_t inner_ns = 0, inner_allocations = 0;
+		Scope* outer;
+
+		void start();
+		void finish();
+	public:
+		Scope(Phase phase, const Type* type):phase(phase),type(type),active(on()){
+			if(active)
+				start();
+		}
+		Scope(const Scope&)=delete;
+		Scope& operator=(const Scope&)=delete;
+		~Scope(){
+			if(active)
+				finish();
+		}
+		// whether this Scope is counting (so whether it's worth working out its nodes)
+		bool is_active() const { return active; }
+		// for when the type is only known partway through
+		void set_type(const Type* t){ type = t; }
+		// the nodes it covers; 1 unless set
+		void set_nodes(uint64_t n){ nodes = n; }
+	};
+
+private:
+	inline static std::atomic<bool> _on = false;
+	inline static thread_local uint64_t _allocations = 0;
+	inline static thread_local Scope* _current = nullptr;
+
+	static void record(Phase phase, const Type* type, const Counters& counters);
+};
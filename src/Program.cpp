@@ -0,0 +1,335 @@
+#include "Program.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+Program::Program(const Expr& expr){
+	compile(expr,true,0);
+}
+
+Program::Program(const Expr& expr, std::vector<string> symbols):_symbols(std::move(symbols)){
+	compile(expr,false,0);
+}
+
+void Program::compile(const Expr& expr, bool collect_symbols, size_t depth){
+	const Type& type = expr.type();
+	_max_stack = std::max(_max_stack,depth+1);
+
+	if(type==Symbol){
+		string name = Symbol.value(expr);
+		auto found = std::find(_symbols.begin(),_symbols.end(),name);
+		if(found==_symbols.end()){
+			if(!collect_symbols)
+				throw ExprError(expr,"no value is given for symbol '"+name+"'");
+			_symbols.push_back(name);
+			found = _symbols.end()-1;
+		}
+		_code.push_back({VAR,static_cast<uint32_t>(found-_symbols.begin())});
+		return;
+	}
+	if(type==Undefined){
+		_code.push_back({UNDEF,0});
+		return;
+	}
+	if(type.arity==Type::NULLARY){
+		if(type.f_get_float==nullptr)
+			throw ExprError(expr,string("cannot compile an expr of type ")+type.name);
+		_constants.push_back(type.f_get_float(expr));
+		_code.push_back({CONST,static_cast<uint32_t>(_constants.size()-1)});
+		return;
+	}
+
+	Op op;
+	if(type==Add)
+		op = ADD;
+	else if(type==Sub)
+		op = SUB;
+	else if(type==Mul)
+		op = MUL;
+	else if(type==Div)
+		op = DIV;
+	else if(type==Neg)
+		op = NEG;
+	else if(type==Pow)
+		op = POW;
+	else
+		throw ExprError(expr,string("cannot compile an expr of type ")+type.name);
+
+	for(size_t n=0;n<expr.child_count();n++){
+		compile(expr[n],collect_symbols,depth+n);
+	}
+	_code.push_back({op,static_cast<uint32_t>(expr.child_count())});
+}
+
+std::optional<float_value_t> Program::operator()(const float_value_t* values) const {
+	float_value_t stack_buf[32];
+	std::vector<float_value_t> stack_vec;
+	float_value_t* stack = stack_buf;
+	if(_max_stack>32){
+		stack_vec.resize(_max_stack);
+		stack = stack_vec.data();
+	}
+
+	// Undefined poisons everything above it (perform_approx can't fold a node with an Undefined child)
+	bool undefined = false;
+	size_t top = 0;
+	for(const Instruction& ins : _code){
+		switch(ins.op){
+			case CONST:
+				stack[top++] = _constants[ins.arg];
+				break;
+			case VAR:
+				stack[top++] = values[ins.arg];
+				break;
+			case UNDEF:
+				undefined = true;
+				stack[top++] = 0;
+				break;
+			case ADD:{
+				// same order as add_perform, starting from 0
+				float_value_t total = 0;
+				top -= ins.arg;
+				for(uint32_t n=0;n<ins.arg;n++)
+					total += stack[top+n];
+				stack[top++] = total;
+				break;
+			}
+			case MUL:{
+				float_value_t total = 1;
+				top -= ins.arg;
+				for(uint32_t n=0;n<ins.arg;n++)
+					total *= stack[top+n];
+				stack[top++] = total;
+				break;
+			}
+			case SUB:
+				top--;
+				stack[top-1] = stack[top-1]-stack[top];
+				break;
+			case DIV:
+				top--;
+				if(fabs(stack[top])<DBL_EPSILON)
+					undefined = true;
+				stack[top-1] = stack[top-1]/stack[top];
+				break;
+			case NEG:
+				stack[top-1] = -stack[top-1];
+				break;
+			case POW:
+				top--;
+				if(stack[top-1]<0)
+					undefined = true;
+				stack[top-1] = pow(stack[top-1],stack[top]);
+				break;
+		}
+	}
+	if(undefined)
+		return std::nullopt;
+	return stack[0];
+}
+
+void Program::operator()(const float_value_t* values, size_t rows, float_value_t* out, bool* defined) const {
+	size_t stride = _symbols.size();
+	for(size_t row=0;row<rows;row++){
+		std::optional<float_value_t> result = (*this)(values+row*stride);
+		defined[row] = result.has_value();
+		out[row] = result.value_or(NAN);
+	}
+}
+
+size_t Program::block_rows() const {
+	// the operand stack is max_stack blocks of doubles; keep it within ~16KB of a 32KB L1
+	constexpr size_t stack_budget = 16*1024;
+	size_t rows = stack_budget/(sizeof(float_value_t)*std::max<size_t>(_max_stack,1));
+	rows = std::clamp<size_t>(rows,16,1024);
+	return rows & ~size_t(3);
+}
+
+// vector kernels for evaluate_columns; lanes_t is 4 doubles, lowered to AVX2 or pairs of SSE2 ops.
+// The helpers are always inlined, even without optimization: called out of line from the AVX2 clone
+// of run_block they'd pass vectors in a different ABI than they were compiled for. So the warning about
+// that doesn't apply (it is reported at the end of the translation unit, so it stays off from here on).
+#pragma GCC diagnostic ignored "-Wpsabi"
+namespace{
+
+typedef float_value_t lanes_t __attribute__((vector_size(32)));
+typedef int64_t lane_mask_t __attribute__((vector_size(32)));
+constexpr size_t lane_count = sizeof(lanes_t)/sizeof(float_value_t);
+
+__attribute__((always_inline)) inline lanes_t load(const float_value_t* p){
+	lanes_t v;
+	memcpy(&v,p,sizeof(v));
+	return v;
+}
+
+__attribute__((always_inline)) inline void store(float_value_t* p, const lanes_t& v){
+	memcpy(p,&v,sizeof(v));
+}
+
+__attribute__((always_inline)) inline lanes_t splat(float_value_t x){
+	return lanes_t{x,x,x,x};
+}
+
+__attribute__((always_inline)) inline void mark(uint8_t* undefined, const lane_mask_t& mask){
+	for(size_t k=0;k<lane_count;k++)
+		undefined[k] |= mask[k]!=0;
+}
+
+struct BlockState{
+	const Program& program;
+	const float_value_t* const* columns;
+	size_t first_row;
+	size_t n;
+	float_value_t* scratch;
+	size_t stride;
+	uint8_t* undefined;
+};
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+__attribute__((target_clones("avx2","default")))
+#endif
+void run_block(const BlockState& st){
+	const Program& prog = st.program;
+	const size_t n = st.n;
+	// operands are read straight from the input columns; results go to this slot's scratch block
+	const float_value_t* operand[64];
+	std::vector<const float_value_t*> big_stack;
+	const float_value_t** stack = operand;
+	if(prog.max_stack()>64){
+		big_stack.resize(prog.max_stack());
+		stack = big_stack.data();
+	}
+	auto slot = [&](size_t s){ return st.scratch+s*st.stride; };
+
+	size_t top = 0;
+	for(const Program::Instruction& ins : prog.code()){
+		switch(ins.op){
+			case Program::CONST:{
+				float_value_t* dst = slot(top);
+				float_value_t c = prog.constants()[ins.arg];
+				for(size_t i=0;i<n;i++)
+					dst[i] = c;
+				stack[top++] = dst;
+				break;
+			}
+			case Program::VAR:
+				stack[top++] = st.columns[ins.arg]+st.first_row;
+				break;
+			case Program::UNDEF:{
+				float_value_t* dst = slot(top);
+				for(size_t i=0;i<n;i++){
+					dst[i] = 0;
+					st.undefined[i] = 1;
+				}
+				stack[top++] = dst;
+				break;
+			}
+			case Program::ADD:
+			case Program::MUL:{
+				// same order as the scalar program: start from 0 (or 1) and fold left to right.
+				// dst is the first operand's slot, which is fine since every step is elementwise.
+				top -= ins.arg;
+				float_value_t* dst = slot(top);
+				lanes_t start = splat(ins.op==Program::ADD ? 0 : 1);
+				if(ins.arg==0){
+					for(size_t i=0;i<n;i++)
+						dst[i] = start[0];
+				}
+				for(uint32_t k=0;k<ins.arg;k++){
+					const float_value_t* acc = k==0 ? nullptr : dst;
+					const float_value_t* b = stack[top+k];
+					size_t i=0;
+					for(;i+lane_count<=n;i+=lane_count){
+						lanes_t a = acc==nullptr ? start : load(acc+i);
+						store(dst+i,ins.op==Program::ADD ? a+load(b+i) : a*load(b+i));
+					}
+					for(;i<n;i++){
+						float_value_t a = acc==nullptr ? start[0] : acc[i];
+						dst[i] = ins.op==Program::ADD ? a+b[i] : a*b[i];
+					}
+				}
+				stack[top++] = dst;
+				break;
+			}
+			case Program::SUB:{
+				top--;
+				float_value_t* dst = slot(top-1);
+				const float_value_t* a = stack[top-1];
+				const float_value_t* b = stack[top];
+				size_t i=0;
+				for(;i+lane_count<=n;i+=lane_count)
+					store(dst+i,load(a+i)-load(b+i));
+				for(;i<n;i++)
+					dst[i] = a[i]-b[i];
+				stack[top-1] = dst;
+				break;
+			}
+			case Program::DIV:{
+				top--;
+				float_value_t* dst = slot(top-1);
+				const float_value_t* a = stack[top-1];
+				const float_value_t* b = stack[top];
+				const lane_mask_t abs_bits = {INT64_MAX,INT64_MAX,INT64_MAX,INT64_MAX};
+				size_t i=0;
+				for(;i+lane_count<=n;i+=lane_count){
+					lanes_t vb = load(b+i);
+					lanes_t abs_b = (lanes_t)((lane_mask_t)vb & abs_bits);
+					mark(st.undefined+i,abs_b<splat(DBL_EPSILON));
+					store(dst+i,load(a+i)/vb);
+				}
+				for(;i<n;i++){
+					if(fabs(b[i])<DBL_EPSILON)
+						st.undefined[i] = 1;
+					dst[i] = a[i]/b[i];
+				}
+				stack[top-1] = dst;
+				break;
+			}
+			case Program::NEG:{
+				float_value_t* dst = slot(top-1);
+				const float_value_t* a = stack[top-1];
+				size_t i=0;
+				for(;i+lane_count<=n;i+=lane_count)
+					store(dst+i,-load(a+i));
+				for(;i<n;i++)
+					dst[i] = -a[i];
+				stack[top-1] = dst;
+				break;
+			}
+			case Program::POW:{
+				// no vector pow; this stays scalar
+				top--;
+				float_value_t* dst = slot(top-1);
+				const float_value_t* a = stack[top-1];
+				const float_value_t* b = stack[top];
+				for(size_t i=0;i<n;i++){
+					if(a[i]<0)
+						st.undefined[i] = 1;
+					dst[i] = pow(a[i],b[i]);
+				}
+				stack[top-1] = dst;
+				break;
+			}
+		}
+	}
+}
+
+}
+void Program::evaluate_columns(const float_value_t* const* columns, size_t rows, float_value_t* out, uint8_t* undefined) const {
+	size_t block = block_rows();
+	std::vector<float_value_t> scratch(block*std::max<size_t>(_max_stack,1));
+	for(size_t first=0;first<rows;first+=block){
+		size_t n = std::min(block,rows-first);
+		uint8_t* undef = undefined+first;
+		memset(undef,0,n);
+		run_block({*this,columns,first,n,scratch.data(),block,undef});
+		// the result is the only thing left on the stack: slot 0, or an input column for a bare symbol
+		const float_value_t* result = scratch.data();
+		if(_code.size()==1 && _code[0].op==VAR)
+			result = columns[_code[0].arg]+first;
+		for(size_t i=0;i<n;i++)
+			out[first+i] = undef[i] ? NAN : result[i];
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "Expr.hpp"
+
+// An expression compiled into a flat stack program over floats, for evaluating one formula over
+// many sets of symbol values without walking the tree. Supports Add, Sub, Mul, Div, Neg, Pow,
+// Integer, Float and Symbol, and gives the same result as perform_approx on the expression with
+// every symbol replaced by its value (including Undefined for division by zero or a negative base).
+class Program{
+public:
+	enum Op:uint8_t{CONST,VAR,ADD,SUB,MUL,DIV,NEG,POW,UNDEF};
+
+	struct Instruction{
+		Op op;
+		// CONST: index into constants; VAR: index into symbols; ADD/MUL: operand count
+		uint32_t arg;
+	};
+
+private:
+	std::vector<Instruction> _code;
+	std::vector<float_value_t> _constants;
+	std::vector<string> _symbols;
+	size_t _max_stack = 0;
+
+	void compile(const Expr& expr, bool collect_symbols, size_t depth);
+
+public:
+	// symbols are numbered in order of first appearance
+	Program(const Expr& expr);
+	// symbols are numbered as given; a symbol in expr that isn't listed is an error
+	Program(const Expr& expr, std::vector<string> symbols);
+
+	const std::vector<Instruction>& code() const { return _code; }
+	const std::vector<float_value_t>& constants() const { return _constants; }
+	const std::vector<string>& symbols() const { return _symbols; }
+	size_t max_stack() const { return _max_stack; }
+
+	// evaluates with values[n] bound to symbols()[n]; empty if the result is Undefined
+	std::optional<float_value_t> operator()(const float_value_t* values) const;
+
+	// evaluates rows of symbols().size() values each; defined[n] is false where out[n] is Undefined
+	void operator()(const float_value_t* values, size_t rows, float_value_t* out, bool* defined) const;
+
+	// columnar evaluation: columns[n] holds the rows values of symbols()[n]. Runs the program a block
+	// of rows at a time with vector kernels (AVX2 when the cpu has it); Undefined rows come out as NaN
+	// with undefined[row] set to 1.
+	void evaluate_columns(const float_value_t* const* columns, size_t rows, float_value_t* out, uint8_t* undefined) const;
+
+	// rows per block, sized so that the whole operand stack stays in L1
+	size_t block_rows() const;
+};
@@ -0,0 +1,233 @@
+#include "RuleSet.hpp"
+
+#include <algorithm>
+
+bool Rule::is_variable(const Expr& ex){
+	if(ex.type()!=Symbol)
+		return false;
+	const string& name = Symbol.value(ex);
+	return name.size()>1 && name.back()=='_';
+}
+
+static const Expr* find_binding(const Bindings& bindings, const Expr& variable){
+	for(const auto& [var,value] : bindings){
+		if(var==variable)
+			return &value;
+	}
+	return nullptr;
+}
+
+static bool match_pattern(const Expr& pattern, const Expr& ex, Bindings& bindings);
+
+// matches the children of pattern from index on to the unused children of ex, in any order
+static bool match_unordered(const Expr& pattern, const Expr& ex, size_t index, std::vector<bool>& used, Bindings& bindings){
+	if(index==pattern.child_count())
+		return true;
+	for(size_t n=0;n<ex.child_count();n++){
+		size_t mark = bindings.size();
+		if(used[n] || !match_pattern(pattern[index],ex[n],bindings))
+			continue;
+		used[n] = true;
+		if(match_unordered(pattern,ex,index+1,used,bindings))
+			return true;
+		used[n] = false;
+		bindings.resize(mark);
+	}
+	return false;
+}
+
+static bool match_pattern(const Expr& pattern, const Expr& ex, Bindings& bindings){
+	if(Rule::is_variable(pattern)){
+		if(const Expr* bound = find_binding(bindings,pattern))
+			return *bound==ex;
+		bindings.emplace_back(pattern,ex);
+		return true;
+	}
+	if(pattern.type()!=ex.type() || pattern.child_count()!=ex.child_count())
+		return false;
+	if(pattern.type().is_value_type())
+		return pattern==ex;
+
+	size_t mark = bindings.size();
+	if(pattern.type().is_commutative()){
+		std::vector<bool> used(ex.child_count(),false);
+		if(match_unordered(pattern,ex,0,used,bindings))
+			return true;
+	}
+	else{
+		size_t n = 0;
+		while(n<pattern.child_count() && match_pattern(pattern[n],ex[n],bindings))
+			n++;
+		if(n==pattern.child_count())
+			return true;
+	}
+	bindings.resize(mark);
+	return false;
+}
+
+static void check_bound(const Expr& right, const Bindings& bindings, const Expr& left){
+	if(Rule::is_variable(right) && find_binding(bindings,right)==nullptr)
+		throw ExprError(left,"the pattern doesn't bind '"+Symbol.value(right)+"'");
+	for(const Expr& child : right)
+		check_bound(child,bindings,left);
+}
+
+static void collect_variables(const Expr& pattern, Bindings& out){
+	if(Rule::is_variable(pattern) && find_binding(out,pattern)==nullptr)
+		out.emplace_back(pattern,pattern);
+	for(const Expr& child : pattern)
+		collect_variables(child,out);
+}
+
+Rule::Rule(Expr left, Expr right):left(promote(left)),right(promote(right)){
+	Bindings variables;
+	collect_variables(this->left,variables);
+	check_bound(this->right,variables,this->left);
+}
+
+bool Rule::match(const Expr& ex, Bindings& bindings) const {
+	return match_pattern(left,ex,bindings);
+}
+
+static Expr substitute_pattern(const Expr& pattern, const Bindings& bindings){
+	if(Rule::is_variable(pattern))
+		return *find_binding(bindings,pattern);
+	if(pattern.child_count()==0)
+		return pattern;
+	Expr ret = pattern.type()();
+	for(size_t n=0;n<pattern.child_count();n++)
+		ret.set_child(n,substitute_pattern(pattern[n],bindings));
+	return ret;
+}
+
+Expr Rule::substitute(const Bindings& bindings) const {
+	return substitute_pattern(right,bindings);
+}
+
+// one bottom up pass of at_root over ex (a rewritten node isn't revisited in the same pass); true if
+// anything was rewritten
+template<typename F>
+static bool rewrite_pass(Expr& ex, const F& at_root){
+	bool changed = false;
+	for(Expr& child : ex)
+		changed |= rewrite_pass(child,at_root);
+	return at_root(ex) || changed;
+}
+
+template<typename F>
+static void rewrite(Expr& ex, const F& at_root){
+	for(size_t pass=0;pass<Rule::max_passes && rewrite_pass(ex,at_root);pass++);
+}
+
+void Rule::in_place(Expr& ex) const {
+	rewrite(ex,[this](Expr& node){
+		Bindings bindings;
+		if(!match(node,bindings))
+			return false;
+		node = substitute(bindings);
+		return true;
+	});
+}
+
+Expr Rule::operator()(const Expr& ex) const {
+	Expr ret = ex;
+	in_place(ret);
+	return ret;
+}
+
+Expr Rule::operator()(Expr&& ex) const {
+	in_place(ex);
+	return ex;
+}
+
+size_t RuleSet::KeyHash::operator()(const Key& key) const {
+	hash_t h = Expr::hash_mix(reinterpret_cast<uintptr_t>(key.type),key.arity);
+	return Expr::hash_mix(h,key.value.hash());
+}
+
+RuleSet::Key RuleSet::key(const Expr& ex){
+	return Key{&ex.type(),ex.child_count(),ex.type().is_value_type() ? ex : Expr()};
+}
+
+void RuleSet::add(Rule rule){
+	// the left side in preorder, with variables and children of commutative types as wildcards
+	std::vector<const Expr*> pending = {&rule.left};
+	Node* node = &_root;
+	while(!pending.empty()){
+		const Expr* top = pending.back();
+		pending.pop_back();
+		if(top==nullptr || Rule::is_variable(*top)){
+			if(!node->any)
+				node->any = std::make_unique<Node>();
+			node = node->any.get();
+			continue;
+		}
+		std::unique_ptr<Node>& next = node->next[key(*top)];
+		if(!next)
+			next = std::make_unique<Node>();
+		node = next.get();
+		for(size_t n=top->child_count();n-->0;)
+			pending.push_back(top->type().is_commutative() ? nullptr : &(*top)[n]);
+	}
+	node->rules.push_back(_rules.size());
+	_rules.push_back(std::move(rule));
+}
+
+void RuleSet::clear(){
+	_rules.clear();
+	_root = Node();
+}
+
+void RuleSet::collect(const Node& node, std::vector<const Expr*>& pending, std::vector<size_t>& out) const {
+	if(pending.empty()){
+		out.insert(out.end(),node.rules.begin(),node.rules.end());
+		return;
+	}
+	const Expr* top = pending.back();
+	pending.pop_back();
+	if(node.any)
+		collect(*node.any,pending,out);
+	auto found = node.next.find(key(*top));
+	if(found!=node.next.end()){
+		size_t mark = pending.size();
+		for(size_t n=top->child_count();n-->0;)
+			pending.push_back(&(*top)[n]);
+		collect(*found->second,pending,out);
+		pending.resize(mark);
+	}
+	pending.push_back(top);
+}
+
+std::vector<size_t> RuleSet::candidates(const Expr& ex) const {
+	std::vector<size_t> ret;
+	std::vector<const Expr*> pending = {&ex};
+	collect(_root,pending,ret);
+	std::sort(ret.begin(),ret.end());
+	return ret;
+}
+
+bool RuleSet::rewrite_root(Expr& ex) const {
+	for(size_t index : candidates(ex)){
+		Bindings bindings;
+		if(_rules[index].match(ex,bindings)){
+			ex = _rules[index].substitute(bindings);
+			return true;
+		}
+	}
+	return false;
+}
+
+void RuleSet::in_place(Expr& ex) const {
+	rewrite(ex,[this](Expr& node){ return rewrite_root(node); });
+}
+
+Expr RuleSet::operator()(const Expr& ex) const {
+	Expr ret = ex;
+	in_place(ret);
+	return ret;
+}
+
+Expr RuleSet::operator()(Expr&& ex) const {
+	in_place(ex);
+	return ex;
+}
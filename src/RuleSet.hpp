@@ -0,0 +1,57 @@
+#pragma once
+
+#include "actions.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Rules indexed by a discrimination tree over their left sides, so each node is only matched against
+// the rules that could apply to it. The tree is keyed on the preorder of a pattern: each node by its
+// Type and child count (and value, for value types), with variables and the children of commutative
+// types as wildcards that skip a whole subtree. Rewrites like Rule, trying candidates in the order
+// they were added; the first that matches wins.
+class RuleSet : public Action{
+	struct Key{
+		const Type* type;
+		size_t arity;
+		// for value types; Undefined otherwise
+		Expr value;
+		bool operator==(const Key& b) const { return type==b.type && arity==b.arity && value==b.value; }
+	};
+	struct KeyHash{
+		size_t operator()(const Key& key) const;
+	};
+	struct Node{
+		std::unordered_map<Key,std::unique_ptr<Node>,KeyHash> next;
+		std::unique_ptr<Node> any;
+		// rules whose left side ends here
+		std::vector<size_t> rules;
+	};
+
+	std::vector<Rule> _rules;
+	Node _root;
+
+	static Key key(const Expr& ex);
+	// pending holds the subtrees not yet consumed, the next one last
+	void collect(const Node& node, std::vector<const Expr*>& pending, std::vector<size_t>& out) const;
+
+public:
+	RuleSet()=default;
+	RuleSet(const RuleSet&)=delete;
+	RuleSet& operator=(const RuleSet&)=delete;
+
+	void add(Rule rule);
+	size_t size() const { return _rules.size(); }
+	const std::vector<Rule>& rules() const { return _rules; }
+	void clear();
+
+	// indices of the rules that might match ex at its root, in the order they were added
+	std::vector<size_t> candidates(const Expr& ex) const;
+	// rewrites ex at its root with the first rule that matches; false if none does
+	bool rewrite_root(Expr& ex) const;
+
+	virtual Expr operator()(const Expr& ex) const override;
+	virtual Expr operator()(Expr&& ex) const override;
+	virtual void in_place(Expr& ex) const override;
+};
@@ -0,0 +1,86 @@
+#include "Session.hpp"
+#include "Tracer.hpp"
+
+#include <boost/regex.hpp>
+
+Session::Line Session::split_line(const string& line){
+
+	static const boost::regex command_rex("\\s*\\$\\s*(\\w+)(?:\\s+(.*))?");
+	static const boost::regex declare_rex("\\s*(\\w+)\\s*:\\s*(.*)");
+	static const boost::regex empty_rex("\\s*");
+
+	boost::smatch rex_results;
+
+	if(boost::regex_match(line,empty_rex)){
+		return Line{};
+	}
+	else if(boost::regex_match(line,rex_results,command_rex)){
+		return Line{Line::COMMAND,rex_results[1],rex_results[2]};
+	}
+	else if(boost::regex_match(line,rex_results,declare_rex)){
+		if(boost::regex_match(rex_results[2].str(),empty_rex)){
+			throw CommandError("Expected an expression after ':'");
+		}
+		return Line{Line::DECLARATION,rex_results[1],rex_results[2]};
+	}
+	else{
+		throw CommandError("Not a declaration or a command: '"+line+"'");
+	}
+}
+
+void Session::run_command(const Line& line){
+	if(Command::all.contains(line.name)){
+		Command& comm = Command::all[line.name];
+		comm.fptr(*this,line.rest);
+	}
+	else{
+		throw CommandError("Unknown command: "+line.name);
+	}
+}
+
+void Session::declare(const string& name, const Expr& expr){
+	std::vector<string> recomputed = workspace.define(name,expr);
+	if(echo_vars){
+		show(name,workspace[name]);
+		for(const string& dependent : recomputed)
+			show(dependent,workspace[dependent]);
+	}
+}
+
+void Session::apply(const string& name, Workspace::Transform transform){
+	std::vector<string> recomputed = workspace.transform(name,std::move(transform));
+	show(name,workspace[name]);
+	for(const string& dependent : recomputed)
+		show(dependent,workspace[dependent]);
+}
+
+PrintLimits Session::default_print_limits(){
+	// enough to read, but never so much that the front end stalls on it
+	PrintLimits limits;
+	limits.max_bytes = 64*1024;
+	limits.max_width = 1000;
+	return limits;
+}
+
+void Session::show(const string& name, const Expr& expr){
+	output<<name<<":\t";
+	print(output,expr,print_limits);
+	output<<endl;
+}
+
+void Session::consume_line(string line){
+	Tracer::Span span("line");
+	if(span.is_active())
+		span.set_text(line);
+
+	// scratch expressions for this line are built in one region and freed together;
+	// anything stored in the workspace is promoted out of it first
+	Arena arena;
+	Arena::Scope arena_scope(arena);
+
+	Line split = split_line(line);
+	if(split.kind==Line::COMMAND)
+		run_command(split);
+	else if(split.kind==Line::DECLARATION)
+		declare(split.name,Expr(split.rest));
+}
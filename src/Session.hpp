@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+using std::string;
+
+#include "Expr.hpp"
+#include "RuleSet.hpp"
+#include "Workspace.hpp"
+
+#include <sstream>
+
+using std::endl;
+
+struct Session;
+
+struct Command{
+	inline static std::unordered_map<string,Command> all;
+	string name;
+	string args;
+	string desc;
+	void (*fptr)(Session&,string);
+	Command()=default;
+	Command(string name, string args, string desc,void(*fptr)(Session&,string)):name(name),args(args),desc(desc),fptr(fptr){
+		all.emplace(name,*this);
+	}
+};
+
+struct CommandError : public NamedError{
+	CommandError(string what):NamedError("CommandError",std::move(what)){}
+};
+
+// Everything a line of input can see or change, without any of the Jupyter plumbing, so the kernel
+// and symbolic-batch read lines the same way. Output goes to output, to be taken by whoever is driving.
+struct Session{
+
+	std::ostringstream output;
+	Workspace workspace;
+	// added with $rule, applied with $rewrite
+	RuleSet rules;
+	bool echo_vars = true;
+	// how much of an expr is shown when it's echoed or printed by a command; set with $limits
+	PrintLimits print_limits = default_print_limits();
+	static PrintLimits default_print_limits();
+
+	// one line of input, split up the way consume_line reads it
+	struct Line{
+		enum Kind{BLANK,COMMAND,DECLARATION} kind = BLANK;
+		// the command or declared name, and everything after it
+		string name;
+		string rest;
+	};
+	// throws CommandError if the line is neither a declaration nor a command
+	static Line split_line(const string& line);
+
+	// runs a command or makes a declaration; blank lines do nothing
+	void consume_line(string line);
+	// runs the command named by line
+	void run_command(const Line& line);
+	// prints "name:\texpr" to output, within print_limits
+	void show(const string& name, const Expr& expr);
+	// defines name and echoes it (and whatever was recomputed because of it) if echo_vars is on
+	void declare(const string& name, const Expr& expr);
+	// adds a transform to name (see Workspace::transform), and echoes name and whatever was recomputed
+	void apply(const string& name, Workspace::Transform transform);
+};
@@ -0,0 +1,116 @@
+#include "ThreadPool.hpp"
+#include "Arena.hpp"
+#include "Tracer.hpp"
+
+ThreadPool::ThreadPool(size_t threads){
+	if(threads==0)
+		threads = 1;
+	for(size_t n=0;n<=threads;n++)
+		queues.push_back(std::make_unique<Queue>());
+	for(size_t n=0;n<threads;n++)
+		workers.emplace_back(&ThreadPool::worker_loop,this,n);
+}
+
+ThreadPool::~ThreadPool(){
+	{
+		std::lock_guard lock(sleep_mtx);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(std::thread& worker : workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::shared(){
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::push(Task task){
+	// counted before it is visible, so a thief can never take queued below zero
+	{
+		std::lock_guard lock(sleep_mtx);
+		queued++;
+	}
+	Queue& queue = current_pool==this ? *queues[current_index] : *queues.back();
+	{
+		std::lock_guard lock(queue.mtx);
+		queue.tasks.push_back(std::move(task));
+	}
+	wake.notify_one();
+}
+
+bool ThreadPool::try_run_one(){
+	Task task;
+	auto take = [&](Queue& queue, bool from_back){
+		std::lock_guard lock(queue.mtx);
+		if(queue.tasks.empty())
+			return false;
+		if(from_back){
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		return true;
+	};
+
+	// own work first, then the shared queue, then steal the oldest task of another worker
+	bool is_worker = current_pool==this;
+	size_t self = is_worker ? current_index : 0;
+	bool found = is_worker && take(*queues[self],true);
+	if(!found)
+		found = take(*queues.back(),false);
+	for(size_t n=0;!found && n<workers.size();n++){
+		size_t victim = (self+n)%workers.size();
+		if(!is_worker || victim!=self)
+			found = take(*queues[victim],false);
+	}
+	if(!found)
+		return false;
+	queued--;
+	// a thread waiting on a TaskGroup may be in the middle of building in its own Arena, which the task
+	// (maybe another group's) knows nothing about; it runs on the heap, as it would on a worker
+	Arena::Scope heap(nullptr);
+	task();
+	return true;
+}
+
+void ThreadPool::worker_loop(size_t index){
+	current_pool = this;
+	current_index = index;
+	Tracer::set_thread_name("worker "+std::to_string(index));
+	while(true){
+		if(try_run_one())
+			continue;
+		std::unique_lock lock(sleep_mtx);
+		wake.wait(lock,[this](){ return stopping || queued>0; });
+		if(stopping)
+			return;
+	}
+}
+
+void ThreadPool::TaskGroup::run(Task task){
+	pending++;
+	pool.push([this,&pool=pool,task=std::move(task)](){
+		task();
+		// the group may be gone as soon as pending reaches zero, so only pool is used after
+		if(--pending==0){
+			std::lock_guard lock(pool.sleep_mtx);
+			pool.wake.notify_all();
+		}
+	});
+}
+
+void ThreadPool::TaskGroup::wait(){
+	while(pending>0){
+		if(pool.try_run_one())
+			continue;
+		// nothing to run, so the rest of the group is running elsewhere; sleep until it's done or
+		// there's something new to run
+		std::unique_lock lock(pool.sleep_mtx);
+		pool.wake.wait(lock,[this](){ return pending==0 || pool.queued>0; });
+	}
+}
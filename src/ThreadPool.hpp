@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool. Each worker has its own deque: it pushes and pops its own tasks at the
+// back (most recently forked first, which keeps a subtree on one core) and steals from the front of
+// the others' when it runs dry. Tasks from outside threads go to a shared queue. A thread waiting on
+// a TaskGroup runs queued tasks (with no Arena current, as on a worker) instead of blocking, so nested
+// fork/join can't deadlock, and sleeps only when there's nothing to run.
+class ThreadPool{
+public:
+	typedef std::function<void()> Task;
+
+private:
+	struct Queue{
+		std::mutex mtx;
+		std::deque<Task> tasks;
+	};
+	// one per worker, plus the shared queue at the end
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleep_mtx;
+	std::condition_variable wake;
+	std::atomic<size_t> queued = 0;
+	bool stopping = false;
+
+	// which worker (of which pool) the current thread is
+	inline static thread_local const ThreadPool* current_pool = nullptr;
+	inline static thread_local size_t current_index = 0;
+
+	void push(Task task);
+	bool try_run_one();
+	void worker_loop(size_t index);
+
+public:
+	ThreadPool(size_t threads=std::thread::hardware_concurrency());
+	ThreadPool(const ThreadPool&)=delete;
+	ThreadPool& operator=(const ThreadPool&)=delete;
+	~ThreadPool();
+
+	size_t size() const { return workers.size(); }
+
+	// pool shared by everything that doesn't bring its own; one worker per hardware thread
+	static ThreadPool& shared();
+
+	// a set of forked tasks that can be waited on together
+	class TaskGroup{
+		ThreadPool& pool;
+		std::atomic<size_t> pending = 0;
+	public:
+		TaskGroup(ThreadPool& pool):pool(pool){}
+		TaskGroup(const TaskGroup&)=delete;
+		~TaskGroup(){ wait(); }
+		// task must not throw
+		void run(Task task);
+		void wait();
+	};
+};
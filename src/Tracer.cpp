@@ -0,0 +1,191 @@
+#include "Tracer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A thread's spans, as a single producer, single consumer ring: the thread pushes at head, and
+// collect (under the trace's mutex, so one consumer at a time) takes from tail.
+struct ThreadRing{
+	static constexpr uint64_t capacity = 1<<14;
+	Tracer::Event events[capacity];
+	std::atomic<uint64_t> head = 0;
+	std::atomic<uint64_t> tail = 0;
+	std::atomic<uint64_t> dropped = 0;
+	uint32_t tid;
+	std::string name;
+};
+
+struct Trace{
+	std::mutex mtx;
+	// every thread that has ever recorded a span; rings outlive their threads, to keep their spans
+	std::vector<std::shared_ptr<ThreadRing>> rings;
+	std::vector<std::pair<Tracer::Event,uint32_t>> events;
+	size_t dropped = 0;
+	uint64_t start_ns = 0;
+};
+
+// leaked, since threads can still be recording as statics are destroyed
+static Trace& trace(){
+	static Trace* ret = new Trace;
+	return *ret;
+}
+
+static thread_local std::string thread_name;
+
+static ThreadRing& thread_ring(){
+	thread_local std::shared_ptr<ThreadRing> ring = [](){
+		auto ret = std::make_shared<ThreadRing>();
+		Trace& all = trace();
+		std::lock_guard lock(all.mtx);
+		ret->tid = all.rings.size()+1;
+		ret->name = thread_name.empty() ? "thread "+std::to_string(ret->tid) : thread_name;
+		all.rings.push_back(ret);
+		return ret;
+	}();
+	return *ring;
+}
+
+uint64_t Tracer::now_ns(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::set_thread_name(const std::string& name){
+	thread_name = name;
+}
+
+void Tracer::Span::set_text(std::string_view text){
+	size_t size = std::min(text.size(),sizeof(event.text)-1);
+	// never cut a UTF-8 character in half
+	if(size<text.size()){
+		while(size>0 && (static_cast<unsigned char>(text[size])&0xC0)==0x80)
+			size--;
+	}
+	std::memcpy(event.text,text.data(),size);
+	event.text[size] = '\0';
+}
+
+void Tracer::Span::finish(){
+	event.duration_ns = now_ns()-event.start_ns;
+	push(event);
+}
+
+void Tracer::push(const Event& event){
+	ThreadRing& ring = thread_ring();
+	uint64_t head = ring.head.load(std::memory_order_relaxed);
+	if(head-ring.tail.load(std::memory_order_acquire)>=ThreadRing::capacity){
+		ring.dropped.fetch_add(1,std::memory_order_relaxed);
+		return;
+	}
+	ring.events[head%ThreadRing::capacity] = event;
+	ring.head.store(head+1,std::memory_order_release);
+}
+
+// takes everything out of the rings, keeping it in the trace if keep
+static void drain(Trace& all, bool keep){
+	for(const auto& ring : all.rings){
+		uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		if(keep){
+			for(;tail<head;tail++){
+				const Tracer::Event& event = ring->events[tail%ThreadRing::capacity];
+				// spans that began before the trace did were recorded for an earlier one
+				if(event.start_ns>=all.start_ns)
+					all.events.emplace_back(event,ring->tid);
+			}
+		}
+		ring->tail.store(head,std::memory_order_release);
+		size_t dropped = ring->dropped.exchange(0,std::memory_order_relaxed);
+		if(keep)
+			all.dropped += dropped;
+	}
+}
+
+void Tracer::start(){
+	Trace& all = trace();
+	std::lock_guard lock(all.mtx);
+	drain(all,false);
+	all.events.clear();
+	all.dropped = 0;
+	all.start_ns = now_ns();
+	_on.store(true,std::memory_order_relaxed);
+}
+
+void Tracer::stop(){
+	_on.store(false,std::memory_order_relaxed);
+	collect();
+}
+
+void Tracer::collect(){
+	Trace& all = trace();
+	std::lock_guard lock(all.mtx);
+	drain(all,true);
+}
+
+size_t Tracer::event_count(){
+	Trace& all = trace();
+	std::lock_guard lock(all.mtx);
+	return all.events.size();
+}
+
+size_t Tracer::dropped_count(){
+	Trace& all = trace();
+	std::lock_guard lock(all.mtx);
+	return all.dropped;
+}
+
+static void write_json_string(std::ostream& out, const char* str){
+	out<<'"';
+	for(const char* c=str;*c!='\0';c++){
+		if(*c=='"' || *c=='\\'){
+			out<<'\\'<<*c;
+		}
+		else if(static_cast<unsigned char>(*c)<0x20){
+			char escaped[8];
+			std::snprintf(escaped,sizeof(escaped),"\\u%04x",*c);
+			out<<escaped;
+		}
+		else{
+			out<<*c;
+		}
+	}
+	out<<'"';
+}
+
+void Tracer::write(std::ostream& out){
+	Trace& all = trace();
+	std::lock_guard lock(all.mtx);
+	drain(all,true);
+
+	// times are in microseconds from the start of the trace
+	char time[64];
+	out<<"{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":"<<all.dropped<<"},\"traceEvents\":[";
+	bool first = true;
+	for(const auto& ring : all.rings){
+		out<<(first ? "\n" : ",\n")<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<ring->tid<<",\"args\":{\"name\":";
+		write_json_string(out,ring->name.c_str());
+		out<<"}}";
+		first = false;
+	}
+	for(const auto& [event,tid] : all.events){
+		std::snprintf(time,sizeof(time),"\"ts\":%.3f,\"dur\":%.3f",(event.start_ns-all.start_ns)/1e3,event.duration_ns/1e3);
+		out<<(first ? "\n" : ",\n")<<"{\"name\":";
+		write_json_string(out,event.name);
+		out<<",\"cat\":\"symbolic\",\"ph\":\"X\","<<time<<",\"pid\":1,\"tid\":"<<tid<<",\"args\":{";
+		if(event.arg_name!=nullptr){
+			write_json_string(out,event.arg_name);
+			out<<":"<<event.arg;
+		}
+		if(event.text[0]!='\0'){
+			out<<(event.arg_name!=nullptr ? ",\"text\":" : "\"text\":");
+			write_json_string(out,event.text);
+		}
+		out<<"}}";
+		first = false;
+	}
+	out<<"\n]}\n";
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Records a timeline of spans (a cell, each line, each parse, perform and print, and each subtree a
+// parallel perform forks off) on every thread, for chrome://tracing or Perfetto. Each thread writes
+// into its own fixed size ring (made on its first span), with no locks or allocation: a finished span
+// is copied into the next slot and published with one release store. collect() moves what the rings
+// hold into the trace; the session calls it between lines, so a ring only has to hold one line's
+// worth. A span that finds its ring full is dropped, and counted. While tracing is off a Span is one
+// relaxed load and a branch, and -DSYMBOLIC_NO_PROFILE removes it, as it does the Profiler.
+class Tracer{
+public:
+	struct Event{
+		// span names and arg names are string literals
+		const char* name;
+		const char* arg_name;
+		int64_t arg;
+		uint64_t start_ns;
+		uint64_t duration_ns;
+		// free text, such as the line being run, cut short to fit
+		char text[48];
+	};
+
+	static bool on(){
+#ifdef SYMBOLIC_NO_PROFILE
+		return false;
+#else
+		return __builtin_expect(_on.load(std::memory_order_relaxed),false);
+#endif
+	}
+	// throws away anything recorded before, and starts recording
+	static void start();
+	// stops recording; what was recorded is kept until the next start
+	static void stop();
+	// moves what every thread has recorded so far into the trace
+	static void collect();
+	// collects, and writes the trace as Chrome trace event JSON
+	static void write(std::ostream& out);
+	// spans in the trace so far, and spans dropped because a ring was full
+	static size_t event_count();
+	static size_t dropped_count();
+	// how this thread is labelled in the trace (by default, "thread n")
+	static void set_thread_name(const std::string& name);
+
+	class Span{
+		Event event;
+		bool active;
+		void finish();
+	public:
+		Span(const char* name):active(on()){
+			if(active){
+				event.name = name;
+				event.arg_name = nullptr;
+				event.text[0] = '\0';
+				event.start_ns = now_ns();
+			}
+		}
+		Span(const Span&)=delete;
+		Span& operator=(const Span&)=delete;
+		~Span(){
+			if(active)
+				finish();
+		}
+		// whether this Span is recording (so whether it's worth working out its args)
+		bool is_active() const { return active; }
+		void set_arg(const char* name, int64_t value){
+			event.arg_name = name;
+			event.arg = value;
+		}
+		void set_text(std::string_view text);
+	};
+
+private:
+	inline static std::atomic<bool> _on = false;
+	static uint64_t now_ns();
+	static void push(const Event& event);
+};
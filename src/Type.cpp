@@ -1,48 +1,58 @@
 #include "Type.hpp"
 #include "Expr.hpp"
+#include "InternTable.hpp"
 
-#include <unordered_map>
+#include <limits>
 
 Expr Type::operator()() const {
+	CompactVector<Expr> children;
 	switch(arity){
 		case NULLARY:
-			return Expr(this,std::deque<Expr>{},0);
+		case INFINITARY:
+			break;
 		case UNARY:
-			return Expr(this,std::deque<Expr>{Expr()},0);
 		case BINARY:
-			return Expr(this,std::deque<Expr>{Expr(),Expr()},0);
 		case TERNARY:
-			return Expr(this,std::deque<Expr>{Expr(),Expr(),Expr()},0);
-		case INFINITARY:
-			return Expr(this,std::deque<Expr>{},0);
+			children.reserve(arity);
+			for(size_t n=0;n<arity;n++)
+				children.emplace_back();
+			break;
 		default:
 			ERROR("should be unreachable");
 	}
+	return Expr(this,std::move(children),0);
 }
 
-std::deque<string> string_values;
-std::unordered_map<string,int_value_t> string_value_ids;
+// Symbol names are refcounted by every Expr that holds them (through f_retain and f_release), so a
+// name is freed once nothing uses it. Never destroyed, since static Exprs may outlive it
+static InternTable& symbol_names(){
+	static InternTable& table = *new InternTable();
+	return table;
+}
 
-template<> Expr ValueType<string>::operator()(string v) const {
-	uni_value_t uval;
-	if(string_value_ids.contains(v)){
-		uval = string_value_ids[v];
-	}
-	else{
-		string_values.push_back(v);
-		string_value_ids.emplace(v,string_values.size()-1);
-		uval = string_values.size()-1;
-	}
-	return Expr(this,{},uval);
+template<> Expr ValueType<string>::operator()(std::string_view v) const {
+	return Expr(this,{},symbol_names().intern(v));
 }
 template<> string ValueType<string>::value(const Expr& ex) const{
 	ASSERT_EQUAL(ex.type(),*this);
-	return string_values[ex._value];
+	return symbol_names().get(ex._value);
+}
+
+static void symbol_retain(uni_value_t id){
+	symbol_names().retain(id);
 }
 
-template<> Expr ValueType<int_value_t>::operator()(int_value_t v) const {
+static void symbol_release(uni_value_t id){
+	symbol_names().release(id);
+}
+
+size_t live_symbol_names(){
+	return symbol_names().size();
+}
+
+template<> Expr ValueType<int_value_t>::operator()(const int_value_t& v) const {
 	static_assert(sizeof(uni_value_t)==sizeof(int_value_t));
-	uni_value_t uval = *reinterpret_cast<uni_value_t*>(&v);
+	uni_value_t uval = *reinterpret_cast<const uni_value_t*>(&v);
 	return Expr(this,{},uval);
 }
 template<> int_value_t ValueType<int_value_t>::value(const Expr& ex) const{
@@ -51,9 +61,9 @@ template<> int_value_t ValueType<int_value_t>::value(const Expr& ex) const{
 	return *reinterpret_cast<const int_value_t*>(&(ex._value));
 }
 
-template<> Expr ValueType<float_value_t>::operator()(float_value_t v) const {
+template<> Expr ValueType<float_value_t>::operator()(const float_value_t& v) const {
 	static_assert(sizeof(uni_value_t)==sizeof(float_value_t));
-	uni_value_t uval = *reinterpret_cast<uni_value_t*>(&v);
+	uni_value_t uval = *reinterpret_cast<const uni_value_t*>(&v);
 	return Expr(this,{},uval);
 }
 template<> float_value_t ValueType<float_value_t>::value(const Expr& ex) const{
@@ -62,7 +72,59 @@ template<> float_value_t ValueType<float_value_t>::value(const Expr& ex) const{
 	return *reinterpret_cast<const float_value_t*>(&(ex._value));
 }
 
-template<> Expr ValueType<bool_value_t>::operator()(bool_value_t v) const {
+// BigIntegers and Rationals are interned the same way as Symbol names, and freed once no Expr holds
+// them, so the values a long session works through don't pile up
+static BasicInternTable<BigInt>& big_values(){
+	static BasicInternTable<BigInt>& table = *new BasicInternTable<BigInt>();
+	return table;
+}
+
+template<> Expr ValueType<BigInt>::operator()(const BigInt& v) const {
+	return Expr(this,{},big_values().intern(v));
+}
+template<> const BigInt& ValueType<BigInt>::value(const Expr& ex) const{
+	ASSERT_EQUAL(ex.type(),*this);
+	return big_values().get(ex._value);
+}
+
+static void big_retain(uni_value_t id){
+	big_values().retain(id);
+}
+
+static void big_release(uni_value_t id){
+	big_values().release(id);
+}
+
+size_t live_big_integers(){
+	return big_values().size()-1;
+}
+
+static BasicInternTable<Fraction>& rational_values(){
+	static BasicInternTable<Fraction>& table = *new BasicInternTable<Fraction>();
+	return table;
+}
+
+template<> Expr ValueType<Fraction>::operator()(const Fraction& v) const {
+	return Expr(this,{},rational_values().intern(v));
+}
+template<> const Fraction& ValueType<Fraction>::value(const Expr& ex) const{
+	ASSERT_EQUAL(ex.type(),*this);
+	return rational_values().get(ex._value);
+}
+
+static void rational_retain(uni_value_t id){
+	rational_values().retain(id);
+}
+
+static void rational_release(uni_value_t id){
+	rational_values().release(id);
+}
+
+size_t live_rationals(){
+	return rational_values().size()-1;
+}
+
+template<> Expr ValueType<bool_value_t>::operator()(const bool_value_t& v) const {
 	uni_value_t uval = static_cast<uni_value_t>(v);
 	return Expr(this,{},uval);
 }
@@ -86,6 +148,7 @@ consteval Type make_list(){
 	Type type;
 	type.name="List";
 	type.parse_string = R"(((?&EXPR)),((?&EXPR)))";
+	type.parse_token = ",";
 	type.print_string = "$1, $2";
 	type.arity = Type::INFINITARY;
 	type.pemdas = 1000;
@@ -96,12 +159,12 @@ constexpr Type List = make_list();
 REGISTER_TYPE(List);
 
 Expr symbol_parser(const string& str){
-	string trimmed;
-	for(char c : str){
-		if(c!=' ')
-			trimmed.push_back(c);
-	}
-	return Symbol(trimmed);
+	// a name can't have spaces in it, so only the ends need trimming
+	size_t start = str.find_first_not_of(" \t\n\r\f\v");
+	if(start==string::npos)
+		return Symbol("");
+	size_t end = str.find_last_not_of(" \t\n\r\f\v");
+	return Symbol(std::string_view(str).substr(start,end-start+1));
 }
 
 string symbol_printer(const Expr& ex){
@@ -117,6 +180,8 @@ consteval ValueType<string> make_symbol(){
 	type.flags = Type::VALUE_TYPE;
 	type.f_parser = symbol_parser;
 	type.f_printer = symbol_printer;
+	type.f_retain = symbol_retain;
+	type.f_release = symbol_release;
 	return type;
 }
 constexpr ValueType<string> Symbol = make_symbol();
@@ -161,7 +226,10 @@ Expr integer_parser(const string& str){
 		if(c!=' ')
 			trimmed.push_back(c);
 	}
-	return Integer(std::stol(trimmed));
+	// anything that could overflow int_value_t goes through BigInt; Expr(BigInt) narrows it back if it fits
+	if(trimmed.size()<=std::numeric_limits<int_value_t>::digits10)
+		return Integer(std::stol(trimmed));
+	return Expr(BigInt(trimmed));
 }
 
 string integer_printer(const Expr& ex){
@@ -176,6 +244,14 @@ float_value_t integer_get_float(const Expr& ex){
 	return Integer.value(ex);
 }
 
+BigInt integer_get_bigint(const Expr& ex){
+	return Integer.value(ex);
+}
+
+Fraction integer_get_rational(const Expr& ex){
+	return BigInt(Integer.value(ex));
+}
+
 consteval ValueType<int_value_t> make_integer(){
 	ValueType<int_value_t> type;
 	type.name = "Integer";
@@ -187,12 +263,78 @@ consteval ValueType<int_value_t> make_integer(){
 	type.f_printer = integer_printer;
 	type.f_get_int = integer_get_int;
 	type.f_get_float = integer_get_float;
+	type.f_get_bigint = integer_get_bigint;
+	type.f_get_rational = integer_get_rational;
 
 	return type;
 }
 constexpr ValueType<int_value_t> Integer = make_integer();
 REGISTER_TYPE(Integer);
 
+string big_integer_printer(const Expr& ex){
+	return BigInteger.value(ex).to_string();
+}
+
+BigInt big_integer_get_bigint(const Expr& ex){
+	return BigInteger.value(ex);
+}
+
+Fraction big_integer_get_rational(const Expr& ex){
+	return BigInteger.value(ex);
+}
+
+float_value_t big_integer_get_float(const Expr& ex){
+	return BigInteger.value(ex).to_double();
+}
+
+// not parsed directly; integer_parser promotes literals that are too large for Integer
+consteval ValueType<BigInt> make_big_integer(){
+	ValueType<BigInt> type;
+	type.name = "BigInteger";
+	type.arity = Type::NULLARY;
+	type.pemdas = -10;
+	type.flags = Type::VALUE_TYPE|Type::CONSTANT;
+	type.f_printer = big_integer_printer;
+	type.f_get_bigint = big_integer_get_bigint;
+	type.f_get_rational = big_integer_get_rational;
+	type.f_get_float = big_integer_get_float;
+	type.f_retain = big_retain;
+	type.f_release = big_release;
+	return type;
+}
+constexpr ValueType<BigInt> BigInteger = make_big_integer();
+REGISTER_TYPE(BigInteger);
+
+string rational_printer(const Expr& ex){
+	return Rational.value(ex).to_string();
+}
+
+Fraction rational_get_rational(const Expr& ex){
+	return Rational.value(ex);
+}
+
+float_value_t rational_get_float(const Expr& ex){
+	return Rational.value(ex).to_double();
+}
+
+// produced by exact Div (and Pow with a negative exponent); prints as a division, so it takes
+// Div's pemdas to get the same parentheses. Parsing "1/3" gives a Div that performs to this.
+consteval ValueType<Fraction> make_rational(){
+	ValueType<Fraction> type;
+	type.name = "Rational";
+	type.arity = Type::NULLARY;
+	type.pemdas = 30;
+	type.flags = Type::VALUE_TYPE|Type::CONSTANT;
+	type.f_printer = rational_printer;
+	type.f_get_rational = rational_get_rational;
+	type.f_get_float = rational_get_float;
+	type.f_retain = rational_retain;
+	type.f_release = rational_release;
+	return type;
+}
+constexpr ValueType<Fraction> Rational = make_rational();
+REGISTER_TYPE(Rational);
+
 
 Expr bool_parser(const string& str){
 	string trimmed;
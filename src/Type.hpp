@@ -2,9 +2,13 @@
 #include <string>
 #include <cstdint>
 #include <set>
+#include <string_view>
+#include <type_traits>
 using std::string;
 
 #include "FuzzyBool.hpp"
+#include "BigInt.hpp"
+#include "Fraction.hpp"
 
 // type used to store all other value types
 typedef uint64_t uni_value_t;
@@ -23,6 +27,10 @@ public:
 	// should always accept possible whitespace to either side
 	const char* parse_string = "";
 
+	// literal text that any match of parse_string must contain (optional);
+	// lets the parser skip this type without running the regex
+	const char* parse_token = "";
+
 	// regex replace format for printing
 	const char* print_string = "";
 
@@ -71,6 +79,10 @@ public:
 	// (exact behavior depends on the collection)
 	constexpr static const flags_t ENTRYWISE = 1<<NEXT;
 	bool is_entrywise() const { return flags&ASSOCIATIVE; }
+
+	// if a chain of this binary operator groups from the right (a^b^c is a^(b^c))
+	constexpr static const flags_t RIGHT_ASSOCIATIVE = 1<<NEXT;
+	bool is_right_associative() const { return flags&RIGHT_ASSOCIATIVE; }
 #undef NEXT
 
 	// any of the following function pointers may be null if that operation is not supported
@@ -92,6 +104,15 @@ public:
 	typedef int_value_t (*f_get_int_t)(const Expr&);
 	f_get_int_t f_get_int=nullptr;
 
+	// gets an exact integer representation of this value (only for integer constants);
+	// defined for every integer, including those too large for f_get_int
+	typedef BigInt (*f_get_bigint_t)(const Expr&);
+	f_get_bigint_t f_get_bigint=nullptr;
+
+	// gets an exact rational representation of this value (only for rational constants, integers included)
+	typedef Fraction (*f_get_rational_t)(const Expr&);
+	f_get_rational_t f_get_rational=nullptr;
+
 	// gets a float representation of this value (only for constants)
 	typedef float_value_t (*f_get_float_t)(const Expr&);
 	f_get_float_t f_get_float=nullptr;
@@ -100,6 +121,12 @@ public:
 	typedef bool_value_t (*f_get_bool_t)(const Expr&);
 	f_get_bool_t f_get_bool=nullptr;
 
+	// for value types whose value refers to shared storage (like a Symbol's interned name): takes a
+	// reference when an Expr holding the value is copied, and drops one when it's destroyed
+	typedef void (*f_reference_t)(uni_value_t);
+	f_reference_t f_retain=nullptr;
+	f_reference_t f_release=nullptr;
+
 	consteval Type()=default;
 	Type(const Type&)=delete;
 	consteval Type(Type&&)=default;
@@ -116,14 +143,20 @@ public:
 inline string to_string(const Type& type){ return type.name; }
 
 template<typename T> struct ValueType : public Type{
+	// strings are looked up by view, so making a Symbol from a substring or literal copies nothing
+	typedef std::conditional_t<std::same_as<T,string>,std::string_view,const T&> arg_t;
+	// big numbers are read straight from where they're interned, and stay valid as long as the Expr
+	typedef std::conditional_t<std::same_as<T,BigInt> || std::same_as<T,Fraction>,const T&,T> value_t;
 	consteval ValueType()=default;
-	Expr operator()(T v) const;
-	T value(const Expr& ex) const;
+	Expr operator()(arg_t v) const;
+	value_t value(const Expr& ex) const;
 };
 template struct ValueType<string>;
 template struct ValueType<int_value_t>;
 template struct ValueType<float_value_t>;
 template struct ValueType<bool_value_t>;
+template struct ValueType<BigInt>;
+template struct ValueType<Fraction>;
 
 // any comma seperated list. means nothing until a type with flag LIST_UNWRAPPER unwraps it.
 extern const Type List;
@@ -180,9 +213,19 @@ extern const ValueType<bool_value_t> Bool;
 extern const ValueType<string> Symbol;
 extern const ValueType<float_value_t> Float;
 extern const ValueType<int_value_t> Integer;
+// an integer that doesn't fit in int_value_t; Expr(const BigInt&) picks between this and Integer
+extern const ValueType<BigInt> BigInteger;
+// a non-integer ratio of integers; Expr(const Fraction&) picks between this and the integer types
+extern const ValueType<Fraction> Rational;
 
 extern const Type Undefined;
 
+// number of distinct Symbol names currently alive
+size_t live_symbol_names();
+// number of distinct BigInteger and Rational values currently alive
+size_t live_big_integers();
+size_t live_rationals();
+
 struct cmp_types{
 	bool operator()(const Type* a, const Type* b) const {
 		return a->pemdas > b->pemdas;
@@ -0,0 +1,192 @@
+#include "Workspace.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+static void collect_references(const Expr& expr, std::vector<string>& out){
+	if(expr.type()==Symbol)
+		out.push_back(Symbol.value(expr));
+	for(const Expr& child : expr)
+		collect_references(child,out);
+}
+
+static void replace_references(Expr& expr, const std::map<string,Expr>& values){
+	if(expr.type()==Symbol){
+		auto found = values.find(Symbol.value(expr));
+		if(found!=values.end())
+			expr = found->second;
+		return;
+	}
+	for(Expr& child : expr)
+		replace_references(child,values);
+}
+
+Expr Workspace::resolve(const Expr& definition) const {
+	Expr ret = definition;
+	replace_references(ret,_values);
+	return ret;
+}
+
+Expr Workspace::compute(const string& name) const {
+	Expr ret = resolve(_definitions.at(name));
+	auto found = _transforms.find(name);
+	if(found!=_transforms.end()){
+		for(const Transform& transform : found->second)
+			ret = transform(ret);
+	}
+	return ret;
+}
+
+const Expr& Workspace::operator[](const string& name) const {
+	auto found = _values.find(name);
+	if(found==_values.end())
+		throw WorkspaceError("There is no expression named '"+name+"'");
+	return found->second;
+}
+
+const Expr& Workspace::definition(const string& name) const {
+	auto found = _definitions.find(name);
+	if(found==_definitions.end())
+		throw WorkspaceError("There is no expression named '"+name+"'");
+	return found->second;
+}
+
+void Workspace::unlink(const string& name){
+	auto found = _references.find(name);
+	if(found==_references.end())
+		return;
+	for(const string& reference : found->second){
+		auto back = _referenced_by.find(reference);
+		back->second.erase(name);
+		if(back->second.empty())
+			_referenced_by.erase(back);
+	}
+	_references.erase(found);
+}
+
+bool Workspace::find_path(const string& name, const string& target, std::vector<string>& path) const {
+	path.push_back(name);
+	if(name==target)
+		return true;
+	auto found = _references.find(name);
+	if(found!=_references.end()){
+		for(const string& reference : found->second){
+			if(find_path(reference,target,path))
+				return true;
+		}
+	}
+	path.pop_back();
+	return false;
+}
+
+static void visit_dependents(const std::unordered_map<string,std::set<string>>& referenced_by, const string& name,
+		std::unordered_set<string>& visited, std::vector<string>& postorder){
+	auto found = referenced_by.find(name);
+	if(found!=referenced_by.end()){
+		for(const string& dependent : found->second){
+			if(visited.insert(dependent).second)
+				visit_dependents(referenced_by,dependent,visited,postorder);
+		}
+	}
+	postorder.push_back(name);
+}
+
+std::vector<string> Workspace::dependents(const string& name) const {
+	// reverse postorder of a depth first search along referenced_by is a topological order
+	std::vector<string> postorder;
+	std::unordered_set<string> visited = {name};
+	visit_dependents(_referenced_by,name,visited,postorder);
+	postorder.pop_back();
+	std::reverse(postorder.begin(),postorder.end());
+	return postorder;
+}
+
+static void visit_references(const std::unordered_map<string,std::vector<string>>& references, const std::map<string,Expr>& values,
+		const string& name, std::unordered_set<string>& visited, std::vector<string>& postorder){
+	auto found = references.find(name);
+	if(found!=references.end()){
+		for(const string& reference : found->second){
+			if(values.contains(reference) && visited.insert(reference).second)
+				visit_references(references,values,reference,visited,postorder);
+		}
+	}
+	postorder.push_back(name);
+}
+
+std::vector<string> Workspace::dependency_order() const {
+	std::vector<string> postorder;
+	std::unordered_set<string> visited;
+	for(const auto& [name,value] : _values){
+		if(visited.insert(name).second)
+			visit_references(_references,_values,name,visited,postorder);
+	}
+	return postorder;
+}
+
+std::vector<string> Workspace::define(const string& name, const Expr& definition){
+	std::vector<string> references;
+	collect_references(definition,references);
+	std::sort(references.begin(),references.end());
+	references.erase(std::unique(references.begin(),references.end()),references.end());
+
+	// the graph has no cycles yet, so any new one goes through name
+	for(const string& reference : references){
+		std::vector<string> path = {name};
+		if(find_path(reference,name,path)){
+			string cycle;
+			for(const string& step : path)
+				cycle += (cycle.empty() ? "" : " -> ")+step;
+			throw WorkspaceError("Defining '"+name+"' would make a cycle of references: "+cycle);
+		}
+	}
+
+	unlink(name);
+	for(const string& reference : references)
+		_referenced_by[reference].insert(name);
+	_references[name] = std::move(references);
+	_definitions[name] = promote(definition);
+	_transforms.erase(name);
+	_values[name] = promote(resolve(definition));
+
+	std::vector<string> recomputed = dependents(name);
+	for(const string& dependent : recomputed)
+		_values[dependent] = promote(compute(dependent));
+	return recomputed;
+}
+
+std::vector<string> Workspace::transform(const string& name, Transform transform){
+	auto found = _values.find(name);
+	if(found==_values.end())
+		throw WorkspaceError("There is no expression named '"+name+"'");
+	// the current value already has the earlier transforms, so only this one needs applying
+	Expr value = promote(transform(found->second));
+	_transforms[name].push_back(std::move(transform));
+	found->second = std::move(value);
+
+	std::vector<string> recomputed = dependents(name);
+	for(const string& dependent : recomputed)
+		_values[dependent] = promote(compute(dependent));
+	return recomputed;
+}
+
+std::vector<string> Workspace::erase(const string& name){
+	if(!contains(name))
+		throw WorkspaceError("There is no expression named '"+name+"'");
+	unlink(name);
+	_definitions.erase(name);
+	_transforms.erase(name);
+	_values.erase(name);
+
+	std::vector<string> recomputed = dependents(name);
+	for(const string& dependent : recomputed)
+		_values[dependent] = promote(compute(dependent));
+	return recomputed;
+}
+
+void Workspace::clear(){
+	_values.clear();
+	_definitions.clear();
+	_transforms.clear();
+	_references.clear();
+	_referenced_by.clear();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Expr.hpp"
+
+#include <functional>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+struct WorkspaceError : public NamedError{
+	WorkspaceError(string what):NamedError("WorkspaceError",std::move(what)){}
+};
+
+// Named expressions that can reference each other by name. Each entry keeps its definition as given,
+// and caches its value: the definition with every reference to another entry replaced by that entry's
+// value. References are kept in a dependency graph, so redefining or erasing an entry only recomputes
+// the entries that depend on it, in topological order. A name can be referenced before it is defined
+// (it stays a plain Symbol until then). An entry can also have transforms (like $expand), which are
+// applied to its value in order every time it's computed, so they're redone when what it references
+// changes. Everything stored is promoted out of the current Arena.
+class Workspace{
+public:
+	typedef std::function<Expr(const Expr&)> Transform;
+
+private:
+	std::map<string,Expr> _values;
+	std::map<string,Expr> _definitions;
+	std::map<string,std::vector<Transform>> _transforms;
+	// the names each definition references (defined or not), and the reverse
+	std::unordered_map<string,std::vector<string>> _references;
+	std::unordered_map<string,std::set<string>> _referenced_by;
+
+	Expr resolve(const Expr& definition) const;
+	// the definition of name, resolved, with its transforms applied
+	Expr compute(const string& name) const;
+	void unlink(const string& name);
+	// the path of references from name to target, if there is one
+	bool find_path(const string& name, const string& target, std::vector<string>& path) const;
+	// every entry that depends on name (directly or not), each after everything it depends on
+	std::vector<string> dependents(const string& name) const;
+
+public:
+	typedef std::map<string,Expr>::const_iterator const_iterator;
+	// over (name, value), in name order
+	const_iterator begin() const { return _values.begin(); }
+	const_iterator end() const { return _values.end(); }
+	size_t size() const { return _values.size(); }
+	bool contains(const string& name) const { return _values.contains(name); }
+
+	// every name, each after the entries it references
+	std::vector<string> dependency_order() const;
+
+	// the value of name; throws WorkspaceError if there is no such entry
+	const Expr& operator[](const string& name) const;
+	const Expr& definition(const string& name) const;
+
+	// Defines or redefines name, without transforms. Returns the other entries that were recomputed
+	// because of it, in the order they were recomputed. Throws WorkspaceError, and changes nothing, if
+	// the definition would make a cycle of references.
+	std::vector<string> define(const string& name, const Expr& definition);
+	// Adds a transform to name, and recomputes it and what depends on it; returns those as define does.
+	// If the transform throws, nothing changes.
+	std::vector<string> transform(const string& name, Transform transform);
+	bool has_transforms(const string& name) const { return _transforms.contains(name); }
+	// the entries that referenced name see it as a plain Symbol again; returns them as define does
+	std::vector<string> erase(const string& name);
+	void clear();
+};
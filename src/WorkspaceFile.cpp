@@ -0,0 +1,334 @@
+#include "WorkspaceFile.hpp"
+
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char magic[8] = {'S','Y','M','B','O','L','I','C'};
+static constexpr uint32_t byte_order_mark = 0x01020304;
+
+namespace{
+
+struct Writer{
+	std::vector<string> types;
+	std::unordered_map<const Type*,uint32_t> type_ids;
+	std::vector<string> strings;
+	std::unordered_map<string,uint32_t> string_ids;
+	std::vector<WorkspaceFile::PackedNode> nodes;
+
+	uint32_t type_id(const Type& type){
+		auto [found,inserted] = type_ids.emplace(&type,types.size());
+		if(inserted)
+			types.push_back(type.name);
+		return found->second;
+	}
+
+	uint32_t string_id(const string& str){
+		auto [found,inserted] = string_ids.emplace(str,strings.size());
+		if(inserted)
+			strings.push_back(str);
+		return found->second;
+	}
+
+	uint64_t value(const Expr& ex){
+		const Type& type = ex.type();
+		if(!type.is_value_type())
+			return 0;
+		if(type==Symbol)
+			return string_id(Symbol.value(ex));
+		if(type==Integer)
+			return uint64_t(Integer.value(ex));
+		if(type==Float)
+			return std::bit_cast<uint64_t>(Float.value(ex));
+		if(type==Bool)
+			return uint64_t(Bool.value(ex));
+		if(type==BigInteger)
+			return string_id(BigInteger.value(ex).to_string());
+		if(type==Rational){
+			Fraction v = Rational.value(ex);
+			return string_id(v.numerator().to_string()+"/"+v.denominator().to_string());
+		}
+		throw WorkspaceFileError(string("Can't save a value of type ")+type.name);
+	}
+
+	// returns the index of ex's node
+	uint64_t add(const Expr& ex){
+		size_t start = nodes.size();
+		for(const Expr& child : ex)
+			add(child);
+		nodes.push_back({type_id(ex.type()),uint32_t(ex.child_count()),nodes.size()-start+1,value(ex)});
+		return nodes.size()-1;
+	}
+};
+
+void align(string& out){
+	out.resize((out.size()+7)/8*8,'\0');
+}
+
+template<typename T>
+void append(string& out, const T& v){
+	out.append(reinterpret_cast<const char*>(&v),sizeof(T));
+}
+
+// offsets of each string (and one past the last) into the text that follows them
+uint64_t append_table(string& out, const std::vector<string>& strings){
+	align(out);
+	uint64_t offset = out.size();
+	uint64_t position = 0;
+	for(const string& str : strings){
+		append(out,position);
+		position += str.size();
+	}
+	append(out,position);
+	for(const string& str : strings)
+		out += str;
+	return offset;
+}
+
+}
+
+// the mode of the file at path, or if there isn't one, 0666 less the umask (read from /proc where it
+// can be, since setting it to read it back races with other threads creating files)
+static mode_t new_file_mode(const string& path){
+	struct stat st;
+	if(stat(path.c_str(),&st)==0)
+		return st.st_mode&07777;
+	mode_t mask = 022;
+	std::ifstream status("/proc/self/status");
+	string line;
+	bool found = false;
+	while(!found && std::getline(status,line)){
+		if(line.rfind("Umask:",0)==0){
+			mask = std::strtoul(line.c_str()+6,nullptr,8);
+			found = true;
+		}
+	}
+	if(!found){
+		mask = umask(022);
+		umask(mask);
+	}
+	return 0666&~mask;
+}
+
+void WorkspaceFile::save(const Workspace& workspace, const string& path){
+	Writer writer;
+	std::vector<PackedEntry> entries;
+	for(const string& name : workspace.dependency_order()){
+		uint32_t name_id = writer.string_id(name);
+		entries.push_back({name_id,0,writer.add(workspace.definition(name))});
+	}
+
+	Header header = {};
+	memcpy(header.magic,magic,sizeof(magic));
+	header.version = version;
+	header.byte_order = byte_order_mark;
+	header.type_count = writer.types.size();
+	header.string_count = writer.strings.size();
+	header.entry_count = entries.size();
+	header.node_count = writer.nodes.size();
+
+	string out(sizeof(Header),'\0');
+	header.types_offset = append_table(out,writer.types);
+	header.strings_offset = append_table(out,writer.strings);
+	align(out);
+	header.entries_offset = out.size();
+	out.append(reinterpret_cast<const char*>(entries.data()),entries.size()*sizeof(PackedEntry));
+	align(out);
+	header.nodes_offset = out.size();
+	out.append(reinterpret_cast<const char*>(writer.nodes.data()),writer.nodes.size()*sizeof(PackedNode));
+	header.file_size = out.size();
+	memcpy(out.data(),&header,sizeof(Header));
+
+	// written next to the target and renamed over it, so a failed save never leaves half a file; the
+	// temp name is unique, so saves to the same path can't write into each other's file
+	string temp = path+".XXXXXX";
+	int fd = mkstemp(temp.data());
+	if(fd<0)
+		throw WorkspaceFileError("Can't write '"+path+"': "+strerror(errno));
+	// mkstemp makes it private; the saved file gets the mode of the one it replaces, or what creating
+	// it would have given it
+	bool written = fchmod(fd,new_file_mode(path))==0;
+	for(size_t done=0;written && done<out.size();){
+		ssize_t count = write(fd,out.data()+done,out.size()-done);
+		if(count<0 && errno==EINTR)
+			continue;
+		written = count>0;
+		done += written ? count : 0;
+	}
+	if(close(fd)!=0)
+		written = false;
+	if(!written){
+		std::remove(temp.c_str());
+		throw WorkspaceFileError("Can't write '"+path+"'");
+	}
+	if(std::rename(temp.c_str(),path.c_str())!=0){
+		std::remove(temp.c_str());
+		throw WorkspaceFileError("Can't write '"+path+"': "+strerror(errno));
+	}
+}
+
+WorkspaceFile::WorkspaceFile(const string& path){
+	int fd = open(path.c_str(),O_RDONLY);
+	if(fd<0)
+		throw WorkspaceFileError("Can't open '"+path+"': "+strerror(errno));
+	struct stat info;
+	if(fstat(fd,&info)!=0 || info.st_size<off_t(sizeof(Header))){
+		close(fd);
+		throw WorkspaceFileError("'"+path+"' is not a workspace file");
+	}
+	_size = info.st_size;
+	void* mapped = mmap(nullptr,_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(mapped==MAP_FAILED)
+		throw WorkspaceFileError("Can't map '"+path+"': "+strerror(errno));
+	_data = static_cast<const char*>(mapped);
+	try{
+		validate();
+	}
+	catch(const WorkspaceFileError& err){
+		munmap(const_cast<char*>(_data),_size);
+		throw WorkspaceFileError("'"+path+"' is not a valid workspace file: "+err.what());
+	}
+}
+
+WorkspaceFile::~WorkspaceFile(){
+	munmap(const_cast<char*>(_data),_size);
+}
+
+// checks a table of count strings at offset, returning its offsets
+static const uint64_t* check_table(const char* data, size_t size, uint64_t offset, uint64_t count){
+	if(offset%8!=0 || offset>size || (size-offset)/8<count+1)
+		throw WorkspaceFileError("table out of bounds");
+	const uint64_t* offsets = reinterpret_cast<const uint64_t*>(data+offset);
+	uint64_t text = offset+(count+1)*8;
+	for(uint64_t n=0;n<count;n++){
+		if(offsets[n]>offsets[n+1])
+			throw WorkspaceFileError("table out of order");
+	}
+	if(offsets[count]>size-text)
+		throw WorkspaceFileError("table out of bounds");
+	return offsets;
+}
+
+void WorkspaceFile::validate(){
+	_header = reinterpret_cast<const Header*>(_data);
+	if(memcmp(_header->magic,magic,sizeof(magic))!=0)
+		throw WorkspaceFileError("wrong magic number");
+	if(_header->byte_order!=byte_order_mark)
+		throw WorkspaceFileError("saved with the other byte order");
+	if(_header->version!=version)
+		throw WorkspaceFileError("version "+std::to_string(_header->version)+", expected "+std::to_string(version));
+	if(_header->file_size!=_size)
+		throw WorkspaceFileError("truncated");
+
+	_type_offsets = check_table(_data,_size,_header->types_offset,_header->type_count);
+	_string_offsets = check_table(_data,_size,_header->strings_offset,_header->string_count);
+
+	std::unordered_map<string,const Type*> by_name = {{Undefined.name,&Undefined}};
+	for(const Type* type : all_types)
+		by_name.emplace(type->name,type);
+	const char* type_names = reinterpret_cast<const char*>(_type_offsets+_header->type_count+1);
+	for(uint32_t n=0;n<_header->type_count;n++){
+		string name(type_names+_type_offsets[n],_type_offsets[n+1]-_type_offsets[n]);
+		auto found = by_name.find(name);
+		if(found==by_name.end())
+			throw WorkspaceFileError("unknown type '"+name+"'");
+		_types.push_back(found->second);
+	}
+
+	if(_header->entries_offset%8!=0 || _header->entries_offset>_size ||
+			(_size-_header->entries_offset)/sizeof(PackedEntry)<_header->entry_count)
+		throw WorkspaceFileError("entries out of bounds");
+	_entries = reinterpret_cast<const PackedEntry*>(_data+_header->entries_offset);
+	if(_header->nodes_offset%8!=0 || _header->nodes_offset>_size ||
+			(_size-_header->nodes_offset)/sizeof(PackedNode)<_header->node_count)
+		throw WorkspaceFileError("nodes out of bounds");
+	_nodes = reinterpret_cast<const PackedNode*>(_data+_header->nodes_offset);
+
+	// the nodes must form whole trees in postorder
+	std::vector<uint64_t> sizes;
+	for(uint64_t n=0;n<_header->node_count;n++){
+		const PackedNode& node = _nodes[n];
+		if(node.type>=_types.size())
+			throw WorkspaceFileError("node with an unknown type");
+		const Type& type = *_types[node.type];
+		if(type.arity!=Type::INFINITARY && node.child_count!=type.arity)
+			throw WorkspaceFileError(string("node of type ")+type.name+" with the wrong number of children");
+		if((type==Symbol || type==BigInteger || type==Rational) && node.value>=_header->string_count)
+			throw WorkspaceFileError("value out of bounds");
+		if(type==Bool && node.value>uint64_t(FALSE))
+			throw WorkspaceFileError("value out of bounds");
+		if(node.child_count>sizes.size())
+			throw WorkspaceFileError("node with missing children");
+		uint64_t size = 1;
+		for(uint32_t c=0;c<node.child_count;c++){
+			size += sizes.back();
+			sizes.pop_back();
+		}
+		if(size!=node.size)
+			throw WorkspaceFileError("node with the wrong size");
+		sizes.push_back(size);
+	}
+	for(uint32_t n=0;n<_header->entry_count;n++){
+		if(_entries[n].name>=_header->string_count || _entries[n].root>=_header->node_count)
+			throw WorkspaceFileError("entry out of bounds");
+	}
+}
+
+std::string_view WorkspaceFile::string_at(size_t index) const {
+	const char* text = reinterpret_cast<const char*>(_string_offsets+_header->string_count+1);
+	return std::string_view(text+_string_offsets[index],_string_offsets[index+1]-_string_offsets[index]);
+}
+
+Expr WorkspaceFile::to_expr(size_t index) const {
+	const PackedNode& node = _nodes[index];
+	const Type& type = *_types[node.type];
+	if(type.is_value_type()){
+		if(type==Symbol)
+			return Symbol(string(string_at(node.value)));
+		if(type==Integer)
+			return Integer(int_value_t(node.value));
+		if(type==Float)
+			return Float(std::bit_cast<float_value_t>(node.value));
+		if(type==Bool)
+			return Bool(bool_value_t(node.value));
+		std::string_view text = string_at(node.value);
+		try{
+			if(type==BigInteger)
+				return BigInteger(BigInt(string(text)));
+			size_t slash = text.find('/');
+			if(type==Rational && slash!=std::string_view::npos)
+				return Rational(Fraction(BigInt(string(text.substr(0,slash))),BigInt(string(text.substr(slash+1)))));
+		}
+		catch(const std::exception&){}
+		if(type==BigInteger || type==Rational)
+			throw WorkspaceFileError(string("malformed ")+type.name+" '"+string(text)+"'");
+		throw WorkspaceFileError(string("Can't load a value of type ")+type.name);
+	}
+
+	// children from last to first
+	std::vector<size_t> children(node.child_count);
+	size_t child = index-1;
+	for(size_t n=node.child_count;n-->0;){
+		children[n] = child;
+		child -= _nodes[child].size;
+	}
+	Expr ret = type();
+	for(size_t n=0;n<children.size();n++)
+		ret.set_child(n,to_expr(children[n]));
+	return ret;
+}
+
+void WorkspaceFile::load_into(Workspace& workspace) const {
+	for(size_t n=0;n<entry_count();n++)
+		workspace.define(string(name(n)),to_expr(root(n)));
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Workspace.hpp"
+
+#include <string_view>
+
+struct WorkspaceFileError : public NamedError{
+	WorkspaceFileError(string what):NamedError("WorkspaceFileError",std::move(what)){}
+};
+
+// Read-only view of a workspace saved by save(), mapped into memory with mmap. Nothing is parsed or
+// copied until asked for: names are string_views into the mapping, and nodes are read in place.
+//
+// The format (version 1, native byte order, checked on open) is a Header, then at the offsets it gives:
+// a table of Type names, a table of strings (Symbol names, entry names, and the decimal text of
+// BigIntegers and Rationals), the entries (a name and the index of the root node of its definition),
+// and every definition's nodes in postorder. Each node has its type, child count, subtree size and
+// value; a node's last child is just before it, and each earlier child is before the subtree of the one
+// after it. Entries are saved each after the ones it references, so loading never recomputes.
+class WorkspaceFile{
+public:
+	struct Header{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t type_count;
+		uint32_t string_count;
+		uint32_t entry_count;
+		uint32_t reserved;
+		uint64_t node_count;
+		uint64_t types_offset;
+		uint64_t strings_offset;
+		uint64_t entries_offset;
+		uint64_t nodes_offset;
+		uint64_t file_size;
+	};
+	struct PackedEntry{
+		uint32_t name;
+		uint32_t reserved;
+		uint64_t root;
+	};
+	struct PackedNode{
+		uint32_t type;
+		uint32_t child_count;
+		uint64_t size;
+		// Integer: the value; Float: its bits; Bool: the FuzzyBool; Symbol, BigInteger, Rational: a string
+		uint64_t value;
+	};
+	static constexpr uint32_t version = 1;
+
+private:
+	const char* _data = nullptr;
+	size_t _size = 0;
+	const Header* _header = nullptr;
+	const uint64_t* _type_offsets = nullptr;
+	const uint64_t* _string_offsets = nullptr;
+	const PackedEntry* _entries = nullptr;
+	const PackedNode* _nodes = nullptr;
+	std::vector<const Type*> _types;
+
+	void validate();
+
+public:
+	// throws WorkspaceFileError if the file can't be mapped or isn't a valid workspace file
+	explicit WorkspaceFile(const string& path);
+	WorkspaceFile(const WorkspaceFile&)=delete;
+	WorkspaceFile& operator=(const WorkspaceFile&)=delete;
+	~WorkspaceFile();
+
+	size_t entry_count() const { return _header->entry_count; }
+	size_t node_count() const { return _header->node_count; }
+	std::string_view string_at(size_t index) const;
+	std::string_view name(size_t entry) const { return string_at(_entries[entry].name); }
+	size_t root(size_t entry) const { return _entries[entry].root; }
+	const PackedNode& node(size_t index) const { return _nodes[index]; }
+	const Type& type(size_t node) const { return *_types[_nodes[node].type]; }
+
+	// builds the definition rooted at node
+	Expr to_expr(size_t node) const;
+	// defines every entry in workspace (replacing any with the same name)
+	void load_into(Workspace& workspace) const;
+
+	// throws WorkspaceFileError if a value type can't be saved, or the file can't be written
+	static void save(const Workspace& workspace, const string& path);
+};
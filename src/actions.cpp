@@ -1,4 +1,9 @@
 #include "actions.hpp"
+#include "Profiler.hpp"
+#include "Tracer.hpp"
+#include "ThreadPool.hpp"
+
+#include <exception>
 
 void recurse_action_bottom_up(Expr& ex, void(*act)(Expr&)){
 	for(Expr& child : ex){
@@ -14,18 +19,38 @@ void recurse_action_top_down(Expr& ex, void(*act)(Expr&)){
 	}
 }
 
+static void perform_node(Expr& ex){
+	Profiler::Scope profile(Profiler::PERFORM,&ex.type());
+	if(ex.type().f_perform!=nullptr)
+		ex = ex.type().f_perform(ex,false);
+}
+
+static void perform_approx_node(Expr& ex){
+	Profiler::Scope profile(Profiler::PERFORM,&ex.type());
+	if(ex.type().f_perform!=nullptr)
+		ex = ex.type().f_perform(ex,true);
+}
+
+// counts and traces a whole perform, with the nodes it started with
+static void profile_perform(Profiler::Scope& profile, Tracer::Span& span, const Expr& expr){
+	if(profile.is_active())
+		profile.set_nodes(expr.node_count());
+	if(span.is_active())
+		span.set_arg("nodes",expr.node_count());
+}
+
 void _perform(Expr& expr){
-	recurse_action_bottom_up(expr,[](Expr& ex){
-		if(ex.type().f_perform!=nullptr)
-			ex = ex.type().f_perform(ex,false);
-	});
+	Profiler::Scope profile(Profiler::PERFORM,nullptr);
+	Tracer::Span span("perform");
+	profile_perform(profile,span,expr);
+	recurse_action_bottom_up(expr,perform_node);
 }
 
 void _perform_approx(Expr& expr){
-	recurse_action_bottom_up(expr,[](Expr& ex){
-		if(ex.type().f_perform!=nullptr)
-			ex = ex.type().f_perform(ex,true);
-	});
+	Profiler::Scope profile(Profiler::PERFORM,nullptr);
+	Tracer::Span span("perform");
+	profile_perform(profile,span,expr);
+	recurse_action_bottom_up(expr,perform_approx_node);
 }
 
 const Action& make_perform(){
@@ -39,3 +64,87 @@ const Action& make_perform_approx(){
 	return act;
 }
 const Action& perform_approx = make_perform_approx();
+
+size_t parallel_grain = 4096;
+
+// sizes[i] is the size of the subtree rooted at the i-th node in preorder
+static size_t count_nodes(const Expr& ex, std::vector<size_t>& sizes){
+	size_t index = sizes.size();
+	sizes.push_back(1);
+	size_t total = 1;
+	for(const Expr& child : ex)
+		total += count_nodes(child,sizes);
+	sizes[index] = total;
+	return total;
+}
+
+// sizes is computed up front, so each node must be reached before anything under it is replaced
+static void parallel_bottom_up(Expr& ex, size_t index, const std::vector<size_t>& sizes, void(*act)(Expr&)){
+	if(sizes[index]<parallel_grain || ex.child_count()<2){
+		recurse_action_bottom_up(ex,act);
+		return;
+	}
+	// each subtree big enough to be split, on whichever thread ends up running it
+	Tracer::Span span("subtree");
+	if(span.is_active()){
+		span.set_arg("nodes",sizes[index]);
+		span.set_text(ex.type().name);
+	}
+	std::vector<std::exception_ptr> errors(ex.child_count());
+	{
+		ThreadPool::TaskGroup group(ThreadPool::shared());
+		size_t child_index = index+1;
+		for(size_t n=0;n<ex.child_count();n++){
+			Expr* child = &ex[n];
+			std::exception_ptr* error = &errors[n];
+			auto task = [=,&sizes](){
+				try{
+					parallel_bottom_up(*child,child_index,sizes,act);
+				}
+				catch(...){
+					*error = std::current_exception();
+				}
+			};
+			if(sizes[child_index]>=parallel_grain)
+				group.run(task);
+			else
+				task();
+			child_index += sizes[child_index];
+		}
+	}
+	for(const std::exception_ptr& error : errors){
+		if(error)
+			std::rethrow_exception(error);
+	}
+	act(ex);
+}
+
+void _parallel_perform(Expr& expr){
+	Profiler::Scope profile(Profiler::PERFORM,nullptr);
+	Tracer::Span span("perform");
+	profile_perform(profile,span,expr);
+	std::vector<size_t> sizes;
+	count_nodes(expr,sizes);
+	parallel_bottom_up(expr,0,sizes,perform_node);
+}
+
+void _parallel_perform_approx(Expr& expr){
+	Profiler::Scope profile(Profiler::PERFORM,nullptr);
+	Tracer::Span span("perform");
+	profile_perform(profile,span,expr);
+	std::vector<size_t> sizes;
+	count_nodes(expr,sizes);
+	parallel_bottom_up(expr,0,sizes,perform_approx_node);
+}
+
+const Action& make_parallel_perform(){
+	static ModAction act(_parallel_perform);
+	return act;
+}
+const Action& parallel_perform = make_parallel_perform();
+
+const Action& make_parallel_perform_approx(){
+	static ModAction act(_parallel_perform_approx);
+	return act;
+}
+const Action& parallel_perform_approx = make_parallel_perform_approx();
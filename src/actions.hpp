@@ -38,12 +38,37 @@ struct ModAction : public Action{
 	ModAction(void(*fptr)(Expr&)):fptr(fptr){}
 };
 
+// pattern variables bound by a match, with what they matched, in the order they were bound
+typedef std::vector<std::pair<Expr,Expr>> Bindings;
+
+// Rewrites every match of the pattern left with right, bottom up, pass after pass until nothing matches
+// (or max_passes). In a pattern, a Symbol whose name ends in '_' (like x_) is a variable that matches any
+// expr, the same variable must match the same expr everywhere, and the children of commutative types
+// match in any order (though their count must be the same). For many rules, use a RuleSet.
 struct Rule : public Action{
+	static constexpr size_t max_passes = 32;
 	Expr left,right;
+	// throws ExprError if right uses a variable that left doesn't bind
+	Rule(Expr left, Expr right);
+	static bool is_variable(const Expr& ex);
+	// on success, adds left's variables to bindings; on failure, bindings is left as it was
+	bool match(const Expr& ex, Bindings& bindings) const;
+	// right, with the variables replaced by what they were bound to
+	Expr substitute(const Bindings& bindings) const;
 	virtual Expr operator()(const Expr& ex) const override;
 	virtual Expr operator()(Expr&& ex) const override;
 	virtual void in_place(Expr& ex) const override;
 };
 
+// apply act to every node, children before parents (or parents before children)
+void recurse_action_bottom_up(Expr& ex, void(*act)(Expr&));
+void recurse_action_top_down(Expr& ex, void(*act)(Expr&));
+
 extern const Action& perform;
 extern const Action& perform_approx;
+
+// Same result as perform/perform_approx, but subtrees of at least parallel_grain nodes are forked onto
+// ThreadPool::shared(). If several subtrees throw, the one the serial action would have reached first wins.
+extern const Action& parallel_perform;
+extern const Action& parallel_perform_approx;
+extern size_t parallel_grain;
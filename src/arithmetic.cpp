@@ -1,6 +1,8 @@
 #include "Expr.hpp"
 #include <cmath>
 #include <cfloat>
+#include <limits>
+#include <algorithm>
 
 template<typename RET,typename...ARGS>
 using FuncPtr = RET (*)(ARGS...);
@@ -25,12 +27,73 @@ Expr add_perform_t(const Expr& ex){
 	}
 }
 
+// exact fold for Add and Mul: stays on int_value_t until a step overflows (or a BigInteger shows up),
+// then carries on in BigInt. Rational children are folded separately and combined at the end.
+// OP_CHECKED is a __builtin_*_overflow.
+template<const Type& TYPE, int_value_t IDENTITY, bool (*OP_CHECKED)(int_value_t,int_value_t,int_value_t*),
+	void (*OP_BIG)(BigInt&,const BigInt&), void (*OP_RATIONAL)(Fraction&,const Fraction&)>
+Expr fold_perform_exact(const Expr& ex){
+	int_value_t small = IDENTITY;
+	BigInt big;
+	bool is_big = false;
+	Fraction rational = BigInt(IDENTITY);
+	bool is_rational = false;
+	Expr ret = TYPE();
+	for(const Expr& child : ex){
+		const Type& type = child.type();
+		if(type.f_get_bigint==nullptr){
+			if(type.f_get_rational!=nullptr){
+				OP_RATIONAL(rational,type.f_get_rational(child));
+				is_rational = true;
+			}
+			else{
+				ret.add_child(child);
+			}
+			continue;
+		}
+		int_value_t result;
+		if(!is_big && type.f_get_int!=nullptr && !OP_CHECKED(small,type.f_get_int(child),&result)){
+			small = result;
+			continue;
+		}
+		if(!is_big){
+			big = small;
+			is_big = true;
+		}
+		OP_BIG(big,type.f_get_bigint(child));
+	}
+	Expr total;
+	if(is_rational){
+		Fraction whole = is_big ? Fraction(big) : Fraction(BigInt(small));
+		OP_RATIONAL(whole,rational);
+		total = Expr(whole);
+	}
+	else{
+		total = is_big ? Expr(big) : Expr(small);
+	}
+	if(ret.child_count()==0){
+		return total;
+	}
+	else{
+		ret.add_child(total);
+		return ret;
+	}
+}
+
+bool add_checked(int_value_t a, int_value_t b, int_value_t* out){ return __builtin_add_overflow(a,b,out); }
+bool sub_checked(int_value_t a, int_value_t b, int_value_t* out){ return __builtin_sub_overflow(a,b,out); }
+bool mul_checked(int_value_t a, int_value_t b, int_value_t* out){ return __builtin_mul_overflow(a,b,out); }
+void add_big(BigInt& a, const BigInt& b){ a += b; }
+void mul_big(BigInt& a, const BigInt& b){ a *= b; }
+void add_rational(Fraction& a, const Fraction& b){ a += b; }
+void mul_rational(Fraction& a, const Fraction& b){ a *= b; }
+
 Expr add_perform(const Expr& ex, bool allow_approx){
 	ASSERT_EQUAL(ex.type(),Add);
 	if(allow_approx){
 		return add_perform_t<float_value_t,&Type::f_get_float>(ex);
 	}else{
-		return add_perform_t<int_value_t,&Type::f_get_int>(ex);
+		return fold_perform_exact<Add,0,add_checked,add_big,add_rational>(ex);
 	}
 }
 
@@ -38,6 +101,7 @@ consteval Type make_add(){
 	Type type;
 	type.name="Add";
 	type.parse_string = R"(((?&EXPR))\+((?&EXPR)))";
+	type.parse_token = "+";
 	type.print_string = "$1 + $2";
 	type.arity = Type::INFINITARY;
 	type.pemdas = 60;
@@ -63,7 +127,15 @@ Expr sub_perform(const Expr& ex, bool allow_approx){
 	if(allow_approx){
 		return sub_perform_t<float_value_t, &Type::f_get_float>(ex);
 	}else{
-		return sub_perform_t<int_value_t, &Type::f_get_int>(ex);
+		if(ex[0].type().f_get_rational==nullptr || ex[1].type().f_get_rational==nullptr)
+			return ex;
+		if(ex[0].type().f_get_bigint==nullptr || ex[1].type().f_get_bigint==nullptr)
+			return Expr((ex[0].type().f_get_rational)(ex[0])-(ex[1].type().f_get_rational)(ex[1]));
+		int_value_t result;
+		if(ex[0].type().f_get_int!=nullptr && ex[1].type().f_get_int!=nullptr &&
+			!sub_checked((ex[0].type().f_get_int)(ex[0]),(ex[1].type().f_get_int)(ex[1]),&result))
+			return Expr(result);
+		return Expr((ex[0].type().f_get_bigint)(ex[0])-(ex[1].type().f_get_bigint)(ex[1]));
 	}
 }
 
@@ -71,6 +143,7 @@ consteval Type make_sub(){
 	Type type;
 	type.name = "Sub";
 	type.parse_string = R"(((?:(?&EXPR)\-)*(?&EXPR))(?<=[\w\)\]\}])\s*\-((?&EXPR)))";
+	type.parse_token = "-";
 	type.print_string = "$1 - $2";
 	type.arity = Type::BINARY;
 	type.pemdas = 50;
@@ -107,7 +180,7 @@ Expr mul_perform(const Expr& ex, bool allow_approx){
 	if(allow_approx){
 		return mul_perform_t<float_value_t,&Type::f_get_float>(ex);
 	}else{
-		return mul_perform_t<int_value_t,&Type::f_get_int>(ex);
+		return fold_perform_exact<Mul,1,mul_checked,mul_big,mul_rational>(ex);
 	}
 }
 
@@ -115,6 +188,7 @@ consteval Type make_mul(){
 	Type type;
 	type.name="Mul";
 	type.parse_string = R"(((?&EXPR))\*((?&EXPR)))";
+	type.parse_token = "*";
 	type.print_string = "$1*$2";
 	type.arity = Type::INFINITARY;
 	type.pemdas = 40;
@@ -137,15 +211,21 @@ Expr div_perform(const Expr& ex, bool allow_approx){
 			return Undefined();
 		return Expr(left/right);
 	}else{
-		if(ex[0].type().f_get_int==nullptr || ex[1].type().f_get_int==nullptr)
+		if(ex[0].type().f_get_rational==nullptr || ex[1].type().f_get_rational==nullptr)
 			return ex;
-		int_value_t left = (ex[0].type().f_get_int)(ex[0]);
-		int_value_t right = (ex[1].type().f_get_int)(ex[1]);
-		if(right==0)
+		if(ex[0].type().f_get_int!=nullptr && ex[1].type().f_get_int!=nullptr){
+			int_value_t left = (ex[0].type().f_get_int)(ex[0]);
+			int_value_t right = (ex[1].type().f_get_int)(ex[1]);
+			if(right==0)
+				return Undefined();
+			// INT64_MIN/-1 is the one quotient that overflows (and so does its remainder)
+			if(!(left==std::numeric_limits<int_value_t>::min() && right==-1) && left%right==0)
+				return Expr(left/right);
+		}
+		Fraction right = (ex[1].type().f_get_rational)(ex[1]);
+		if(right.is_zero())
 			return Undefined();
-		if(left%right!=0)
-			return ex;
-		return Expr(left/right);
+		return Expr((ex[0].type().f_get_rational)(ex[0])/right);
 	}
 }
 
@@ -153,6 +233,7 @@ consteval Type make_div(){
 	Type type;
 	type.name = "Div";
 	type.parse_string = R"(((?:(?&EXPR)/)*(?&EXPR))/((?&EXPR)))";
+	type.parse_token = "/";
 	type.print_string = "$1/$2";
 	type.arity = Type::BINARY;
 	type.pemdas = 30;
@@ -170,9 +251,16 @@ Expr neg_perform(const Expr& ex, bool allow_approx){
 			return ex;
 		return -(ex[0].type().f_get_float)(ex[0]);
 	}else{
-		if(ex[0].type().f_get_int==nullptr)
+		if(ex[0].type().f_get_rational==nullptr)
 			return ex;
-		return -(ex[0].type().f_get_int)(ex[0]);
+		if(ex[0].type().f_get_bigint==nullptr)
+			return Expr(-(ex[0].type().f_get_rational)(ex[0]));
+		if(ex[0].type().f_get_int!=nullptr){
+			int_value_t v = (ex[0].type().f_get_int)(ex[0]);
+			if(v!=std::numeric_limits<int_value_t>::min())
+				return -v;
+		}
+		return Expr(-(ex[0].type().f_get_bigint)(ex[0]));
 	}
 }
 
@@ -180,6 +268,7 @@ consteval Type make_neg(){
 	Type type;
 	type.name = "Neg";
 	type.parse_string = R"(\s*-((?&EXPR)))";
+	type.parse_token = "-";
 	type.print_string = "-$1";
 	type.arity = Type::UNARY;
 	type.pemdas = 20;
@@ -190,27 +279,37 @@ consteval Type make_neg(){
 constexpr Type Neg = make_neg();
 REGISTER_TYPE(Neg);
 
-int_value_t int_pow(int_value_t b,int_value_t p){
+// b^p for p>=0 (or b in {-1,0,1}); false if the result overflows
+bool int_pow(int_value_t b,int_value_t p,int_value_t& out){
 	switch(b){
 		case 0:
-			return p==0;
+			out = p==0;
+			return true;
 		case -1:
-			return labs(p)%2 * 2 - 1;
+			out = 1 - labs(p)%2 * 2;
+			return true;
 		case 1:
-			return 1;
+			out = 1;
+			return true;
 		default:
 			int_value_t i=1;
 			while (p) {
 				if (p & 1) {
-					i *= b;
+					if(__builtin_mul_overflow(i,b,&i))
+						return false;
 				}
-				b *= b;
 				p >>= 1;
+				if(p && __builtin_mul_overflow(b,b,&b))
+					return false;
 			}
-			return i;
+			out = i;
+			return true;
 	}
 }
 
+// exact powers with more bits than this are left unevaluated
+constexpr size_t max_pow_bits = 1<<20;
+
 Expr pow_perform(const Expr& ex, bool allow_approx){
 	ASSERT_EQUAL(ex.type(),Pow);
 	if(allow_approx){
@@ -222,24 +321,42 @@ Expr pow_perform(const Expr& ex, bool allow_approx){
 			return Undefined();
 		return Expr(pow(left,right));
 	}else{
-		if(ex[0].type().f_get_int==nullptr || ex[1].type().f_get_int==nullptr)
+		// rational powers (roots) are left alone
+		if(ex[0].type().f_get_rational==nullptr || ex[1].type().f_get_bigint==nullptr)
 			return ex;
-		int_value_t left = (ex[0].type().f_get_int)(ex[0]);
-		int_value_t right = (ex[1].type().f_get_int)(ex[1]);
-		if(!(right>=0 || left==1 || left==0 || left==-1))
+		Fraction base = (ex[0].type().f_get_rational)(ex[0]);
+		BigInt exponent = (ex[1].type().f_get_bigint)(ex[1]);
+		const BigInt& num = base.numerator();
+		bool trivial_base = base.is_integer() && num.fits_int64() && num.to_int64()>=-1 && num.to_int64()<=1;
+		if(!exponent.fits_int64()){
+			if(!trivial_base)
+				return ex;
+			// only the sign and parity of the exponent matter; stand in a small one with the same
+			exponent = BigInt(exponent.is_negative() ? -2 : 2)+BigInt(exponent.is_odd());
+		}
+		int_value_t right = exponent.to_int64();
+		if(base.is_zero() && right<0)
+			return Undefined();
+		int_value_t result;
+		if(base.is_integer() && num.fits_int64() && (right>=0 || trivial_base) && int_pow(num.to_int64(),right,result))
+			return Expr(result);
+		uint64_t magnitude = right<0 ? 0-uint64_t(right) : uint64_t(right);
+		size_t bits = std::max(num.bit_length(),base.denominator().bit_length());
+		if(magnitude>0 && bits>max_pow_bits/magnitude)
 			return ex;
-		return Expr(int_pow(left,right));
+		return Expr(Fraction::pow(base,right));
 	}
 }
 
 consteval Type make_pow(){
 	Type type;
-	type.name = "Div";
+	type.name = "Pow";
 	type.parse_string = R"(((?&EXPR))\^((?&EXPR)(?:\^(?&EXPR))*))";
+	type.parse_token = "^";
 	type.print_string = "$1^$2";
 	type.arity = Type::BINARY;
 	type.pemdas = 10;
-	type.flags = Type::ENTRYWISE;
+	type.flags = Type::ENTRYWISE|Type::RIGHT_ASSOCIATIVE;
 	type.f_perform = pow_perform;
 	return type;
 }
@@ -0,0 +1,97 @@
+#include "Pipeline.hpp"
+#include "Tracer.hpp"
+
+#include <fstream>
+
+// symbolic-batch: runs files (or stdin) through a Session as the kernel would, without Jupyter
+
+static const char* usage =
+	"Usage: symbolic-batch [-j workers] [--queue lines] [--no-perform] [--trace out.json] [file...]\n"
+	"Runs each line of the files (or of stdin, if there are none or a file is '-') as a cell line in\n"
+	"the kernel would be run, one Session for all of them. Declarations are performed before they\n"
+	"are echoed, unless --no-perform is given. Output is in input order; failed lines are reported on\n"
+	"stderr as file:line: ErrorName: message, and the exit status is 1 if any line failed. --trace saves\n"
+	"a timeline of the whole run as a Chrome trace.\n";
+
+static size_t parse_count(const string& option, const char* value){
+	try{
+		size_t used;
+		long long count = std::stoll(value,&used);
+		if(used==string(value).size() && count>0)
+			return count;
+	}
+	catch(const std::logic_error&){}
+	std::cerr<<"Expected a positive number after "<<option<<", got '"<<value<<"'"<<std::endl;
+	std::exit(2);
+}
+
+int main(int argc, char** argv){
+	size_t workers = std::thread::hardware_concurrency();
+	size_t depth = 64;
+	bool perform = true;
+	string trace_file;
+	std::vector<string> files;
+
+	for(int n=1;n<argc;n++){
+		string arg = argv[n];
+		if((arg=="-j" || arg=="--queue") && n+1<argc){
+			size_t count = parse_count(arg,argv[++n]);
+			(arg=="-j" ? workers : depth) = count;
+		}
+		else if(arg=="--no-perform"){
+			perform = false;
+		}
+		else if(arg=="--trace" && n+1<argc){
+			trace_file = argv[++n];
+		}
+		else if(arg=="-h" || arg=="--help"){
+			std::cout<<usage;
+			return 0;
+		}
+		else if(arg.size()>1 && arg[0]=='-'){
+			std::cerr<<"Unknown option '"<<arg<<"'\n"<<usage;
+			return 2;
+		}
+		else{
+			files.push_back(arg);
+		}
+	}
+	if(files.empty())
+		files.push_back("-");
+
+	std::ios::sync_with_stdio(false);
+	Tracer::set_thread_name("main");
+	if(!trace_file.empty())
+		Tracer::start();
+	Session session;
+	// the whole of every result, unless the input asks for less with $limits
+	session.print_limits = PrintLimits();
+	Pipeline pipeline(session,workers,depth);
+	pipeline.perform = perform;
+
+	size_t errors = 0;
+	for(const string& file : files){
+		if(file=="-"){
+			errors += pipeline.run(std::cin,std::cout,std::cerr);
+			continue;
+		}
+		std::ifstream in(file);
+		if(!in){
+			std::cerr<<"Can't open '"<<file<<"'"<<std::endl;
+			errors++;
+			continue;
+		}
+		errors += pipeline.run(in,std::cout,std::cerr,file);
+	}
+
+	if(!trace_file.empty()){
+		Tracer::stop();
+		std::ofstream out(trace_file);
+		Tracer::write(out);
+		if(!out){
+			std::cerr<<"Can't write '"<<trace_file<<"'"<<std::endl;
+			errors++;
+		}
+	}
+	return errors==0 ? 0 : 1;
+}
@@ -0,0 +1,524 @@
+#include "ExprGenerator.hpp"
+#include "Program.hpp"
+#include "RuleSet.hpp"
+#include "WorkspaceFile.hpp"
+#include "actions.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <unistd.h>
+
+// symbolic_bench: times the basic operations on Exprs from ExprGenerator, and reports them as JSON
+
+static const char* usage =
+	"Usage: symbolic_bench [--seed N] [--sizes N,N,...] [--depth N] [--width N] [--symbols N]\n"
+	"                      [--mix Type=weight,...] [--min-time seconds] [--filter name,...] [--out file]\n"
+	"Times parse, to_string, hash, is_identical_to, copy, move, perform, perform_approx, round_trip\n"
+	"(parse, perform and print) and workspace_load (rebuilding the parsed expr from a $save file, to\n"
+	"compare with parse) on a generated expr of each size (16,1024,65536 by default: from one\n"
+	"cell's worth to a large result), and parse_chain on a-b-b-... with as many terms as the size.\n"
+	"evaluate_tree, evaluate_program and evaluate_columns evaluate x*x+3*x*y-y/(x+1)-x*y*y+2*x-y over\n"
+	"as many rows as the size: with perform_approx, with a Program a row at a time, and with\n"
+	"Program::evaluate_columns. rewrite_rules rewrites a sum of as many powers as the size with a\n"
+	"RuleSet of 10001 rules. Each is repeated in batches until min-time (0.2 by default) has been\n"
+	"spent on it. Prints JSON to stdout (or to the --out file), with ns and heap allocations per node\n"
+	"(or row) for each benchmark and size.\n";
+
+// Heap allocations are counted by wrapping glibc's malloc. Only the benchmarking thread is counted,
+// and memory from aligned_alloc and the like isn't; nothing in the timed code uses them.
+static thread_local size_t thread_allocations = 0;
+static thread_local size_t thread_allocated_bytes = 0;
+
+#if defined(__GLIBC__)
+static constexpr bool counts_allocations = true;
+extern "C" {
+	void* __libc_malloc(size_t);
+	void* __libc_calloc(size_t,size_t);
+	void* __libc_realloc(void*,size_t);
+	void __libc_free(void*);
+
+	void* malloc(size_t bytes){
+		thread_allocations++;
+		thread_allocated_bytes += bytes;
+		return __libc_malloc(bytes);
+	}
+	void* calloc(size_t count, size_t bytes){
+		thread_allocations++;
+		thread_allocated_bytes += count*bytes;
+		return __libc_calloc(count,bytes);
+	}
+	void* realloc(void* ptr, size_t bytes){
+		thread_allocations++;
+		thread_allocated_bytes += bytes;
+		return __libc_realloc(ptr,bytes);
+	}
+	void free(void* ptr){
+		__libc_free(ptr);
+	}
+}
+#else
+static constexpr bool counts_allocations = false;
+#endif
+
+// keeps the compiler from dropping a result nothing reads
+static volatile size_t sink;
+
+// what the timed parts of a benchmark added up to
+struct Sample{
+	size_t ops = 0;
+	double seconds = 0;
+	size_t allocations = 0;
+	size_t bytes = 0;
+
+	// times f, which does count operations; only this counts, so setup and cleanup go outside it
+	template<typename F> void time(size_t count, F f){
+		size_t allocations_before = thread_allocations;
+		size_t bytes_before = thread_allocated_bytes;
+		auto start = std::chrono::steady_clock::now();
+		f();
+		auto stop = std::chrono::steady_clock::now();
+		seconds += std::chrono::duration<double>(stop-start).count();
+		allocations += thread_allocations-allocations_before;
+		bytes += thread_allocated_bytes-bytes_before;
+		ops += count;
+	}
+};
+
+// the input of every benchmark at one size
+struct Case{
+	size_t size;
+	// expr is what the benchmarks read. cold is the same tree, but is never hashed (only copied), so
+	// copies of it have no memoized hashes.
+	Expr expr, cold;
+	string text;
+	size_t nodes, parsed_nodes;
+	// a-b-b-...-b, with size terms: one long run of a single operator
+	string chain;
+	size_t chain_nodes;
+};
+
+struct Benchmark{
+	const char* name;
+	// does batch operations (and any setup they need) on the case, timing only the operations
+	std::function<void(const Case&, size_t batch, Sample&)> run;
+	// the nodes one operation works through (the rows, for the evaluate benchmarks)
+	size_t (*nodes)(const Case&);
+};
+
+static size_t expr_nodes(const Case& c){ return c.nodes; }
+static size_t parsed_nodes(const Case& c){ return c.parsed_nodes; }
+static size_t chain_nodes(const Case& c){ return c.chain_nodes; }
+static size_t rows(const Case& c){ return c.size; }
+// a sum of size terms s^k for rewrite_rules, each matching one of its rules
+static size_t powers_nodes(const Case& c){ return 3*c.size+1; }
+
+static const RuleSet& power_rules(){
+	// x_^k -> x_*k for k from 2 to 10001, and x_+x_ -> x_*2
+	static const RuleSet& rules = *[](){
+		RuleSet* ret = new RuleSet();
+		for(int_value_t k=2;k<10002;k++)
+			ret->add(Rule(Pow(Symbol("x_"),Integer(k)),Mul(Symbol("x_"),Integer(k))));
+		ret->add(Rule(Expr("x_+x_"),Expr("x_*2")));
+		return ret;
+	}();
+	return rules;
+}
+
+// the evaluate benchmarks run this over size rows of x and y, three ways
+static const char* evaluated = "x*x+3*x*y-y/(x+1)-x*y*y+2*x-y";
+
+static std::vector<float_value_t> column(size_t rows, size_t period, float_value_t scale){
+	std::vector<float_value_t> ret(rows);
+	for(size_t n=0;n<rows;n++)
+		ret[n] = (n%period)*scale;
+	return ret;
+}
+
+static Expr substituted(const Expr& ex, float_value_t x, float_value_t y){
+	if(ex.type()==Symbol)
+		return Float(Symbol.value(ex)=="x" ? x : y);
+	Expr ret = ex;
+	for(Expr& child : ret)
+		child = substituted(child,x,y);
+	return ret;
+}
+
+static const std::vector<Benchmark> benchmarks = {
+	{"parse",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.emplace_back(c.text);
+		});
+	},parsed_nodes},
+	{"parse_chain",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.emplace_back(c.chain);
+		});
+	},chain_nodes},
+	{"to_string",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<string> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.push_back(to_string(c.expr));
+		});
+	},expr_nodes},
+	{"hash",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<Expr> copies(batch,c.cold);
+		hash_t h = 0;
+		sample.time(batch,[&](){
+			for(const Expr& copy : copies)
+				h ^= copy.hash();
+		});
+		sink = h;
+	},expr_nodes},
+	{"is_identical_to",[](const Case& c, size_t batch, Sample& sample){
+		// without memoized hashes, so every node is compared
+		std::vector<Expr> copies(batch,c.cold);
+		size_t same = 0;
+		sample.time(batch,[&](){
+			for(const Expr& copy : copies)
+				same += copy.is_identical_to(c.cold);
+		});
+		if(same!=batch)
+			ERROR("a copy isn't identical to its original");
+	},expr_nodes},
+	{"copy",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.push_back(c.expr);
+		});
+	},expr_nodes},
+	{"move",[](const Case& c, size_t batch, Sample& sample){
+		// a move doesn't depend on the size of the tree, so the same copies go back and forth, more times
+		// the larger they are; otherwise making them would take all the time
+		size_t passes = std::max<size_t>(1024,16*c.nodes);
+		std::vector<Expr> copies(batch,c.expr);
+		std::vector<Expr> out(batch);
+		sample.time(2*passes*batch,[&](){
+			for(size_t pass=0;pass<passes;pass++){
+				for(size_t n=0;n<batch;n++)
+					out[n] = std::move(copies[n]);
+				for(size_t n=0;n<batch;n++)
+					copies[n] = std::move(out[n]);
+			}
+		});
+	},expr_nodes},
+	{"perform",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.push_back(perform(c.expr));
+		});
+	},expr_nodes},
+	{"perform_approx",[](const Case& c, size_t batch, Sample& sample){
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.push_back(perform_approx(c.expr));
+		});
+	},expr_nodes},
+	{"round_trip",[](const Case& c, size_t batch, Sample& sample){
+		// what a declaration costs the kernel
+		std::vector<string> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				out.push_back(to_string(perform(Expr(c.text))));
+		});
+	},parsed_nodes},
+	{"evaluate_tree",[](const Case& c, size_t batch, Sample& sample){
+		// perform_approx on the expr with each row's values put in
+		Expr expr(evaluated);
+		std::vector<float_value_t> x = column(c.size,17,0.25), y = column(c.size,5,0.5);
+		size_t defined = 0;
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++){
+				for(size_t row=0;row<c.size;row++)
+					defined += perform_approx(substituted(expr,x[row],y[row])).type()==Float;
+			}
+		});
+		sink = defined;
+	},rows},
+	{"evaluate_program",[](const Case& c, size_t batch, Sample& sample){
+		// a compiled Program, a row at a time
+		Program program(Expr(evaluated),{"x","y"});
+		std::vector<float_value_t> x = column(c.size,17,0.25), y = column(c.size,5,0.5);
+		std::vector<float_value_t> values(2*c.size), out(c.size);
+		for(size_t row=0;row<c.size;row++){
+			values[2*row] = x[row];
+			values[2*row+1] = y[row];
+		}
+		std::unique_ptr<bool[]> defined(new bool[c.size]);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				program(values.data(),c.size,out.data(),defined.get());
+		});
+	},rows},
+	{"evaluate_columns",[](const Case& c, size_t batch, Sample& sample){
+		// the same Program, a block of rows at a time
+		Program program(Expr(evaluated),{"x","y"});
+		std::vector<float_value_t> x = column(c.size,17,0.25), y = column(c.size,5,0.5), out(c.size);
+		const float_value_t* columns[] = {x.data(),y.data()};
+		std::vector<uint8_t> undefined(c.size);
+		sample.time(batch,[&](){
+			for(size_t n=0;n<batch;n++)
+				program.evaluate_columns(columns,c.size,out.data(),undefined.data());
+		});
+	},rows},
+	{"rewrite_rules",[](const Case& c, size_t batch, Sample& sample){
+		// with 10001 rules, each node is only matched against the few the index finds for it
+		const RuleSet& rules = power_rules();
+		Expr sum = Add();
+		for(size_t n=0;n<c.size;n++)
+			sum.add_child(Pow(Symbol("s"),Integer(2+(n*5)%10000)));
+		std::vector<Expr> copies(batch,sum);
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			for(Expr& copy : copies)
+				out.push_back(rules(std::move(copy)));
+		});
+	},powers_nodes},
+	{"workspace_load",[](const Case& c, size_t batch, Sample& sample){
+		// the same exprs parse builds, from a file saved with one entry per operation
+		Workspace workspace;
+		Expr parsed(c.text);
+		for(size_t n=0;n<batch;n++)
+			workspace.define("e"+std::to_string(n),parsed);
+		string path = (std::filesystem::temp_directory_path()/("symbolic_bench_"+std::to_string(getpid()))).string();
+		WorkspaceFile::save(workspace,path);
+		std::vector<Expr> out;
+		out.reserve(batch);
+		sample.time(batch,[&](){
+			WorkspaceFile file(path);
+			for(size_t n=0;n<file.entry_count();n++)
+				out.push_back(file.to_expr(file.root(n)));
+		});
+		std::filesystem::remove(path);
+	},parsed_nodes},
+};
+
+static std::vector<string> split_list(const string& list){
+	std::vector<string> ret;
+	std::stringstream in(list);
+	string item;
+	while(std::getline(in,item,','))
+		ret.push_back(item);
+	return ret;
+}
+
+static size_t parse_count(const string& option, const string& value){
+	try{
+		size_t used;
+		long long count = std::stoll(value,&used);
+		if(used==value.size() && count>0)
+			return count;
+	}
+	catch(const std::logic_error&){}
+	std::cerr<<"Expected a positive number after "<<option<<", got '"<<value<<"'"<<std::endl;
+	std::exit(2);
+}
+
+static string json_string(const string& str){
+	string ret = "\"";
+	for(char c : str){
+		if(c=='"' || c=='\\'){
+			ret += '\\';
+			ret += c;
+		}
+		else if(static_cast<unsigned char>(c)<0x20){
+			char escaped[8];
+			std::snprintf(escaped,sizeof(escaped),"\\u%04x",c);
+			ret += escaped;
+		}
+		else{
+			ret += c;
+		}
+	}
+	return ret+"\"";
+}
+
+static string json_number(double value){
+	std::ostringstream out;
+	out.precision(6);
+	out<<value;
+	return out.str();
+}
+
+int main(int argc, char** argv){
+	ExprGenerator::Options options;
+	std::vector<size_t> sizes = {16,1024,65536};
+	double min_time = 0.2;
+	std::vector<string> filter;
+	string out_file;
+
+	for(int n=1;n<argc;n++){
+		string arg = argv[n];
+		if(arg=="-h" || arg=="--help"){
+			std::cout<<usage;
+			return 0;
+		}
+		if(arg.size()<2 || arg[0]!='-' || n+1>=argc){
+			std::cerr<<"Unknown option '"<<arg<<"'\n"<<usage;
+			return 2;
+		}
+		string value = argv[++n];
+		if(arg=="--seed")
+			options.seed = parse_count(arg,value);
+		else if(arg=="--sizes"){
+			sizes.clear();
+			for(const string& size : split_list(value))
+				sizes.push_back(parse_count(arg,size));
+		}
+		else if(arg=="--depth")
+			options.max_depth = parse_count(arg,value);
+		else if(arg=="--width")
+			options.max_width = parse_count(arg,value);
+		else if(arg=="--symbols")
+			options.symbols = parse_count(arg,value);
+		else if(arg=="--mix"){
+			try{
+				options.mix = ExprGenerator::parse_mix(value);
+			}
+			catch(const NamedError& err){
+				std::cerr<<err.name<<": "<<err.what()<<std::endl;
+				return 2;
+			}
+		}
+		else if(arg=="--min-time"){
+			try{
+				min_time = std::stod(value);
+			}
+			catch(const std::logic_error&){
+				std::cerr<<"Expected a number of seconds after --min-time, got '"<<value<<"'"<<std::endl;
+				return 2;
+			}
+		}
+		else if(arg=="--filter")
+			filter = split_list(value);
+		else if(arg=="--out")
+			out_file = value;
+		else{
+			std::cerr<<"Unknown option '"<<arg<<"'\n"<<usage;
+			return 2;
+		}
+	}
+
+	std::ostringstream json;
+	json<<"{\n";
+	json<<"\t\"format\": 1,\n";
+	json<<"\t\"compiler\": "<<json_string(__VERSION__)<<",\n";
+#ifdef NDEBUG
+	json<<"\t\"ndebug\": true,\n";
+#else
+	json<<"\t\"ndebug\": false,\n";
+#endif
+	json<<"\t\"seed\": "<<options.seed<<",\n";
+	json<<"\t\"max_depth\": "<<options.max_depth<<",\n";
+	json<<"\t\"max_width\": "<<options.max_width<<",\n";
+	json<<"\t\"symbols\": "<<options.symbols<<",\n";
+	json<<"\t\"mix\": "<<json_string(ExprGenerator::to_string(options.mix))<<",\n";
+	json<<"\t\"min_time\": "<<json_number(min_time)<<",\n";
+	json<<"\t\"counts_allocations\": "<<(counts_allocations ? "true" : "false")<<",\n";
+	json<<"\t\"results\": [";
+
+	bool first = true;
+	for(size_t size : sizes){
+		Case c;
+		try{
+			options.size = size;
+			c.expr = ExprGenerator(options)();
+			c.cold = ExprGenerator(options)();
+		}
+		catch(const NamedError& err){
+			std::cerr<<err.name<<": "<<err.what()<<std::endl;
+			return 2;
+		}
+		c.size = size;
+		c.text = to_string(c.expr);
+		c.nodes = c.expr.node_count();
+		c.parsed_nodes = Expr(c.text).node_count();
+		c.chain = "a";
+		for(size_t n=1;n<size;n++)
+			c.chain += "-b";
+		c.chain_nodes = Expr(c.chain).node_count();
+
+		for(const Benchmark& benchmark : benchmarks){
+			if(!filter.empty() && std::find(filter.begin(),filter.end(),benchmark.name)==filter.end())
+				continue;
+			std::cerr<<benchmark.name<<" "<<size<<std::endl;
+
+			size_t nodes = benchmark.nodes(c);
+			// enough operations per batch to make the clock's resolution negligible
+			size_t batch = std::max<size_t>(1,16384/nodes);
+			Sample sample;
+			string error;
+			try{
+				// once untimed, to warm up caches (and the symbol table)
+				Sample warmup;
+				benchmark.run(c,batch,warmup);
+				while(sample.seconds<min_time)
+					benchmark.run(c,batch,sample);
+			}
+			catch(const NamedError& err){
+				error = err.name+": "+err.what();
+			}
+
+			json<<(first ? "\n" : ",\n")<<"\t\t{";
+			first = false;
+			json<<"\"benchmark\": "<<json_string(benchmark.name)<<", ";
+			json<<"\"size\": "<<size<<", ";
+			json<<"\"nodes\": "<<nodes;
+			if(!error.empty()){
+				json<<", \"error\": "<<json_string(error)<<"}";
+				continue;
+			}
+			double node_ops = double(sample.ops)*nodes;
+			json<<", \"ops\": "<<sample.ops;
+			json<<", \"seconds\": "<<json_number(sample.seconds);
+			json<<", \"ns_per_op\": "<<json_number(sample.seconds*1e9/sample.ops);
+			json<<", \"ns_per_node\": "<<json_number(sample.seconds*1e9/node_ops);
+			if(counts_allocations){
+				json<<", \"allocations_per_node\": "<<json_number(sample.allocations/node_ops);
+				json<<", \"bytes_per_node\": "<<json_number(sample.bytes/node_ops);
+			}
+			else{
+				json<<", \"allocations_per_node\": null, \"bytes_per_node\": null";
+			}
+			json<<"}";
+		}
+	}
+	json<<"\n\t]\n}\n";
+
+	if(out_file.empty()){
+		std::cout<<json.str();
+	}
+	else{
+		std::ofstream out(out_file);
+		out<<json.str();
+		if(!out){
+			std::cerr<<"Can't write '"<<out_file<<"'"<<std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,294 @@
+#include "canonical.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+template<typename T>
+static int three_way(const T& a, const T& b){
+	return a<b ? -1 : b<a ? 1 : 0;
+}
+
+// a and b have the same value type
+static int compare_values(const Expr& a, const Expr& b){
+	const Type& type = a.type();
+	if(type==Symbol)
+		return three_way(Symbol.value(a),Symbol.value(b));
+	if(type.f_get_rational!=nullptr)
+		return three_way(type.f_get_rational(a),type.f_get_rational(b));
+	if(type.f_get_float!=nullptr)
+		return three_way(type.f_get_float(a),type.f_get_float(b));
+	if(type.f_get_bool!=nullptr)
+		return three_way(type.f_get_bool(a),type.f_get_bool(b));
+	return 0;
+}
+
+int canonical_compare(const Expr& a, const Expr& b){
+	const Type& ta = a.type();
+	const Type& tb = b.type();
+	if(ta!=tb){
+		if(ta.is_constant()!=tb.is_constant())
+			return ta.is_constant() ? 1 : -1;
+		if(ta.pemdas!=tb.pemdas)
+			return three_way(ta.pemdas,tb.pemdas);
+		return strcmp(ta.name,tb.name);
+	}
+	if(ta.is_value_type()){
+		int cmp = compare_values(a,b);
+		if(cmp!=0)
+			return cmp;
+	}
+	if(a.child_count()!=b.child_count())
+		return three_way(a.child_count(),b.child_count());
+	for(size_t n=0;n<a.child_count();n++){
+		int cmp = canonical_compare(a[n],b[n]);
+		if(cmp!=0)
+			return cmp;
+	}
+	return 0;
+}
+
+// ex with its children sorted
+static Expr sorted(Expr ex){
+	std::vector<Expr> children;
+	children.reserve(ex.child_count());
+	for(Expr& child : ex)
+		children.push_back(std::move(child));
+	std::sort(children.begin(),children.end(),canonical_less());
+	Expr ret = ex.type()();
+	for(Expr& child : children)
+		ret.add_child(std::move(child));
+	return ret;
+}
+
+static void flatten(Expr& ex){
+	const Type& type = ex.type();
+	bool nested = false;
+	for(const Expr& child : std::as_const(ex))
+		nested |= child.type()==type;
+	if(!nested)
+		return;
+	Expr flat = type();
+	for(Expr& child : ex){
+		if(child.type()==type){
+			for(Expr& grandchild : child)
+				flat.add_child(std::move(grandchild));
+		}
+		else{
+			flat.add_child(std::move(child));
+		}
+	}
+	ex = std::move(flat);
+}
+
+// an Add or Mul with no children or one child is its identity or that child
+static Expr unwrap(Expr ex, int_value_t identity){
+	if(ex.child_count()==0)
+		return Integer(identity);
+	if(ex.child_count()==1)
+		return ex[0];
+	return ex;
+}
+
+static bool is_rational(const Expr& ex){
+	return ex.type().f_get_rational!=nullptr;
+}
+
+// constants that can't be merged exactly (Floats) are left as they are
+static bool is_opaque(const Expr& ex){
+	return ex.type().is_constant() && !is_rational(ex);
+}
+
+// rest*coefficient, as a canonical Mul (or just rest)
+static Expr with_coefficient(Expr rest, const Fraction& coefficient){
+	if(coefficient==Fraction(1))
+		return rest;
+	Expr ret = Mul();
+	if(rest.type()==Mul){
+		for(Expr& factor : rest)
+			ret.add_child(std::move(factor));
+	}
+	else{
+		ret.add_child(std::move(rest));
+	}
+	ret.add_child(Expr(coefficient));
+	return sorted(std::move(ret));
+}
+
+// x+x*2+3 is x*3+3; terms are merged through a hash map keyed on the non-constant part
+static Expr merge_terms(const Expr& ex){
+	Fraction constant;
+	std::vector<Expr> opaque;
+	std::vector<Expr> rests;
+	std::vector<Fraction> coefficients;
+	std::unordered_map<Expr,size_t> index;
+
+	for(const Expr& child : ex){
+		if(is_rational(child)){
+			constant += child.type().f_get_rational(child);
+			continue;
+		}
+		if(is_opaque(child)){
+			opaque.push_back(child);
+			continue;
+		}
+		// child = rest*coefficient
+		Fraction coefficient = BigInt(1);
+		Expr rest;
+		const Expr* term = &child;
+		if(term->type()==Neg){
+			coefficient = -coefficient;
+			term = &(*term)[0];
+		}
+		if(term->type()==Mul){
+			Expr factors = Mul();
+			for(const Expr& factor : *term){
+				if(is_rational(factor))
+					coefficient *= factor.type().f_get_rational(factor);
+				else
+					factors.add_child(factor);
+			}
+			rest = unwrap(std::move(factors),1);
+		}
+		else{
+			rest = *term;
+		}
+		if(is_rational(rest)){
+			constant += coefficient*rest.type().f_get_rational(rest);
+			continue;
+		}
+
+		auto [found,inserted] = index.emplace(rest,rests.size());
+		if(inserted){
+			rests.push_back(std::move(rest));
+			coefficients.push_back(coefficient);
+		}
+		else{
+			coefficients[found->second] += coefficient;
+		}
+	}
+
+	Expr ret = Add();
+	for(size_t n=0;n<rests.size();n++){
+		if(!coefficients[n].is_zero())
+			ret.add_child(with_coefficient(std::move(rests[n]),coefficients[n]));
+	}
+	for(Expr& child : opaque)
+		ret.add_child(std::move(child));
+	if(!constant.is_zero())
+		ret.add_child(Expr(constant));
+	return unwrap(sorted(std::move(ret)),0);
+}
+
+// x*x^2*3*x^-1 is x^2*3 (a lone power is treated as a product of one factor); factors are merged through a hash map keyed on the base
+static Expr merge_factors(const Expr& ex){
+	Fraction coefficient = BigInt(1);
+	std::vector<Expr> opaque;
+	std::vector<Expr> bases;
+	std::vector<Fraction> exponents;
+	std::unordered_map<Expr,size_t> index;
+
+	for(const Expr& child : ex){
+		if(is_rational(child)){
+			coefficient *= child.type().f_get_rational(child);
+			continue;
+		}
+		if(is_opaque(child)){
+			opaque.push_back(child);
+			continue;
+		}
+		const Expr* factor = &child;
+		if(factor->type()==Neg){
+			coefficient = -coefficient;
+			factor = &(*factor)[0];
+		}
+		Fraction exponent = BigInt(1);
+		Expr base = *factor;
+		if(factor->type()==Pow && is_rational((*factor)[1])){
+			exponent = (*factor)[1].type().f_get_rational((*factor)[1]);
+			base = (*factor)[0];
+			// (b^e)^n is b^(e*n) for integer n
+			while(exponent.is_integer() && base.type()==Pow && is_rational(base[1])){
+				exponent *= base[1].type().f_get_rational(base[1]);
+				base = Expr(base[0]);
+			}
+		}
+
+		auto [found,inserted] = index.emplace(base,bases.size());
+		if(inserted){
+			bases.push_back(std::move(base));
+			exponents.push_back(exponent);
+		}
+		else{
+			exponents[found->second] += exponent;
+		}
+	}
+
+	if(coefficient.is_zero())
+		return Integer(0);
+	Expr ret = Mul();
+	for(size_t n=0;n<bases.size();n++){
+		if(exponents[n].is_zero())
+			continue;
+		if(exponents[n]==Fraction(1))
+			ret.add_child(std::move(bases[n]));
+		else
+			ret.add_child(Pow(std::move(bases[n]),Expr(exponents[n])));
+	}
+	for(Expr& child : opaque)
+		ret.add_child(std::move(child));
+	if(coefficient!=Fraction(1))
+		ret.add_child(Expr(coefficient));
+	return unwrap(sorted(std::move(ret)),1);
+}
+
+static void canonicalize_node(Expr& ex){
+	// constant subexpressions are folded exactly
+	if(ex.type().f_perform!=nullptr && ex.child_count()>0){
+		bool constant = true;
+		for(const Expr& child : ex)
+			constant &= is_rational(child);
+		if(constant)
+			ex = ex.type().f_perform(ex,false);
+	}
+	// subtraction, negation and division each have one form: a-b is a+b*-1, -a is a*-1 and a/b is a*b^-1
+	if(ex.type()==Neg){
+		ex = Mul(Expr(ex[0]),Integer(-1));
+	}
+	else if(ex.type()==Sub){
+		Expr negated = Mul(Expr(ex[1]),Integer(-1));
+		canonicalize_node(negated);
+		ex = Add(Expr(ex[0]),std::move(negated));
+	}
+	else if(ex.type()==Div){
+		Expr inverse = Pow(Expr(ex[1]),Integer(-1));
+		canonicalize_node(inverse);
+		ex = Mul(Expr(ex[0]),std::move(inverse));
+	}
+	else if(ex.type()==Pow && is_rational(ex[1])){
+		ex = Mul(std::move(ex));
+	}
+
+	if(ex.type().is_associative())
+		flatten(ex);
+	if(ex.type()==Add){
+		ex = merge_terms(ex);
+	}
+	else if(ex.type()==Mul){
+		ex = merge_factors(ex);
+	}
+	else if(ex.type().is_commutative()){
+		ex = sorted(std::move(ex));
+	}
+}
+
+void _canonicalize(Expr& expr){
+	recurse_action_bottom_up(expr,canonicalize_node);
+}
+
+const Action& make_canonicalize(){
+	static ModAction act(_canonicalize);
+	return act;
+}
+const Action& canonicalize = make_canonicalize();
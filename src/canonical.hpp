@@ -0,0 +1,17 @@
+#pragma once
+#include "actions.hpp"
+
+// Total order on exprs that depends only on structure and values (never on Type addresses or
+// intern ids), so it is the same in every run. Non-constants sort before constants; then by pemdas,
+// type name, value, child count and children. Returns <0, 0 or >0 like strcmp.
+int canonical_compare(const Expr& a, const Expr& b);
+
+struct canonical_less{
+	bool operator()(const Expr& a, const Expr& b) const { return canonical_compare(a,b)<0; }
+};
+
+// Bottom up: folds constant subexpressions exactly, rewrites a-b as a+b*-1, -a as a*-1 and a/b as
+// a*b^-1, flattens nested associative types, merges like terms of Add (x+2*x is x*3) and like factors
+// of Mul (x*x^2 is x^3) with exact rational coefficients, and sorts the children of every commutative
+// type by canonical_compare. Exprs equal up to those rules come out identical.
+extern const Action& canonicalize;
@@ -1,6 +1,13 @@
-#include "main.hpp"
+#include "Session.hpp"
+#include "Profiler.hpp"
+#include "Tracer.hpp"
+#include "Program.hpp"
+#include "Polynomial.hpp"
+#include "EGraph.hpp"
+#include "WorkspaceFile.hpp"
 
 #include <boost/regex.hpp>
+#include <fstream>
 
 const boost::regex empty_rex("\\s*");
 const boost::regex arg_rex("\\S+");
@@ -15,11 +22,11 @@ std::vector<string> split_args(const string& str){
 	return ret;
 }
 
-void help(Main& main, string args){
+void help(Session& session, string args){
 	boost::smatch rex_result;
 	if(boost::regex_match(args,empty_rex)){
 		for(const std::pair<string,Command>& comm : Command::all){
-			main.output<<comm.second.name<<" "<<comm.second.args<<endl;
+			session.output<<comm.second.name<<" "<<comm.second.args<<endl;
 		}
 	}
 	else{
@@ -27,11 +34,11 @@ void help(Main& main, string args){
 		for(const string& arg : argv){
 			if(Command::all.contains(arg)){
 				const Command& comm = Command::all[arg];
-				main.output<<comm.name<<" "<<comm.args<<endl;
-				main.output<<"\t"<<comm.desc<<endl;
+				session.output<<comm.name<<" "<<comm.args<<endl;
+				session.output<<"\t"<<comm.desc<<endl;
 			}
 			else{
-				main.output<<"There is no command named '"<<arg<<"'"<<endl;
+				session.output<<"There is no command named '"<<arg<<"'"<<endl;
 			}
 		}
 	}
@@ -39,21 +46,21 @@ void help(Main& main, string args){
 
 Command help_command("help","[command...]","Prints a list of all commands. If given the name of a command(s), it will print their description(s).",help);
 
-void show(Main& main, string args){
+void show(Session& session, string args){
 	std::vector<string> argv = split_args(args);
 	if(argv.size()==0){
-		for(const std::pair<string,Expr>& named_expr : main.workspace){
-			main.output<<named_expr.first<<":\t"<<to_string(named_expr.second)<<endl;
+		for(const auto& named_expr : session.workspace){
+			session.show(named_expr.first,named_expr.second);
 		}
 	}
 	else{
 		for(const string& name : argv){
-			if(main.workspace.contains(name)){
-				const Expr& expr = main.workspace[name];
-				main.output<<name<<":\t"<<to_string(expr)<<endl;
+			if(session.workspace.contains(name)){
+				const Expr& expr = session.workspace[name];
+				session.show(name,expr);
 			}
 			else{
-				main.output<<"There is no expression named '"<<name<<"'"<<endl;
+				session.output<<"There is no expression named '"<<name<<"'"<<endl;
 			}
 		}
 	}
@@ -61,18 +68,18 @@ void show(Main& main, string args){
 
 Command show_command("show","[name...]","Prints a named expression(s). If no names are given, all named expressions are printed.",show);
 
-void delete_c(Main& main, string args){
+void delete_c(Session& session, string args){
 	std::vector<string> argv = split_args(args);
 	if(argv.size()==0){
-		main.workspace.clear();
+		session.workspace.clear();
 	}
 	else{
 		for(const string& name : argv){
-			if(main.workspace.contains(name)){
-				main.workspace.erase(name);
+			if(session.workspace.contains(name)){
+				session.workspace.erase(name);
 			}
 			else{
-				main.output<<"There is no expression named '"<<name<<"'"<<endl;
+				session.output<<"There is no expression named '"<<name<<"'"<<endl;
 			}
 		}
 	}
@@ -80,19 +87,20 @@ void delete_c(Main& main, string args){
 
 Command delete_command("delete","[name...]","Deletes a named expression(s). If no names are given, all named expressions are deleted.",delete_c);
 
-void echo(Main& main, string args){
+void echo(Session& session, string args){
 	std::vector<string> argv = split_args(args);
-	if(args.size()>1)
+	if(argv.size()>1)
 		throw CommandError("Expected 'on' or 'off'");
-	if(boost::regex_match(args,empty_rex)){
-		main.echo_vars = ! main.echo_vars;
+	if(argv.empty()){
+		session.echo_vars = ! session.echo_vars;
+		return;
 	}
 	string arg = argv[0];
 	if(boost::regex_match(arg,positive_rex)){
-		main.echo_vars=true;
+		session.echo_vars=true;
 	}
 	else if(boost::regex_match(arg,negative_rex)){
-		main.echo_vars=false;
+		session.echo_vars=false;
 	}
 	else{
 		throw CommandError("Expected 'on' or 'off'");
@@ -101,49 +109,332 @@ void echo(Main& main, string args){
 
 Command echo_command("echo","[on|off]", "Toggles the printing of newly created named expressions.",echo);
 
-void _showtree(const Expr& expr, std::ostream& out, const string& prefix, const string& ext, string prefix_override=""){
+string limit_to_string(size_t limit){
+	return limit==SIZE_MAX ? "off" : std::to_string(limit);
+}
+
+void limits(Session& session, string args){
+	static const boost::regex limit_rex("(bytes|depth|width)=(?:([0-9]+)|off)");
+	std::vector<string> argv = split_args(args);
+	PrintLimits& limits = session.print_limits;
+	if(argv.size()==1 && argv[0]=="default")
+		limits = Session::default_print_limits();
+	else{
+		for(const string& arg : argv){
+			boost::smatch rex_results;
+			if(!boost::regex_match(arg,rex_results,limit_rex))
+				throw CommandError("Expected bytes=N, depth=N or width=N (or =off), got '"+arg+"'");
+			size_t value = rex_results[2].matched ? std::stoull(rex_results[2]) : SIZE_MAX;
+			if(rex_results[1]=="bytes")
+				limits.max_bytes = value;
+			else if(rex_results[1]=="depth")
+				limits.max_depth = value;
+			else
+				limits.max_width = value;
+		}
+	}
+	session.output<<"bytes="<<limit_to_string(limits.max_bytes)<<" depth="<<limit_to_string(limits.max_depth)
+		<<" width="<<limit_to_string(limits.max_width)<<endl;
+}
+
+Command limits_command("limits","[bytes=N|off] [depth=N|off] [width=N|off] | default","Sets how much of an expression is printed; what's past the limits is elided as …[n nodes]. Prints the current limits.",limits);
+
+void profile(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()>1)
+		throw CommandError("Expected 'on', 'off', 'show' or 'reset'");
+	string arg = argv.empty() ? "show" : argv[0];
+	if(boost::regex_match(arg,positive_rex)){
+		Profiler::set(true);
+	}
+	else if(boost::regex_match(arg,negative_rex)){
+		Profiler::set(false);
+	}
+	else if(arg=="show"){
+		if(!Profiler::on())
+			session.output<<"(profiling is off)"<<endl;
+		Profiler::report(session.output);
+	}
+	else if(arg=="reset"){
+		Profiler::reset();
+	}
+	else{
+		throw CommandError("Expected 'on', 'off', 'show' or 'reset'");
+	}
+}
+
+Command profile_command("profile","[on|off|show|reset]","Counts the calls, nodes, allocations and time spent parsing, performing and printing, by type, while on. 'show' (the default) prints the counts, and 'reset' zeroes them.",profile);
+
+void trace(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()==2 && argv[0]=="save"){
+		std::ofstream out(argv[1]);
+		if(!out)
+			throw CommandError("Can't write '"+argv[1]+"'");
+		Tracer::write(out);
+		if(!out)
+			throw CommandError("Can't write '"+argv[1]+"'");
+	}
+	else if(argv.size()==1 && boost::regex_match(argv[0],positive_rex)){
+		Tracer::start();
+	}
+	else if(argv.size()==1 && boost::regex_match(argv[0],negative_rex)){
+		Tracer::stop();
+	}
+	else if(!argv.empty()){
+		throw CommandError("Expected 'on', 'off' or 'save path'");
+	}
+	Tracer::collect();
+	session.output<<"tracing is "<<(Tracer::on() ? "on" : "off")<<"; "<<Tracer::event_count()<<" spans recorded";
+	if(size_t dropped = Tracer::dropped_count())
+		session.output<<" ("<<dropped<<" dropped)";
+	session.output<<endl;
+}
+
+Command trace_command("trace","[on|off|save path]","Records a timeline of every cell, line, parse, perform and print while on, and saves it as a Chrome trace (for chrome://tracing or ui.perfetto.dev). 'on' throws away any earlier recording.",trace);
+
+// children past the session's max_width, and subtrees below depth, are summarized on one line
+void _showtree(const Expr& expr, std::ostream& out, const string& prefix, const string& ext, size_t depth, size_t width,
+		string prefix_override=""){
 	if(prefix_override=="")
 		out<<prefix<<ext;
 	else
 		out<<prefix_override<<ext;
-	if(expr.type().arity==Type::NULLARY)
+	if(expr.type().arity==Type::NULLARY){
 		out<<to_string(expr)<<endl;
-	else
-		out<<expr.type().name<<endl;
+		return;
+	}
+	out<<expr.type().name;
+	if(depth==0){
+		out<<" …["<<expr.node_count()-1<<" nodes below]"<<endl;
+		return;
+	}
+	out<<endl;
 	string next_prefix=prefix;
 	if(ext==" ├╴")
 		next_prefix+=" │ ";
 	else
 		next_prefix+="   ";
 
-	for(size_t n=0;n<expr.child_count();n++){
+	size_t shown = std::min(expr.child_count(),width);
+	for(size_t n=0;n<shown;n++){
 		if(n==expr.child_count()-1)
-			_showtree(expr[n],out,next_prefix," ╰╴");
+			_showtree(expr[n],out,next_prefix," ╰╴",depth-1,width);
 		else
-			_showtree(expr[n],out,next_prefix," ├╴");
+			_showtree(expr[n],out,next_prefix," ├╴",depth-1,width);
+	}
+	if(shown<expr.child_count()){
+		size_t nodes = 0;
+		for(size_t n=shown;n<expr.child_count();n++)
+			nodes += expr[n].node_count();
+		out<<next_prefix<<" ╰╴…["<<expr.child_count()-shown<<" more children, "<<nodes<<" nodes]"<<endl;
 	}
 }
 
-void showtree(Main& main, string args){
+void showtree(Session& session, string args){
+	static const boost::regex depth_rex("depth=([0-9]+)");
 	constexpr size_t indent = 4;
-	std::vector<string> argv = split_args(args);
-	if(argv.size()==0){
-		for(const std::pair<string,Expr>& named_expr : main.workspace){
-			main.output<<named_expr.first<<":";
-			_showtree(named_expr.second,main.output,string(indent+named_expr.first.size()+1-3,' '),"",string(indent,' '));
+	size_t depth = 8;
+	std::vector<string> names;
+	for(const string& arg : split_args(args)){
+		boost::smatch rex_results;
+		if(boost::regex_match(arg,rex_results,depth_rex))
+			depth = std::stoull(rex_results[1]);
+		else
+			names.push_back(arg);
+	}
+	size_t width = session.print_limits.max_width;
+	if(names.size()==0){
+		for(const auto& named_expr : session.workspace){
+			session.output<<named_expr.first<<":";
+			_showtree(named_expr.second,session.output,string(indent+named_expr.first.size()+1-3,' '),"",depth,width,string(indent,' '));
 		}
 	}
 	else{
-		for(const string& name : argv){
-			if(main.workspace.contains(name)){
-				main.output<<name<<":";
-				_showtree(main.workspace[name],main.output,string(indent+name.size()+1-3,' '),"",string(indent,' '));
+		for(const string& name : names){
+			if(session.workspace.contains(name)){
+				session.output<<name<<":";
+				_showtree(session.workspace[name],session.output,string(indent+name.size()+1-3,' '),"",depth,width,string(indent,' '));
 			}
 			else{
-				main.output<<"There is no expression named '"<<name<<"'"<<endl;
+				session.output<<"There is no expression named '"<<name<<"'"<<endl;
 			}
 		}
 	}
 }
 
-Command showtree_command("showtree","[name...]","Prints a named expression(s) as a tree. If no names are given, all named expressions are printed.",showtree);
+Command showtree_command("showtree","[depth=N] [name...]","Prints a named expression(s) as a tree, down to the given depth (8 by default). If no names are given, all named expressions are printed.",showtree);
+
+void eval(Session& session, string args){
+	static const boost::regex binding_rex("(\\w+)=(\\S+)");
+	std::vector<string> argv = split_args(args);
+	if(argv.size()==0)
+		throw CommandError("Expected the name of an expression");
+	const string& name = argv[0];
+	if(!session.workspace.contains(name))
+		throw CommandError("There is no expression named '"+name+"'");
+
+	std::vector<string> symbols;
+	std::vector<float_value_t> values;
+	for(size_t n=1;n<argv.size();n++){
+		boost::smatch rex_results;
+		if(!boost::regex_match(argv[n],rex_results,binding_rex))
+			throw CommandError("Expected symbol=value, got '"+argv[n]+"'");
+		symbols.push_back(rex_results[1]);
+		try{
+			values.push_back(std::stod(rex_results[2]));
+		}
+		catch(const std::logic_error&){
+			throw CommandError("Not a number: '"+rex_results[2].str()+"'");
+		}
+	}
+
+	Program program(session.workspace[name],std::move(symbols));
+	std::optional<float_value_t> result = program(values.data());
+	if(result.has_value())
+		session.output<<name<<":\t"<<to_string(Expr(*result))<<endl;
+	else
+		session.output<<name<<":\t"<<to_string(Undefined())<<endl;
+}
+
+Command eval_command("eval","name [symbol=value...]","Numerically evaluates a named expression, with each symbol replaced by the given value.",eval);
+
+void expand_c(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()==0)
+		throw CommandError("Expected the name of an expression");
+	for(const string& name : argv){
+		if(!session.workspace.contains(name))
+			throw CommandError("There is no expression named '"+name+"'");
+	}
+	for(const string& name : argv)
+		session.apply(name,[](const Expr& value){ return expand(value); });
+}
+
+Command expand_command("expand","name...","Multiplies out every polynomial part of the named expression(s).",expand_c);
+
+void collect(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()!=2)
+		throw CommandError("Expected the name of an expression and a symbol");
+	const string& name = argv[0];
+	if(!session.workspace.contains(name))
+		throw CommandError("There is no expression named '"+name+"'");
+	if(!Polynomial::is_polynomial(session.workspace[name]))
+		throw CommandError("'"+name+"' is not a polynomial");
+
+	// redone whenever what name references changes, which can leave it no longer a polynomial (or too
+	// large to expand); then it's left as it is
+	string symbol = argv[1];
+	session.apply(name,[symbol](const Expr& value){
+		if(!Polynomial::is_polynomial(value))
+			return value;
+		try{
+			return Polynomial(value).collect(symbol);
+		}
+		catch(const ExprError&){
+			return value;
+		}
+	});
+}
+
+Command collect_command("collect","name symbol","Expands a polynomial and groups its terms by powers of the given symbol.",collect);
+
+void rule(Session& session, string args){
+	size_t arrow = args.find("->");
+	if(arrow==string::npos)
+		throw CommandError("Expected 'pattern -> replacement'");
+	string left = args.substr(0,arrow);
+	string right = args.substr(arrow+2);
+	if(boost::regex_match(left,empty_rex) || boost::regex_match(right,empty_rex))
+		throw CommandError("Expected 'pattern -> replacement'");
+
+	session.rules.add(Rule(Expr(left),Expr(right)));
+	const Rule& added = session.rules.rules().back();
+	session.output<<"rule "<<session.rules.size()<<":\t"<<to_string(added.left,session.print_limits)<<" -> "<<to_string(added.right,session.print_limits)<<endl;
+}
+
+// $rewrite and $simplify are redone whenever what the expression references changes, so they keep the
+// rules as they were when the command ran; rules added later don't change what the expression means
+static std::shared_ptr<const RuleSet> current_rules(const Session& session){
+	auto ret = std::make_shared<RuleSet>();
+	// rebuilt rather than copied, since Rule's constructor promotes them out of this line's Arena
+	for(const Rule& rule : session.rules.rules())
+		ret->add(Rule(rule.left,rule.right));
+	return ret;
+}
+
+Command rule_command("rule","pattern -> replacement","Adds a rewrite rule, used by $rewrite. Symbols ending in '_' (like x_) in the pattern match any expression.",rule);
+
+void rewrite_c(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()==0)
+		throw CommandError("Expected the name of an expression");
+	for(const string& name : argv){
+		if(!session.workspace.contains(name))
+			throw CommandError("There is no expression named '"+name+"'");
+	}
+	std::shared_ptr<const RuleSet> rules = current_rules(session);
+	for(const string& name : argv)
+		session.apply(name,[rules](const Expr& value){ return (*rules)(value); });
+}
+
+Command rewrite_command("rewrite","name...","Applies the rules added with $rule so far to the named expression(s) until none match. Redone with the same rules whenever what they reference changes.",rewrite_c);
+
+void simplify(Session& session, string args){
+	static const boost::regex limit_rex("(nodes|iterations|ms)=([0-9]+)");
+	std::vector<string> argv = split_args(args);
+	if(argv.size()==0)
+		throw CommandError("Expected the name of an expression");
+	const string& name = argv[0];
+	if(!session.workspace.contains(name))
+		throw CommandError("There is no expression named '"+name+"'");
+
+	EGraph::Limits limits;
+	for(size_t n=1;n<argv.size();n++){
+		boost::smatch rex_results;
+		if(!boost::regex_match(argv[n],rex_results,limit_rex))
+			throw CommandError("Expected nodes=N, iterations=N or ms=N, got '"+argv[n]+"'");
+		size_t value = std::stoull(rex_results[2]);
+		if(rex_results[1]=="nodes")
+			limits.max_nodes = value;
+		else if(rex_results[1]=="iterations")
+			limits.max_iterations = value;
+		else
+			limits.max_time = std::chrono::milliseconds(value);
+	}
+
+	std::shared_ptr<const RuleSet> rules = current_rules(session);
+	session.apply(name,[rules,limits](const Expr& value){ return EGraph::simplify(value,*rules,limits); });
+}
+
+Command simplify_command("simplify","name [nodes=N] [iterations=N] [ms=N]","Finds the smallest form of a named expression that the rules added with $rule so far can reach, within the given limits. Redone with the same rules and limits whenever what it references changes; the ms limit is wall-clock time, so a redone result can differ.",simplify);
+
+void save(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()!=1)
+		throw CommandError("Expected a file path");
+	WorkspaceFile::save(session.workspace,argv[0]);
+	session.output<<"Saved "<<session.workspace.size()<<" expressions to '"<<argv[0]<<"'"<<endl;
+	// only definitions are saved, so anything $expand and the like did is lost
+	string transformed;
+	for(const auto& named_expr : session.workspace){
+		if(session.workspace.has_transforms(named_expr.first))
+			transformed += (transformed.empty() ? "" : ", ")+named_expr.first;
+	}
+	if(!transformed.empty())
+		session.output<<"Saved as defined, without $expand, $collect, $rewrite or $simplify: "<<transformed<<endl;
+}
+
+Command save_command("save","path","Saves every named expression to a binary workspace file.",save);
+
+void load(Session& session, string args){
+	std::vector<string> argv = split_args(args);
+	if(argv.size()!=1)
+		throw CommandError("Expected a file path");
+	WorkspaceFile file(argv[0]);
+	file.load_into(session.workspace);
+	session.output<<"Loaded "<<file.entry_count()<<" expressions from '"<<argv[0]<<"'"<<endl;
+}
+
+Command load_command("load","path","Loads the named expressions in a workspace file saved with $save, replacing any with the same names.",load);
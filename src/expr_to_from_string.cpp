@@ -1,5 +1,13 @@
 #include "Expr.hpp"
+#include "Profiler.hpp"
+#include "Tracer.hpp"
 #include <boost/regex.hpp>
+#include <string_view>
+#include <climits>
+#include <ostream>
+#include <unordered_map>
+
+using std::string_view;
 
 struct _ExprToFromStringImpl{
 	inline static const boost::regex empty_rex{"\\s*"};
@@ -13,18 +21,209 @@ struct _ExprToFromStringImpl{
 		rex_header + R"(\s*\(((?&BAL))\)\s*)"
 	);
 
+	struct CompiledType{
+		const Type* type;
+		boost::regex rex;
+	};
+
+	// every registered type's parse regex, compiled once on first use (in all_types order)
+	static const std::vector<CompiledType>& compiled_types(){
+		static const std::vector<CompiledType> compiled = [](){
+			std::vector<CompiledType> ret;
+			ret.reserve(all_types.size());
+			for(const Type* exprtype : all_types){
+				ret.push_back({exprtype,boost::regex(rex_header+exprtype->parse_string,boost::regex_constants::mod_x)});
+			}
+			return ret;
+		}();
+		return compiled;
+	}
+
 	static Expr string_to_expr(const string& str, const string& original, size_t position);
+
+	// Precedence climbing parser; handles every type that is an operator (has a parse_token, no f_parser
+	// and is not nullary), using pemdas for binding strength. Everything between operators and
+	// parentheses is handed to string_to_expr, so leaf and custom types still go through their regex.
+	// Throws PrattFailure for anything it can't handle, in which case the caller falls back to string_to_expr.
+	struct PrattFailure{};
+
+	struct Operator{
+		string_view token;
+		const Type* type;
+	};
+
+	struct OperatorTable{
+		std::vector<Operator> prefix;
+		std::vector<Operator> infix;
+	};
+
+	static const OperatorTable& operator_table(){
+		static const OperatorTable table = [](){
+			OperatorTable ret;
+			for(const Type* exprtype : all_types){
+				if(*exprtype->parse_token=='\0' || exprtype->f_parser!=nullptr)
+					continue;
+				switch(exprtype->arity){
+					case Type::UNARY:
+						ret.prefix.push_back({exprtype->parse_token,exprtype});
+						break;
+					case Type::BINARY:
+					case Type::INFINITARY:
+						ret.infix.push_back({exprtype->parse_token,exprtype});
+						break;
+					default:
+						break;
+				}
+			}
+			// longest tokens first, so that a token is never shadowed by its own prefix
+			auto longer = [](const Operator& a, const Operator& b){ return a.token.size()>b.token.size(); };
+			std::stable_sort(ret.prefix.begin(),ret.prefix.end(),longer);
+			std::stable_sort(ret.infix.begin(),ret.infix.end(),longer);
+			return ret;
+		}();
+		return table;
+	}
+
+	struct PrattParser{
+		string_view src;
+		const string& original;
+		size_t pos = 0;
+		const OperatorTable& ops = operator_table();
+
+		PrattParser(const string& str):src(str),original(str){}
+
+		void skip_space(){
+			while(pos<src.size() && isspace(static_cast<unsigned char>(src[pos])))
+				pos++;
+		}
+
+		static bool is_bracket(char c){
+			return c=='(' || c==')' || c=='[' || c==']' || c=='{' || c=='}';
+		}
+
+		static const Operator* match(const std::vector<Operator>& list, string_view at){
+			for(const Operator& op : list){
+				if(at.starts_with(op.token))
+					return &op;
+			}
+			return nullptr;
+		}
+
+		bool at_operator() const {
+			string_view at = src.substr(pos);
+			return match(ops.infix,at)!=nullptr || match(ops.prefix,at)!=nullptr;
+		}
+
+		static Expr build(const Type* type, std::vector<Expr>& operands){
+			Expr ret;
+			ret._type = type;
+			ret._children.reserve(operands.size());
+			for(Expr& child : operands){
+				if((type->is_associative() && child.type()==*type) ||
+					(type->is_list_unwrapper() && child.type()==List)){
+					for(Expr& grandchild : child._children){
+						ret._children.push_back(std::move(grandchild));
+					}
+				}
+				else{
+					ret._children.push_back(std::move(child));
+				}
+			}
+			if(type->arity!=Type::INFINITARY && ret._children.size()!=type->arity)
+				throw PrattFailure();
+			return ret;
+		}
+
+		Expr parse_operand(){
+			skip_space();
+			if(pos>=src.size())
+				throw PrattFailure();
+			if(const Operator* op = match(ops.prefix,src.substr(pos))){
+				pos += op->token.size();
+				std::vector<Expr> operand;
+				operand.push_back(parse_expr(op->type->pemdas));
+				return build(op->type,operand);
+			}
+			if(src[pos]=='('){
+				pos++;
+				Expr ret = parse_expr(INT_MAX);
+				skip_space();
+				if(pos>=src.size() || src[pos]!=')')
+					throw PrattFailure();
+				pos++;
+				return ret;
+			}
+			if(is_bracket(src[pos]))
+				throw PrattFailure();
+
+			size_t start = pos;
+			while(pos<src.size() && !is_bracket(src[pos]) && !at_operator())
+				pos++;
+			size_t end = pos;
+			while(end>start && isspace(static_cast<unsigned char>(src[end-1])))
+				end--;
+			if(end==start)
+				throw PrattFailure();
+			return string_to_expr(string(src.substr(start,end-start)),original,start);
+		}
+
+		// parses operators that bind tighter than max_pemdas
+		Expr parse_expr(int max_pemdas){
+			Expr lhs = parse_operand();
+			while(true){
+				skip_space();
+				const Operator* op = match(ops.infix,src.substr(pos));
+				if(op==nullptr || op->type->pemdas>=max_pemdas)
+					return lhs;
+				pos += op->token.size();
+
+				std::vector<Expr> operands;
+				operands.push_back(std::move(lhs));
+				if(op->type->arity==Type::INFINITARY){
+					// gather the whole chain, so a+b+c+... is built once
+					while(true){
+						operands.push_back(parse_expr(op->type->pemdas));
+						skip_space();
+						const Operator* next = match(ops.infix,src.substr(pos));
+						if(next==nullptr || next->type!=op->type)
+							break;
+						pos += next->token.size();
+					}
+				}
+				else if(op->type->is_right_associative()){
+					operands.push_back(parse_expr(op->type->pemdas+1));
+				}
+				else{
+					operands.push_back(parse_expr(op->type->pemdas));
+				}
+				lhs = build(op->type,operands);
+			}
+		}
+
+		Expr parse(){
+			Expr ret = parse_expr(INT_MAX);
+			skip_space();
+			if(pos!=src.size())
+				throw PrattFailure();
+			return ret;
+		}
+	};
 };
 
 Expr _ExprToFromStringImpl::string_to_expr(const string& str, const string& original, size_t position){
+	// counted as the type it matches; parentheses and failures count as the parse's own time
+	Profiler::Scope profile(Profiler::PARSE,nullptr);
 
 	if(boost::regex_match(str,empty_rex))
 		throw ExprError(Expr(),__FILE__ ": " + std::to_string(__LINE__));
 
-	for(const Type* exprtype : all_types){
-		boost::regex rex = boost::regex(rex_header+exprtype->parse_string,boost::regex_constants::mod_x);
+	for(const CompiledType& compiled : compiled_types()){
+		const Type* exprtype = compiled.type;
+		if(*exprtype->parse_token!='\0' && str.find(exprtype->parse_token)==string::npos)
+			continue;
 		boost::smatch results;
-		if(boost::regex_match(str,results,rex)){
+		if(boost::regex_match(str,results,compiled.rex)){
+			profile.set_type(exprtype);
 			if(exprtype->f_parser==nullptr){
 				Expr ret;
 				ret._type=exprtype;
@@ -34,9 +233,8 @@ Expr _ExprToFromStringImpl::string_to_expr(const string& str, const string& orig
 						Expr child = string_to_expr(results[n],original,results.position(n)+position);
 						if(exprtype->is_associative() && child.type()==*exprtype ||
 							exprtype->is_list_unwrapper() && child.type()==List){
-							while(!child._children.empty()){
-								ret._children.push_back(std::move(child._children.front()));
-								child._children.pop_front();
+							for(Expr& grandchild : child._children){
+								ret._children.push_back(std::move(grandchild));
 							}
 						}
 						else{
@@ -67,70 +265,259 @@ Expr _ExprToFromStringImpl::string_to_expr(const string& str, const string& orig
 }
 
 Expr::Expr(const string& str){
-	*this = _ExprToFromStringImpl::string_to_expr(str,str,0);
+	Profiler::Scope profile(Profiler::PARSE,nullptr);
+	Tracer::Span span("parse");
+	try{
+		*this = _ExprToFromStringImpl::PrattParser(str).parse();
+	}
+	catch(const _ExprToFromStringImpl::PrattFailure&){
+		*this = _ExprToFromStringImpl::string_to_expr(str,str,0);
+	}
+	catch(const SyntaxError&){
+		// let the regex parser produce the error (or a parse of a custom type the operator parser can't see)
+		*this = _ExprToFromStringImpl::string_to_expr(str,str,0);
+	}
+	catch(const ExprError&){
+		// an operator given operands its type won't take; the regex parser reports it the usual way
+		*this = _ExprToFromStringImpl::string_to_expr(str,str,0);
+	}
+	if(profile.is_active())
+		profile.set_nodes(node_count());
+	if(span.is_active())
+		span.set_arg("nodes",node_count());
 }
 
 
-string infinitary_to_string(const Expr& expr){
-	std::vector<string> child_strings;
-	for(const Expr& child : expr){
-		if(child.type().pemdas>=0 && child.type().pemdas>=expr.type().pemdas)
-			child_strings.push_back("("+to_string(child)+")");
-		else
-			child_strings.push_back(to_string(child));
+// A Type's print_string, split once into literal text and the child placeholders between it. It's
+// read as the regex replace format it used to be given to: $n (or ${n}) is the nth child and $$ is a
+// '$'. An infinitary type's format joins two children, and is applied from the right (so "$1 + $2"
+// prints a+b+c as a + (b + c), without the parentheses).
+struct PrintFormat{
+	struct Segment{
+		string text;
+		// 1-based child index placed after text, or 0 for none
+		size_t child;
+	};
+	std::vector<Segment> segments;
+	// how many segments come before the only $2 placeholder (if there's exactly one), so an
+	// infinitary chain can be written without recursing once per child
+	size_t split = 0;
+	bool can_split = false;
+
+	PrintFormat(const char* format){
+		string text;
+		size_t twos = 0;
+		for(const char* c=format;*c!='\0';c++){
+			if(*c!='$'){
+				text += *c;
+				continue;
+			}
+			if(c[1]=='$'){
+				text += '$';
+				c++;
+				continue;
+			}
+			const char* digits = c[1]=='{' ? c+2 : c+1;
+			const char* end = digits;
+			size_t child = 0;
+			while(*end>='0' && *end<='9')
+				child = child*10+(*end++-'0');
+			if(end==digits || (c[1]=='{' && *end!='}')){
+				text += *c;
+				continue;
+			}
+			c = c[1]=='{' ? end : end-1;
+			if(child==2){
+				twos++;
+				split = segments.size();
+			}
+			segments.push_back({std::move(text),child});
+			text.clear();
+		}
+		segments.push_back({std::move(text),0});
+		can_split = twos==1;
 	}
-	if(child_strings.size()<2){
-		throw ExprError(expr,"cannot to_string an infinitary expr with less than 2 children");
+};
+
+static const PrintFormat& print_format(const Type& type){
+	static const std::unordered_map<const Type*,PrintFormat> formats = [](){
+		std::unordered_map<const Type*,PrintFormat> ret;
+		for(const Type* exprtype : all_types)
+			ret.emplace(exprtype,exprtype->print_string);
+		return ret;
+	}();
+	auto found = formats.find(&type);
+	if(found!=formats.end())
+		return found->second;
+	// not registered; compiled on first use. The map's nodes don't move, so a format stays valid while
+	// the children of its expr (which may be unregistered too) are printed.
+	thread_local std::unordered_map<const Type*,PrintFormat> unregistered;
+	auto [cached,added] = unregistered.try_emplace(&type,type.print_string);
+	return cached->second;
+}
+
+// Writes one expr, eliding what's past its limits. Output collects in out, and goes to stream (if there
+// is one) whenever a few KB have built up, so a large expr is never held as a whole string.
+struct Printer{
+	static constexpr size_t flush_size = 4096;
+	string out;
+	std::ostream* stream = nullptr;
+	PrintLimits limits;
+	size_t flushed = 0;
+	size_t depth = 0;
+
+	size_t written() const { return flushed+out.size(); }
+
+	void flush(){
+		if(stream!=nullptr && !out.empty()){
+			stream->write(out.data(),out.size());
+			flushed += out.size();
+			out.clear();
+		}
 	}
 
-	static const boost::regex replacer_rex("\\x1F([^\\x1F\\x1E]*)\\x1F([^\\x1F\\x1E]*)\\x1E");
+	void elide(size_t nodes){
+		out += "…["+std::to_string(nodes)+(nodes==1 ? " node]" : " nodes]");
+	}
 
-	while(child_strings.size()>=2){
-		string target = "\x1E";
-		target = "\x1F" + child_strings.back() + target;
-		child_strings.pop_back();
-		target = "\x1F" + child_strings.back() + target;
-		child_strings.pop_back();
-		string repl = boost::regex_replace(target,replacer_rex,expr.type().print_string);
-		child_strings.push_back(repl);
+	// whether children from next on (of a chain) should be elided together
+	bool elide_rest(size_t next) const {
+		return next>=limits.max_width || written()>=limits.max_bytes;
 	}
 
-	return child_strings[0];
-}
+	void print_child(const Expr& parent, const Expr& child){
+		if(written()>=limits.max_bytes || (depth>=limits.max_depth && child.child_count()>0)){
+			elide(child.node_count());
+			return;
+		}
+		bool parenthesize = child.type().pemdas>=parent.type().pemdas && child.type().pemdas>=0;
+		if(parenthesize)
+			out += '(';
+		depth++;
+		print(child);
+		depth--;
+		if(parenthesize)
+			out += ')';
+		if(out.size()>=flush_size)
+			flush();
+	}
 
-string to_string(const Expr& expr){
-	if(expr.type().f_printer!=nullptr){
-		return expr.type().f_printer(expr);
-	}
-	else{
-		string target;
-		switch(expr.type().arity){
-			case Type::NULLARY:
-				return expr.type().print_string;
-			case Type::INFINITARY:
-				return infinitary_to_string(expr);
-			case Type::TERNARY:
-				if(expr[2].type().pemdas>=expr.type().pemdas && expr[2].type().pemdas>=0)
-					target = "\x1F("+to_string(expr[2])+")";
-				else
-					target = "\x1F"+to_string(expr[2]);
-				__attribute__ ((fallthrough));
-			case Type::BINARY:
-				if(expr[1].type().pemdas>=expr.type().pemdas && expr[1].type().pemdas>=0)
-					target = "\x1F("+to_string(expr[1])+")" + target;
-				else
-					target = "\x1F"+to_string(expr[1]) + target;
-				__attribute__ ((fallthrough));
-			case Type::UNARY:
-				if(expr[0].type().pemdas>=expr.type().pemdas && expr[0].type().pemdas>=0)
-					target = "\x1F("+to_string(expr[0])+")" + target;
+	// the infinitary chain of expr's children from first on
+	void print_chain(const Expr& expr, const PrintFormat& format, size_t first){
+		size_t count = expr.child_count();
+		if(!format.can_split){
+			print_segments(expr,format,0,format.segments.size(),first);
+			return;
+		}
+		// every level's text up to its $2, then the last child (or the elided rest), then every
+		// level's text after its $2
+		size_t top = first;
+		while(true){
+			print_segments(expr,format,0,format.split,top);
+			out += format.segments[format.split].text;
+			if(top+2==count){
+				print_child(expr,expr[count-1]);
+				break;
+			}
+			if(elide_rest(top+1)){
+				elide_children(expr,top+1);
+				break;
+			}
+			top++;
+		}
+		for(size_t n=top+1;n-->first;)
+			print_segments(expr,format,format.split+1,format.segments.size(),n);
+	}
+
+	void elide_children(const Expr& expr, size_t first){
+		size_t nodes = 0;
+		for(size_t n=first;n<expr.child_count();n++)
+			nodes += expr[n].node_count();
+		elide(nodes);
+	}
+
+	// segments [begin,end) of format; for an infinitary expr, $1 is child first and $2 the chain after it
+	void print_segments(const Expr& expr, const PrintFormat& format, size_t begin, size_t end, size_t first){
+		bool infinitary = expr.type().arity==Type::INFINITARY;
+		for(size_t n=begin;n<end;n++){
+			const PrintFormat::Segment& segment = format.segments[n];
+			out += segment.text;
+			if(segment.child==0)
+				continue;
+			if(!infinitary){
+				if(segment.child<=expr.child_count())
+					print_child(expr,expr[segment.child-1]);
+			}
+			else if(segment.child==1){
+				print_child(expr,expr[first]);
+			}
+			else if(segment.child==2){
+				if(first+2==expr.child_count())
+					print_child(expr,expr[first+1]);
+				else if(elide_rest(first+1))
+					elide_children(expr,first+1);
 				else
-					target = "\x1F"+to_string(expr[0]) + target;
-				target += "\x1E";
+					print_chain(expr,format,first+1);
+			}
 		}
+	}
 
-		static const boost::regex replacer_rex("\\x1F([^\\x1F\\x1E]*)(?:\\x1F([^\\x1F\\x1E]*))?(?:\\x1F([^\\x1F\\x1E]*))?\\x1E");
-		return boost::regex_replace(target,replacer_rex,expr.type().print_string);
+	void print(const Expr& expr){
+		const Type& type = expr.type();
+		Profiler::Scope profile(Profiler::PRINT,&type);
+		if(type.f_printer!=nullptr){
+			out += type.f_printer(expr);
+			return;
+		}
+		if(type.arity==Type::NULLARY){
+			out += type.print_string;
+			return;
+		}
+		if(type.arity==Type::INFINITARY && expr.child_count()<2){
+			throw ExprError(expr,"cannot to_string an infinitary expr with less than 2 children");
+		}
+		const PrintFormat& format = print_format(type);
+		if(type.arity==Type::INFINITARY)
+			print_chain(expr,format,0);
+		else
+			print_segments(expr,format,0,format.segments.size(),0);
 	}
+};
+
+// counts and traces a whole print, with the nodes in it (elided or not)
+static void profile_print(Profiler::Scope& profile, Tracer::Span& span, const Expr& expr){
+	if(profile.is_active())
+		profile.set_nodes(expr.node_count());
+	if(span.is_active())
+		span.set_arg("nodes",expr.node_count());
 }
 
+string to_string(const Expr& expr){
+	Profiler::Scope profile(Profiler::PRINT,nullptr);
+	Tracer::Span span("print");
+	profile_print(profile,span,expr);
+	Printer printer;
+	printer.print(expr);
+	return std::move(printer.out);
+}
+
+string to_string(const Expr& expr, const PrintLimits& limits){
+	Profiler::Scope profile(Profiler::PRINT,nullptr);
+	Tracer::Span span("print");
+	profile_print(profile,span,expr);
+	Printer printer;
+	printer.limits = limits;
+	printer.print(expr);
+	return std::move(printer.out);
+}
+
+void print(std::ostream& out, const Expr& expr, const PrintLimits& limits){
+	Profiler::Scope profile(Profiler::PRINT,nullptr);
+	Tracer::Span span("print");
+	profile_print(profile,span,expr);
+	Printer printer;
+	printer.stream = &out;
+	printer.limits = limits;
+	printer.print(expr);
+	printer.flush();
+}
@@ -1,4 +1,5 @@
 #include "main.hpp"
+#include "Tracer.hpp"
 
 #include <xeus/xkernel.hpp>
 #include <xeus/xkernel_configuration.hpp>
@@ -38,6 +39,7 @@ int main (int argc, char **argv){
 		return 1;
 	}
 
+	Tracer::set_thread_name("kernel");
 	std::unique_ptr<Main> mptr(new Main());
 	xeus::xconfiguration config = xeus::load_configuration(argv[1]);
 
@@ -51,48 +53,14 @@ int main (int argc, char **argv){
 
 #endif
 
-void Main::consume_line(string line){
-
-	static const boost::regex command_rex("\\s*\\$\\s*(\\w+)(?:\\s+(.*))?");
-	static const boost::regex declare_rex("\\s*(\\w+)\\s*:\\s*(.*)");
-	static const boost::regex empty_rex("\\s*");
-
-	boost::smatch rex_results;
-
-	if(boost::regex_match(line,rex_results,command_rex)){
-		if(Command::all.contains(rex_results[1])){
-			Command& comm = Command::all[rex_results[1]];
-			comm.fptr(*this,rex_results[2].str());
-		}
-		else{
-			throw CommandError("Unknown command: "+rex_results[1].str());
-		}
-	}
-	else if(boost::regex_match(line,rex_results,declare_rex)){
-		if(boost::regex_match(rex_results[2].str(),empty_rex)){
-			throw CommandError("Expected an expression after ':'");
-		}
-		else{
-			string name = rex_results[1];
-			Expr expr (rex_results[2].str());
-			if(workspace.contains(name))
-				workspace.erase(name);
-			workspace.emplace(name,expr);
-			if(echo_vars)
-				output<<(name+":\t"+to_string(expr))<<endl;
-		}
-	}
-	else{
-		throw CommandError("Not a declaration or a command: '"+line+"'");
-	}
-}
-
 void Main::configure_impl() {
 
 }
 
 void Main::execute_request_impl(xeus::xrequest_context request_context, send_reply_callback cb, int execution_counter, const std::string& code, xeus::execute_request_config , nl::json ) {
 
+	Tracer::Span span("execute_request");
+	span.set_arg("cell",execution_counter);
 	static const boost::regex line_rex("[^\\n\\r]*");
 	boost::sregex_iterator line_iter(code.begin(),code.end(),line_rex);
 	while(line_iter!=boost::sregex_iterator()){
@@ -128,6 +96,9 @@ void Main::execute_request_impl(xeus::xrequest_context request_context, send_rep
 			pub_data["text/plain"] = out;
 			publish_execution_result(request_context, execution_counter, std::move(pub_data), nl::json::object());
 		}
+		// a line at a time, so no thread's ring fills up over a long cell
+		if(Tracer::on())
+			Tracer::collect();
 		line_iter++;
 	}
 	cb(xeus::create_successful_reply());
@@ -168,7 +139,7 @@ nl::json Main::inspect_request_impl(const std::string& code, int cursor_pos, int
 		int cloc = hovered.find("\x1F");
 		hovered.erase(cloc,1);
 		if(workspace.contains(hovered)){
-			return xeus::create_inspect_reply(true,{"text/plain",to_string(workspace[hovered])});
+			return xeus::create_inspect_reply(true,{"text/plain",to_string(workspace[hovered],print_limits)});
 		}
 	}
 	return xeus::create_inspect_reply();
@@ -3,38 +3,13 @@
 #include <string>
 using std::string;
 
-#include "Expr.hpp"
+#include "Session.hpp"
 
 #include <xeus/xinterpreter.hpp>
 #include <nlohmann/json.hpp>
 
-using std::endl;
-
-struct Main;
-
-struct Command{
-	inline static std::unordered_map<string,Command> all;
-	string name;
-	string args;
-	string desc;
-	void (*fptr)(Main&,string);
-	Command()=default;
-	Command(string name, string args, string desc,void(*fptr)(Main&,string)):name(name),args(args),desc(desc),fptr(fptr){
-		all.emplace(name,*this);
-	}
-};
-
-struct CommandError : public NamedError{
-	CommandError(string what):NamedError("CommandError",std::move(what)){}
-};
-
-struct Main : public xeus::xinterpreter{
-
-	std::ostringstream output;
-	std::map<string,Expr> workspace;
-	bool echo_vars = true;
-	void consume_line(string line);
-
+// the Jupyter kernel: a Session driven through xeus
+struct Main : public xeus::xinterpreter, public Session{
 
 	// functions for jupyter:
 
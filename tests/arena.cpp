@@ -0,0 +1,34 @@
+#include "tests.hpp"
+#include "Expr.hpp"
+#include "actions.hpp"
+
+Test arena_build("arena_build",[](){
+	Expr kept;
+	Arena arena;
+	{
+		Arena::Scope scope(arena);
+		Expr ex = perform(Expr("1+2*x+3*4"));
+		ASSERT(arena.bytes_used()>0);
+		kept = promote(ex);
+	}
+	size_t used = arena.bytes_used();
+	Expr copy = kept;
+	ASSERT_EQUAL(arena.bytes_used(),used);
+	ASSERT_EQUAL(kept,Expr("x*2+13"));
+});
+
+Test arena_error("arena_error",[](){
+	Expr subject;
+	{
+		Arena arena;
+		Arena::Scope scope(arena);
+		try{
+			Expr("a+b")[5];
+		}
+		catch(const ExprError& err){
+			// a plain copy would be built in the arena too
+			subject = promote(err.subject);
+		}
+	}
+	ASSERT_EQUAL(subject,Expr("a+b"));
+});
@@ -112,6 +112,9 @@ TEST(paren_pemdas,"(((a)/(b))/((c)/(d)))/(((f)/(g))/((h)/(j)))",
 	));
 
 TEST(parens,"(((a)))",a);
+TEST(paren_flatten,"(a+b)+(c+d)",Add(a,b,c,d));
+TEST(mixed_chain,"a-b+c-d",Add(Sub(a,b),Sub(c,d)));
+TEST(neg_pow_mul,"a^-b*c",Mul(Pow(a,Neg(b)),c));
 
 #undef TEST
 #define TEST(NAME,STRING,EXPECT) \
@@ -0,0 +1,76 @@
+#include "tests.hpp"
+#include "Expr.hpp"
+#include "actions.hpp"
+
+// deterministic pseudo-random number with the given count of decimal digits
+static BigInt digits(size_t count, uint64_t seed){
+	string str;
+	for(size_t n=0;n<count;n++){
+		seed = seed*6364136223846793005ULL+1442695040888963407ULL;
+		str.push_back('1'+(seed>>60)%9);
+	}
+	return BigInt(str);
+}
+
+Test bigint_basic("bigint_basic",[](){
+	ASSERT_EQUAL(BigInt::pow(2,100).to_string(),string("1267650600228229401496703205376"));
+	ASSERT_EQUAL((BigInt("-1000000000000000000000")/BigInt(7)).to_string(),string("-142857142857142857142"));
+	ASSERT_EQUAL((BigInt("-1000000000000000000000")%BigInt(7)).to_string(),string("-6"));
+	ASSERT_EQUAL((BigInt(INT64_MIN)-1).to_string(),string("-9223372036854775809"));
+	ASSERT((BigInt(INT64_MIN)).fits_int64());
+	ASSERT(!(-BigInt(INT64_MIN)).fits_int64());
+	ASSERT_EQUAL(BigInt::gcd(BigInt("-123456789012345678901234567890"),BigInt("987654321098765432109876543210")).to_string(),string("9000000000900000000090"));
+	ASSERT_EQUAL(BigInt::pow(10,30).to_double(),1e30);
+	ASSERT(BigInt("-99999999999999999999")<BigInt(-5));
+});
+
+Test bigint_karatsuba("bigint_karatsuba",[](){
+	// well past KARATSUBA_THRESHOLD, and lopsided, so every path of mul_mag runs
+	BigInt a = digits(2000,1);
+	BigInt b = -digits(1500,2);
+	BigInt c = digits(700,3);
+	ASSERT_EQUAL((a+b)*(a+b),a*a+BigInt(2)*a*b+b*b);
+	ASSERT_EQUAL((a*c)*b,a*(c*b));
+	BigInt q,r;
+	BigInt::divmod(a*-b+c,-b,q,r);
+	ASSERT_EQUAL(q,a);
+	ASSERT_EQUAL(r,c);
+	BigInt::divmod(a,c,q,r);
+	ASSERT_EQUAL(q*c+r,a);
+	ASSERT(r>=0 && r<c);
+},5);
+
+Test bigint_perform("bigint_perform",[](){
+	ASSERT_EQUAL(to_string(perform(Expr("2^100"))),string("1267650600228229401496703205376"));
+	ASSERT_EQUAL(to_string(perform(Expr("2^100/2^98"))),string("4"));
+	ASSERT_EQUAL(perform(Expr("2^64-2^64+x")),Add(Symbol("x"),Integer(0)));
+	ASSERT_EQUAL(to_string(perform(Expr("3037000500*3037000500"))),string("9223372037000250000"));
+	ASSERT_EQUAL(to_string(perform(Expr("-(9223372036854775807+1)"))),string("-9223372036854775808"));
+	ASSERT_EQUAL(perform(Expr("-(9223372036854775807+1)")).type(),Integer);
+	ASSERT_EQUAL(to_string(perform(Expr("(0-9223372036854775807-1)/(0-1)"))),string("9223372036854775808"));
+	// literals too large for Integer are parsed as BigInteger
+	Expr big("123456789012345678901234567890");
+	ASSERT_EQUAL(big.type(),BigInteger);
+	ASSERT_EQUAL(perform(Expr("123456789012345678901234567890-123456789012345678901234567889")),Integer(1));
+	ASSERT_EQUAL(perform(Expr("(-1)^123456789012345678901234567891")),Integer(-1));
+	// too large to expand
+	ASSERT_EQUAL(perform(Expr("3^123456789")).type(),Pow);
+});
+
+Test bigint_freed("bigint_freed",[](){
+	// every intermediate value goes once nothing holds it
+	Expr kept = perform(Expr("2^90"));
+	size_t before = live_big_integers();
+	{
+		Expr sum = Add();
+		for(int_value_t k=64;k<=100;k++)
+			sum.add_child(Pow(Integer(2),Integer(k)));
+		Expr result = perform(sum);
+		Expr copy = result;
+		ASSERT_EQUAL(result.type(),BigInteger);
+		ASSERT(live_big_integers()>before);
+	}
+	ASSERT_EQUAL(live_big_integers(),before);
+	ASSERT_EQUAL(kept,perform(Expr("2^90")));
+	ASSERT(BigInteger.value(kept).to_string()==string("1237940039285380274899124224"));
+});
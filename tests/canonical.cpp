@@ -0,0 +1,55 @@
+#include "tests.hpp"
+#include "canonical.hpp"
+
+static Expr canon(const string& str){
+	return canonicalize(Expr(str));
+}
+
+Test canonical_order("canonical_order",[](){
+	ASSERT_EQUAL(canon("a+b"),canon("b+a"));
+	ASSERT_EQUAL(canon("a+b").hash(),canon("b+a").hash());
+	ASSERT_EQUAL(canon("c*(b+a)*2"),canon("2*(a+b)*c"));
+	ASSERT_EQUAL(canon("(a+b)+(c+d)"),canon("d+(c+(b+a))"));
+	// non-constants first, then constants
+	ASSERT_EQUAL(to_string(canon("3+y+x")),string("x + y + 3"));
+	// order doesn't depend on the order symbols were first interned in
+	ASSERT(canonical_compare(Symbol("zz_late"),Symbol("aa_late"))>0);
+	ASSERT(canonical_compare(Expr("a-b"),Expr("a-b"))==0);
+	ASSERT(canonical_compare(Expr("a-b"),Expr("b-a"))!=0);
+});
+
+Test canonical_like_terms("canonical_like_terms",[](){
+	ASSERT_EQUAL(canon("x+x+x"),Mul(Symbol("x"),Integer(3)));
+	ASSERT_EQUAL(canon("x*2+3*x-x"),Mul(Symbol("x"),Integer(4)));
+	ASSERT_EQUAL(canon("x*y+y*x*2"),Mul(Symbol("x"),Symbol("y"),Integer(3)));
+	ASSERT_EQUAL(canon("x+1/2+y-x+1/2"),Add(Symbol("y"),Integer(1)));
+	ASSERT_EQUAL(canon("x-x"),Integer(0));
+	ASSERT_EQUAL(canon("-x+x"),Integer(0));
+	ASSERT_EQUAL(canon("x/2+x/2"),canon("x"));
+	ASSERT_EQUAL(canon("a-b"),canon("-b+a"));
+	ASSERT_EQUAL(canon("-(x*2)"),Mul(Symbol("x"),Integer(-2)));
+});
+
+Test canonical_like_factors("canonical_like_factors",[](){
+	ASSERT_EQUAL(canon("x*x*x"),Pow(Symbol("x"),Integer(3)));
+	// symbols sort before powers
+	ASSERT_EQUAL(canon("x*x^2*y*3"),Mul(Symbol("y"),Pow(Symbol("x"),Integer(3)),Integer(3)));
+	ASSERT_EQUAL(canon("x^2*x^(0-2)*y"),Symbol("y"));
+	ASSERT_EQUAL(canon("(a+b)*(b+a)"),Pow(Add(Symbol("a"),Symbol("b")),Integer(2)));
+	ASSERT_EQUAL(canon("x*0*y"),Integer(0));
+	ASSERT_EQUAL(canon("-x*-y"),Mul(Symbol("x"),Symbol("y")));
+	ASSERT_EQUAL(canon("x/2"),canon("x*(1/2)"));
+	ASSERT_EQUAL(canon("x*y/x"),Symbol("y"));
+	ASSERT_EQUAL(canon("(x^2)^3"),Pow(Symbol("x"),Integer(6)));
+	ASSERT_EQUAL(canon("x^1"),Symbol("x"));
+});
+
+Test canonical_large("canonical_large",[](){
+	// one hashed pass: 20000 terms over 100 distinct monomials
+	Expr sum = Add();
+	for(int_value_t n=0;n<20000;n++)
+		sum.add_child(Mul(Integer(n%3+1),Symbol("x"+to_string(n%100)),Symbol("y")));
+	Expr result = canonicalize(sum);
+	ASSERT_EQUAL(result.type(),Add);
+	ASSERT_EQUAL(result.child_count(),100UL);
+},5);
@@ -0,0 +1,109 @@
+#include "tests.hpp"
+#include "CompactVector.hpp"
+#include "error.hpp"
+
+Test compact_vector_growth("compact_vector_growth",[](){
+	CompactVector<string> v;
+	ASSERT(v.empty() && v.capacity()==0 && v.data()==nullptr);
+	// doubles from 1
+	for(size_t n=0;n<9;n++){
+		v.push_back(std::to_string(n));
+		ASSERT_EQUAL(v.size(),n+1);
+	}
+	ASSERT_EQUAL(v.capacity(),size_t(16));
+	ASSERT(v.front()==string("0") && v.back()==string("8"));
+	v.insert(v.begin()+1,"x");
+	ASSERT(v[1]==string("x") && v[2]==string("1") && v.size()==10);
+	v.erase(v.begin());
+	ASSERT(v[0]==string("x") && v.size()==9);
+	// an element of itself, pushed just as it has to grow
+	while(v.size()<v.capacity())
+		v.push_back("y");
+	v.push_back(v[0]);
+	ASSERT(v.back()==string("x"));
+	ASSERT_EQUAL(v.capacity(),size_t(32));
+});
+
+Test compact_vector_reserve("compact_vector_reserve",[](){
+	CompactVector<int> v;
+	v.reserve(3);
+	ASSERT_EQUAL(v.capacity(),size_t(3));
+	for(int n=0;n<3;n++)
+		v.push_back(n);
+	ASSERT_EQUAL(v.capacity(),size_t(3));
+	// never shrinks
+	v.reserve(1);
+	ASSERT_EQUAL(v.capacity(),size_t(3));
+	ASSERT_EQUAL(CompactVector<int>::max_size(),size_t((1u<<31)-1));
+	// past max_size() (including sizes that don't fit 32 bits) throws rather than wrapping into the
+	// arena bit
+	for(size_t cap : {size_t(1)<<31,(size_t(1)<<32)+2}){
+		bool threw = false;
+		try{
+			v.reserve(cap);
+		}
+		catch(const std::length_error&){
+			threw = true;
+		}
+		ASSERT(threw);
+		ASSERT_EQUAL(v.capacity(),size_t(3));
+		ASSERT(!v.in_arena());
+		ASSERT_EQUAL(v[2],2);
+	}
+});
+
+Test compact_vector_moves("compact_vector_moves",[](){
+	CompactVector<string> a;
+	a.push_back("p");
+	a.push_back("q");
+	const string* data = a.data();
+	CompactVector<string> b(std::move(a));
+	ASSERT(a.empty() && a.capacity()==0 && a.data()==nullptr);
+	ASSERT(b.data()==data && b.size()==2);
+	CompactVector<string> c;
+	c.push_back("r");
+	c = std::move(b);
+	ASSERT(c.data()==data && b.empty());
+	CompactVector<string> d(c);
+	ASSERT(d.data()!=c.data() && d.size()==2 && d[1]==string("q"));
+	// a copy is allocated exactly
+	ASSERT_EQUAL(d.capacity(),size_t(2));
+	const CompactVector<string>& same = d;
+	d = same;
+	ASSERT(d.size()==2 && d[0]==string("p"));
+});
+
+Test compact_vector_arena("compact_vector_arena",[](){
+	CompactVector<int> heap;
+	heap.push_back(1);
+	ASSERT(!heap.in_arena());
+	CompactVector<int> kept;
+	{
+		Arena arena;
+		Arena::Scope scope(arena);
+		CompactVector<int> v;
+		v.reserve(4);
+		ASSERT(v.in_arena());
+		ASSERT_EQUAL(v.capacity(),size_t(4));
+		ASSERT(arena.bytes_used()>=4*sizeof(int));
+		for(int n=0;n<6;n++)
+			v.push_back(n);
+		ASSERT(v.in_arena() && v.capacity()==8);
+		// growing something from the heap moves it into the arena
+		heap.push_back(2);
+		heap.push_back(3);
+		ASSERT(heap.in_arena());
+		// moving keeps the arena memory (and its mark) with the elements
+		CompactVector<int> moved(std::move(v));
+		ASSERT(moved.in_arena() && !v.in_arena());
+		{
+			// copies are made wherever is current
+			Arena::Scope on_heap(nullptr);
+			kept = moved;
+			heap = kept;
+		}
+		ASSERT(!kept.in_arena());
+	}
+	ASSERT(!heap.in_arena() && heap.size()==6);
+	ASSERT_EQUAL(kept[5],5);
+});
@@ -0,0 +1,105 @@
+#include "tests.hpp"
+#include "EGraph.hpp"
+
+Test egraph_congruence("egraph_congruence",[](){
+	EGraph graph;
+	EGraph::id_t ab = graph.add(Expr("(a+b)*c"));
+	EGraph::id_t db = graph.add(Expr("(d+b)*c"));
+	ASSERT(graph.find(ab)!=graph.find(db));
+	ASSERT_EQUAL(graph.add(Expr("(a+b)*c")),graph.find(ab));
+	size_t classes = graph.class_count();
+	// a=d makes a+b=d+b, and then (a+b)*c=(d+b)*c
+	ASSERT(graph.merge(graph.add(Expr("a")),graph.add(Expr("d"))));
+	graph.rebuild();
+	ASSERT_EQUAL(graph.find(ab),graph.find(db));
+	ASSERT_EQUAL(graph.class_count(),classes-3);
+});
+
+Test egraph_saturate("egraph_saturate",[](){
+	RuleSet rules;
+	rules.add(Rule(Expr("x_*(y_+z_)"),Expr("x_*y_+x_*z_")));
+	rules.add(Rule(Expr("x_*y_+x_*z_"),Expr("x_*(y_+z_)")));
+	rules.add(Rule(Expr("x_*y_/z_"),Expr("x_*(y_/z_)")));
+	rules.add(Rule(Expr("x_*1"),Expr("x_")));
+	ASSERT_EQUAL(EGraph::simplify(Expr("a*b+c*a"),rules),Expr("a*(b+c)"));
+	// only reachable by growing first; 2/2 is folded on the way
+	ASSERT_EQUAL(EGraph::simplify(Expr("a*2/2"),rules),Expr("a"));
+	ASSERT_EQUAL(EGraph::simplify(Expr("(3+4)*x"),RuleSet()),Expr("7*x"));
+
+	EGraph graph;
+	EGraph::id_t root = graph.add(Expr("a*(b+c)"));
+	EGraph::Report report = graph.saturate(rules);
+	ASSERT_EQUAL(int(report.stop),int(EGraph::SATURATED));
+	ASSERT_EQUAL(graph.find(graph.add(Expr("a*b+a*c"))),graph.find(root));
+});
+
+Test egraph_limits("egraph_limits",[](){
+	// associativity and commutativity grow the graph without bound
+	RuleSet rules;
+	// built directly, since the parser would flatten them
+	Expr x = Symbol("x_"), y = Symbol("y_"), z = Symbol("z_");
+	rules.add(Rule(Add(x,Add(y,z)),Add(Add(x,y),z)));
+	rules.add(Rule(Add(Add(x,y),z),Add(x,Add(y,z))));
+	rules.add(Rule(Expr("x_*(y_+z_)"),Expr("x_*y_+x_*z_")));
+	// the parser would flatten the sum
+	Expr sum = Symbol("h");
+	for(const char* name : {"g","f","e","d","c","b"})
+		sum = Add(Symbol(name),std::move(sum));
+	Expr big = Mul(Symbol("a"),sum,Expr("i+j"));
+
+	EGraph::Limits limits;
+	limits.max_nodes = 500;
+	limits.max_time = std::chrono::milliseconds(10000);
+	EGraph graph;
+	EGraph::id_t root = graph.add(big);
+	EGraph::Report report = graph.saturate(rules,limits);
+	ASSERT_EQUAL(int(report.stop),int(EGraph::NODE_LIMIT));
+	ASSERT(graph.node_count()<limits.max_nodes+200);
+	ASSERT_EQUAL(graph.extract(root),big);
+
+	limits.max_nodes = 1000000;
+	limits.max_time = std::chrono::milliseconds(0);
+	EGraph timed;
+	root = timed.add(big);
+	ASSERT_EQUAL(int(timed.saturate(rules,limits).stop),int(EGraph::TIME_LIMIT));
+	ASSERT_EQUAL(timed.extract(root),big);
+
+	limits.max_time = std::chrono::milliseconds(10000);
+	limits.max_iterations = 1;
+	EGraph once;
+	once.add(big);
+	ASSERT_EQUAL(int(once.saturate(rules,limits).stop),int(EGraph::ITERATION_LIMIT));
+},10);
+
+Test egraph_deadline("egraph_deadline",[](){
+	// a 5-ary commutative pattern matches every Add 120 ways; with 1000 of them, matching the one rule
+	// against every class takes far longer than the time limit, so the time and node limits have to be
+	// checked along the way
+	RuleSet rules;
+	Expr left = Add();
+	for(const char* name : {"a_","b_","c_","d_","e_"})
+		left.add_child(Symbol(name));
+	rules.add(Rule(left,Mul(Symbol("a_"),Symbol("b_"))));
+	Expr big = List();
+	for(size_t n=0;n<1000;n++){
+		Expr sum = Add();
+		for(size_t k=0;k<5;k++)
+			sum.add_child(Symbol("s"+std::to_string(n*5+k)));
+		big.add_child(Mul(sum,Integer(n)));
+	}
+
+	EGraph::Limits limits;
+	limits.max_nodes = 1000000;
+	limits.max_time = std::chrono::milliseconds(2);
+	EGraph timed;
+	EGraph::id_t root = timed.add(big);
+	ASSERT_EQUAL(int(timed.saturate(rules,limits).stop),int(EGraph::TIME_LIMIT));
+	ASSERT_EQUAL(timed.extract(root),big);
+
+	// no more matches are collected than could be applied within the node limit
+	limits.max_nodes = 10000;
+	limits.max_time = std::chrono::milliseconds(100000);
+	EGraph capped;
+	root = capped.add(big);
+	ASSERT_EQUAL(int(capped.saturate(rules,limits).stop),int(EGraph::NODE_LIMIT));
+},10);
@@ -0,0 +1,66 @@
+#include "tests.hpp"
+#include "ExprGenerator.hpp"
+
+static size_t depth(const Expr& ex){
+	size_t ret = 0;
+	for(const Expr& child : ex)
+		ret = std::max(ret,depth(child));
+	return ret+1;
+}
+
+Test generator_seeded("generator_seeded",[](){
+	ExprGenerator::Options options;
+	options.seed = 7;
+	options.size = 500;
+	ExprGenerator a(options), b(options);
+	for(int n=0;n<20;n++){
+		Expr ex = a();
+		ASSERT(ex.is_identical_to(b()));
+	}
+	options.seed = 8;
+	Expr other = ExprGenerator(options)();
+	ASSERT(!other.is_identical_to(ExprGenerator(ExprGenerator::Options{.seed=7,.size=500})()));
+});
+
+Test generator_shape("generator_shape",[](){
+	ExprGenerator::Options options;
+	options.size = 2000;
+	ExprGenerator generate(options);
+	for(int n=0;n<20;n++){
+		Expr ex = generate();
+		size_t nodes = ex.node_count();
+		ASSERT(nodes>=1000 && nodes<=3000);
+		ASSERT(depth(ex)<=options.max_depth+1);
+		// prints as something that parses back to the same expr
+		ASSERT(Expr(to_string(ex)).is_identical_to(ex));
+	}
+
+	options.max_depth = 3;
+	Expr shallow = ExprGenerator(options)();
+	ASSERT(depth(shallow)<=4);
+});
+
+Test generator_mix("generator_mix",[](){
+	ExprGenerator::Options options;
+	options.mix = ExprGenerator::parse_mix("Add=1,Integer=2");
+	ASSERT(ExprGenerator::to_string(options.mix)==string("Add=1,Integer=2"));
+	Expr ex = ExprGenerator(options)();
+	ASSERT(ex.type()==Add);
+	for(const Expr& child : ex)
+		ASSERT(child.type()==Add || child.type()==Integer);
+
+	bool threw = false;
+	try{ ExprGenerator::parse_mix("Add=x"); }
+	catch(const GeneratorError&){ threw = true; }
+	ASSERT(threw);
+	threw = false;
+	try{ ExprGenerator::parse_mix("Nothing=1"); }
+	catch(const GeneratorError&){ threw = true; }
+	ASSERT(threw);
+	// no leaves to end on
+	threw = false;
+	options.mix = ExprGenerator::parse_mix("Add=1");
+	try{ ExprGenerator generate(options); }
+	catch(const GeneratorError&){ threw = true; }
+	ASSERT(threw);
+});
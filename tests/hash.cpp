@@ -0,0 +1,39 @@
+#include "tests.hpp"
+#include "Expr.hpp"
+#include <unordered_map>
+
+Test hash_invalidate_index("hash_invalidate_index",[](){
+	Expr ex("a+b*c");
+	hash_t before = ex.hash();
+	ex[1][0] = Symbol("d");
+	ASSERT(ex.hash()!=before);
+	ASSERT_EQUAL(ex.hash(),Expr("a+d*c").hash());
+});
+
+Test hash_invalidate_children("hash_invalidate_children",[](){
+	Expr ex("a+b");
+	ex.hash();
+	ex.add_child(Symbol("c"));
+	ASSERT_EQUAL(ex.hash(),Expr("a+b+c").hash());
+	ex.remove_child(ex.begin());
+	ASSERT_EQUAL(ex.hash(),Expr("b+c").hash());
+	ex.insert_child(ex.begin(),Symbol("a"));
+	ASSERT_EQUAL(ex.hash(),Expr("a+b+c").hash());
+});
+
+Test hash_invalidate_iterator("hash_invalidate_iterator",[](){
+	Expr ex("a*b");
+	ex.hash();
+	for(Expr& child : ex)
+		child = Integer(2);
+	ASSERT_EQUAL(ex.hash(),Expr("2*2").hash());
+});
+
+Test hash_map_key("hash_map_key",[](){
+	std::unordered_map<Expr,int> cache;
+	cache[Expr("a+b*c")] = 1;
+	cache[Expr("a-b")] = 2;
+	ASSERT_EQUAL(cache.at(Expr("a+b*c")),1);
+	ASSERT_EQUAL(cache.at(Expr("a-b")),2);
+	ASSERT(!cache.contains(Expr("a+b")));
+});
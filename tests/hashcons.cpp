@@ -0,0 +1,26 @@
+#include "tests.hpp"
+#include "ConsExpr.hpp"
+
+Test hashcons_shared("hashcons_shared",[](){
+	ConsExpr x = Expr("a*b+a*b");
+	ASSERT(x[0]==x[1]);
+	ASSERT(x[0]==ConsExpr(Expr("a*b")));
+	ASSERT(!(x[0]==ConsExpr(Expr("b*a"))));
+});
+
+Test hashcons_hash("hashcons_hash",[](){
+	Expr ex("a+b*c^2-d/3");
+	ConsExpr x = ex;
+	ASSERT_EQUAL(x.hash(),ex.hash());
+	ASSERT_EQUAL(x.expr(),ex);
+});
+
+Test hashcons_free("hashcons_free",[](){
+	size_t before = ConsExpr::live_nodes();
+	{
+		ConsExpr x = Expr("zz_one+zz_two*zz_three");
+		ConsExpr y = x;
+		ASSERT(ConsExpr::live_nodes()>before);
+	}
+	ASSERT_EQUAL(ConsExpr::live_nodes(),before);
+});
@@ -0,0 +1,81 @@
+#include "tests.hpp"
+#include "InternTable.hpp"
+#include "ConsExpr.hpp"
+
+#include <atomic>
+
+Test intern_table("intern_table",[](){
+	InternTable table;
+	InternTable::id_t a = table.intern("alpha");
+	ASSERT_EQUAL(table.intern(string("alpha")),a);
+	ASSERT(table.get(a)==string("alpha"));
+	ASSERT_EQUAL(table.intern(""),InternTable::id_t(0));
+	ASSERT_EQUAL(table.size(),size_t(2));
+
+	// freed only once the last of its three references goes
+	table.retain(a);
+	table.release(a);
+	table.release(a);
+	ASSERT_EQUAL(table.size(),size_t(2));
+	table.release(a);
+	ASSERT_EQUAL(table.size(),size_t(1));
+
+	// enough to grow the index, and to shift entries back into the holes left behind
+	std::vector<InternTable::id_t> ids;
+	for(size_t n=0;n<5000;n++)
+		ids.push_back(table.intern("name"+std::to_string(n)));
+	for(size_t n=0;n<5000;n+=2)
+		table.release(ids[n]);
+	for(size_t n=1;n<5000;n+=2){
+		ASSERT_EQUAL(table.intern("name"+std::to_string(n)),ids[n]);
+		ASSERT(table.get(ids[n])=="name"+std::to_string(n));
+	}
+	ASSERT_EQUAL(table.size(),size_t(2501));
+});
+
+Test intern_symbols_freed("intern_symbols_freed",[](){
+	Expr kept("zq_kept+1");
+	size_t before = live_symbol_names();
+	{
+		Expr ex("zq_a*zq_b+zq_a");
+		Expr copy = ex;
+		ConsExpr consed = ex;
+		Expr moved = std::move(copy);
+		moved = moved[0];
+		ASSERT_EQUAL(live_symbol_names(),before+2);
+		ASSERT_EQUAL(consed.expr(),ex);
+	}
+	ASSERT_EQUAL(live_symbol_names(),before);
+	ASSERT_EQUAL(kept,Expr("zq_kept+1"));
+
+	for(size_t n=0;n<1000;n++)
+		Symbol("zq_"+std::to_string(n));
+	ASSERT_EQUAL(live_symbol_names(),before);
+});
+
+Test intern_concurrent("intern_concurrent",[](){
+	// threads intern, check and release overlapping names, so entries are freed and revived under each other
+	InternTable table;
+	std::atomic<bool> ok = true;
+	std::vector<std::thread> threads;
+	for(size_t t=0;t<8;t++){
+		threads.emplace_back([&table,&ok,t](){
+			for(size_t round=0;round<200;round++){
+				std::vector<std::pair<InternTable::id_t,string>> held;
+				for(size_t n=0;n<50;n++){
+					string name = "s"+std::to_string((n*7+t+round)%120);
+					held.emplace_back(table.intern(name),name);
+				}
+				for(const auto& [id,name] : held){
+					if(table.get(id)!=name)
+						ok = false;
+					table.release(id);
+				}
+			}
+		});
+	}
+	for(std::thread& thread : threads)
+		thread.join();
+	ASSERT(ok);
+	ASSERT_EQUAL(table.size(),size_t(1));
+},10);
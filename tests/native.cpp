@@ -0,0 +1,70 @@
+#include "tests.hpp"
+#include "NativeProgram.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+
+// points the native cache at a fresh directory for as long as it lives, so nothing built by an earlier
+// run (or test) gets loaded
+struct TempNativeCache{
+	string path;
+	TempNativeCache(){
+		string pattern = (std::filesystem::temp_directory_path()/"symbolic_test_native_XXXXXX").string();
+		ASSERT(mkdtemp(pattern.data())!=nullptr);
+		path = pattern;
+		setenv("SYMBOLIC_CACHE_DIR",path.c_str(),1);
+	}
+	~TempNativeCache(){
+		unsetenv("SYMBOLIC_CACHE_DIR");
+		std::filesystem::remove_all(path);
+	}
+};
+
+// compiling takes a while, hence the long timeout
+Test native_matches_program("native_matches_program",[](){
+	TempNativeCache cache;
+	Expr ex("x^2+3*x*y-y/(x-1)+2^y-x*y*-y+1.5");
+	NativeProgram native(ex,{"x","y"});
+	ASSERT(native.is_native());
+	const Program& program = native.program();
+	for(float_value_t x : {-2.0,0.0,0.5,1.0,3.25}){
+		for(float_value_t y : {-1.0,0.0,2.0}){
+			float_value_t row[] = {x,y};
+			std::optional<float_value_t> expected = program(row);
+			std::optional<float_value_t> actual = native(row);
+			ASSERT_EQUAL(actual.has_value(),expected.has_value());
+			if(expected.has_value()){
+				ASSERT_EQUAL(Float(*actual),Float(*expected));
+			}
+		}
+	}
+},60);
+
+Test native_fallback("native_fallback",[](){
+	TempNativeCache cache;
+	// a different formula each run, since one that compiled is kept in memory
+	static float_value_t run = 0;
+	run += 1;
+	Expr ex = Add(Expr("a*b-a/b"),Float(run));
+	setenv("SYMBOLIC_CXX","/nonexistent/compiler",1);
+	NativeProgram native(ex,{"a","b"});
+	unsetenv("SYMBOLIC_CXX");
+	ASSERT(!native.is_native());
+	float_value_t row[] = {3,0};
+	ASSERT(!native(row).has_value());
+	float_value_t row2[] = {3,2};
+	ASSERT_EQUAL(Float(*native(row2)),Float(3*2.0-3/2.0+run));
+	// the failure isn't remembered
+	ASSERT(NativeProgram(ex,{"a","b"}).is_native());
+},60);
+
+Test native_private_cache("native_private_cache",[](){
+	// a cache others can write to is never used
+	TempNativeCache cache;
+	std::filesystem::permissions(cache.path,std::filesystem::perms::all);
+	NativeProgram native(Expr("a-b*0.375+b^3"),{"a","b"});
+	ASSERT(!native.is_native());
+	ASSERT(!std::filesystem::exists(cache.path+"/native"));
+	float_value_t row[] = {1,2};
+	ASSERT_EQUAL(Float(*native(row)),Float(1-2*0.375+8));
+});
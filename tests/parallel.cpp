@@ -0,0 +1,79 @@
+#include "tests.hpp"
+#include "actions.hpp"
+#include "ThreadPool.hpp"
+#include "Arena.hpp"
+
+// sum of count products, each with a foldable part and a symbolic part
+static Expr wide_expr(size_t count){
+	Expr sum = Add();
+	for(size_t n=0;n<count;n++){
+		Expr term = Mul(Integer(n%7+1),Add(Integer(n%5),Integer(3)),Symbol("x"+to_string(n%11)));
+		if(n%3==0)
+			term = Div(term,Pow(Integer(2),Sub(Integer(n%4),Integer(1))));
+		sum.add_child(term);
+	}
+	return sum;
+}
+
+Test parallel_perform_same("parallel_perform_same",[](){
+	size_t grain = parallel_grain;
+	parallel_grain = 8;
+	Expr ex = wide_expr(3000);
+	ASSERT_EQUAL(parallel_perform(ex),perform(ex));
+	ASSERT_EQUAL(parallel_perform_approx(ex),perform_approx(ex));
+	// nested: forks at more than one level
+	Expr nested = Mul(Add(wide_expr(500),wide_expr(700)),Sub(wide_expr(900),Neg(wide_expr(400))));
+	ASSERT_EQUAL(parallel_perform(nested),perform(nested));
+	parallel_grain = grain;
+},30);
+
+Test thread_pool_nested("thread_pool_nested",[](){
+	ThreadPool pool(4);
+	std::atomic<size_t> total = 0;
+	ThreadPool::TaskGroup outer(pool);
+	for(size_t n=0;n<16;n++){
+		outer.run([&](){
+			ThreadPool::TaskGroup inner(pool);
+			for(size_t k=0;k<16;k++)
+				inner.run([&](){ total++; });
+			inner.wait();
+		});
+	}
+	outer.wait();
+	ASSERT_EQUAL(total.load(),size_t(256));
+},10);
+
+Test thread_pool_wait_arena("thread_pool_wait_arena",[](){
+	// a thread waiting on one group can end up running another's task, which mustn't build in the
+	// waiting thread's Arena
+	ThreadPool pool(1);
+	// the only worker is kept busy, so the other tasks are left to this thread
+	std::atomic<bool> started = false, release = false;
+	ThreadPool::TaskGroup blocker(pool);
+	blocker.run([&](){
+		started = true;
+		while(!release)
+			std::this_thread::yield();
+	});
+	while(!started)
+		std::this_thread::yield();
+	std::atomic<bool> ran = false;
+	std::atomic<Arena*> seen = nullptr;
+	ThreadPool::TaskGroup other(pool);
+	other.run([&](){
+		seen = Arena::current();
+		ran = true;
+	});
+	{
+		Arena arena;
+		Arena::Scope arena_scope(arena);
+		ThreadPool::TaskGroup mine(pool);
+		mine.run([&](){ release = true; });
+		mine.wait();
+		ASSERT(Arena::current()==&arena);
+	}
+	other.wait();
+	blocker.wait();
+	ASSERT(ran);
+	ASSERT(seen.load()==nullptr);
+});
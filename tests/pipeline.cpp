@@ -0,0 +1,99 @@
+#include "tests.hpp"
+#include "Pipeline.hpp"
+#include "Profiler.hpp"
+
+// names without digits, since those couldn't be referenced
+static string name_of(size_t n){
+	string ret = "v";
+	do{
+		ret += char('a'+n%26);
+		n /= 26;
+	}while(n>0);
+	return ret;
+}
+
+Test pipeline_matches_session("pipeline_matches_session",[](){
+	// every line references earlier ones, so applying them out of order would show
+	string input;
+	for(size_t n=0;n<400;n++){
+		if(n==0)
+			input += name_of(n)+": x\n";
+		else if(n%50==7)
+			input += "$show "+name_of(n-1)+"\n";
+		else
+			input += name_of(n)+": "+name_of(n-1)+"+"+std::to_string(n)+"\n";
+	}
+
+	Session serial;
+	string expected;
+	std::istringstream lines(input);
+	string line;
+	while(std::getline(lines,line)){
+		serial.consume_line(line);
+		expected += serial.output.str();
+		serial.output.str("");
+	}
+
+	Session session;
+	Pipeline pipeline(session,4,8);
+	pipeline.perform = false;
+	std::istringstream in(input);
+	std::ostringstream out,err;
+	size_t errors = pipeline.run(in,out,err);
+	ASSERT_EQUAL(errors,size_t(0));
+	ASSERT(out.str()==expected);
+	ASSERT(err.str()==string(""));
+},10);
+
+Test pipeline_perform("pipeline_perform",[](){
+	Session session;
+	Pipeline pipeline(session,2,2);
+	std::istringstream in("x: 2+3\ny: x*a\n\n$echo off\nz: y\n$show z\n");
+	std::ostringstream out,err;
+	size_t errors = pipeline.run(in,out,err);
+	ASSERT_EQUAL(errors,size_t(0));
+	ASSERT(out.str()==string("x:\t5\ny:\ta*5\nz:\t(2 + 3)*a\n"));
+	// only what's echoed is performed; the workspace (and $show) keeps the values as declared
+	ASSERT_EQUAL(session.workspace["x"],Expr("2+3"));
+});
+
+Test pipeline_errors("pipeline_errors",[](){
+	Session session;
+	Pipeline pipeline(session,3,2);
+	std::istringstream in("a: 1\nb: (\n$nope\nc: a+1\nnonsense\na: c\nd: 1/0\n");
+	std::ostringstream out,err;
+	size_t errors = pipeline.run(in,out,err,"in");
+	ASSERT_EQUAL(errors,size_t(4));
+	ASSERT(out.str()==string("a:\t1\nc:\t2\nd:\t"+to_string(Undefined())+"\n"));
+	string reported = err.str();
+	// reported in input order, each with its line number
+	size_t b = reported.find("in:2: ");
+	size_t nope = reported.find("in:3: CommandError: Unknown command: nope");
+	size_t nonsense = reported.find("in:5: CommandError: Not a declaration or a command");
+	size_t cycle = reported.find("in:6: WorkspaceError: Defining 'a' would make a cycle");
+	ASSERT(b!=string::npos && nope!=string::npos && nonsense!=string::npos && cycle!=string::npos);
+	ASSERT(b<nope && nope<nonsense && nonsense<cycle);
+	// the lines after a failed one still ran
+	ASSERT_EQUAL(session.workspace["c"],Expr("1+1"));
+});
+
+#ifndef SYMBOLIC_NO_PROFILE
+
+Test pipeline_command_order("pipeline_command_order",[](){
+	// a command applies to exactly the lines after it, however far ahead the workers could get
+	Profiler::reset();
+	Session session;
+	Pipeline pipeline(session,8,8);
+	std::istringstream in("$profile on\nu: a+b*c+d*e*f+g^h\n$profile off\nv: x+y\nw: v*2\n$profile show\n");
+	std::ostringstream out,err;
+	size_t errors = pipeline.run(in,out,err);
+	ASSERT_EQUAL(errors,size_t(0));
+	ASSERT_EQUAL(Profiler::get(Profiler::PARSE,nullptr).calls,uint64_t(1));
+	ASSERT_EQUAL(Profiler::get(Profiler::PERFORM,nullptr).calls,uint64_t(1));
+	ASSERT_EQUAL(Profiler::get(Profiler::PRINT,nullptr).calls,uint64_t(1));
+	// and its output comes after theirs
+	ASSERT(out.str().find("w:\t")<out.str().find("(profiling is off)"));
+	Profiler::reset();
+});
+
+#endif
@@ -0,0 +1,74 @@
+#include "tests.hpp"
+#include "Polynomial.hpp"
+#include "canonical.hpp"
+
+static string expanded(const string& str){
+	return to_string(Polynomial(Expr(str)).to_expr());
+}
+
+Test polynomial_expand("polynomial_expand",[](){
+	ASSERT_EQUAL(expanded("(x+y)^2"),string("x^2 + x*y*2 + y^2"));
+	ASSERT_EQUAL(expanded("(x+1)*(x-1)"),string("x^2 + -1"));
+	ASSERT_EQUAL(expanded("(x+y)*(x-y)+y^2"),string("x^2"));
+	ASSERT_EQUAL(expanded("x/2+x/2-x"),string("0"));
+	ASSERT_EQUAL(expanded("(2*x+1)^3/4"),string("x^3*2 + x^2*3 + x*3/2 + 1/4"));
+	ASSERT(!Polynomial::is_polynomial(Expr("x^y")));
+	ASSERT(!Polynomial::is_polynomial(Expr("x/y")));
+	ASSERT(!Polynomial::is_polynomial(Expr("x^(0-1)")));
+	ASSERT(Polynomial::is_polynomial(Expr("x^0*7")));
+	// non-polynomial parts are kept, with the polynomials inside them expanded
+	ASSERT_EQUAL(to_string(expand(Expr("((x+1)^2)^y"))),string("(x^2 + x*2 + 1)^y"));
+});
+
+Test polynomial_collect("polynomial_collect",[](){
+	Polynomial p(Expr("(x+y+1)^2"));
+	ASSERT_EQUAL(to_string(p.collect("x")),string("x^2 + x*(y*2 + 2) + y^2 + y*2 + 1"));
+	ASSERT_EQUAL(p.coefficient({1,1}),Fraction(2));
+	ASSERT_EQUAL(p.coefficient({0,3}),Fraction(0));
+	ASSERT_EQUAL(to_string(Polynomial(Expr("x*y^2+x*y^2*2")).collect("y")),string("y^2*x*3"));
+});
+
+Test polynomial_product("polynomial_product",[](){
+	// (a+b+c+d+1)^8 has C(12,4) = 495 terms and agrees with the tree-based canonical form
+	Polynomial p(Expr("(a+b+c+d+1)^8"));
+	ASSERT_EQUAL(p.term_count(),size_t(495));
+	ASSERT_EQUAL(p.coefficient({2,2,2,2}),Fraction(2520));
+	ASSERT_EQUAL(canonicalize(Polynomial(Expr("(a-b)*(a+b)")).to_expr()),canonicalize(Expr("a*a-b*b")));
+	ASSERT(Polynomial(Expr("(a+b)^2-(a-b)^2"))==Polynomial(Expr("a*b*4")));
+	// exponents that don't fit the packed fields are an error, not a wrong answer
+	bool threw = false;
+	try{
+		Polynomial(Expr("(x+y)^4294967296"));
+	}
+	catch(const ExprError&){
+		threw = true;
+	}
+	ASSERT(threw);
+},5);
+
+Test polynomial_budget("polynomial_budget",[](){
+	auto too_large = [](const string& str){
+		try{
+			Polynomial(Expr(str));
+		}
+		catch(const ExprError&){
+			return true;
+		}
+		return false;
+	};
+	// too large to expand is an error, which expand turns into leaving the subtree alone; with smaller
+	// budgets, so that working up to them doesn't take long
+	size_t max_products = Polynomial::max_products, max_work = Polynomial::max_work;
+	Polynomial::max_products = size_t(1)<<14;
+	Polynomial::max_work = size_t(1)<<18;
+	bool powers = too_large("(x+1)^1000000") && too_large("(a+b+c+d+e+f+g+h+1)^400");
+	bool coefficients = too_large("(x*123456789012345678901+1)^5000");
+	bool smaller = too_large("(x+1)^1000");
+	string expanded = to_string(expand(Expr("((x+1)^1000000)^z+(y+1)^2")));
+	Polynomial::max_products = max_products;
+	Polynomial::max_work = max_work;
+
+	ASSERT(powers && coefficients && smaller);
+	ASSERT(expanded==string("((x + 1)^1000000)^z + (y^2 + y*2 + 1)"));
+	ASSERT_EQUAL(Polynomial(Expr("(x+1)^100")).term_count(),size_t(101));
+},5);
@@ -0,0 +1,81 @@
+#include "tests.hpp"
+#include "Expr.hpp"
+
+#include <ctime>
+#include <sstream>
+
+// not registered, so its format is compiled on the spot; $2 comes first, and twice
+consteval Type make_backwards(){
+	Type type;
+	type.name = "Backwards";
+	type.print_string = "[$2|${1}|$2]$$";
+	type.arity = Type::INFINITARY;
+	type.pemdas = -1;
+	return type;
+}
+constexpr Type Backwards = make_backwards();
+
+consteval Type make_swapped(){
+	Type type;
+	type.name = "Swapped";
+	type.print_string = "<$2:$1>";
+	type.arity = Type::BINARY;
+	type.pemdas = -1;
+	return type;
+}
+constexpr Type Swapped = make_swapped();
+
+Test printing_parentheses("printing_parentheses",[](){
+	ASSERT(to_string(Expr("a+b*c-(d-e)"))==string("a + b*c - (d - e)"));
+	ASSERT(to_string(Mul(Add(Symbol("a"),Symbol("b")),Neg(Symbol("c"))))==string("(a + b)*-c"));
+	ASSERT(to_string(Pow(Pow(Symbol("a"),Symbol("b")),Symbol("c")))==string("(a^b)^c"));
+	ASSERT(to_string(Expr("f, g, h"))==string("f, g, h"));
+	ASSERT(to_string(Undefined())==string("∅"));
+});
+
+Test printing_formats("printing_formats",[](){
+	Expr ex = Backwards(Symbol("a"),Symbol("b"),Symbol("c"));
+	// applied from the right, as a (b c)
+	ASSERT(to_string(ex)==string("[[c|b|c]$|a|[c|b|c]$]$"));
+	Expr pair = Backwards(Symbol("x"),Add(Symbol("y"),Symbol("z")));
+	ASSERT(to_string(pair)==string("[(y + z)|x|(y + z)]$"));
+	// each unregistered format stays put while the other is printed inside it
+	Expr nested = Backwards(Swapped(Symbol("x"),Symbol("y")),Symbol("z"));
+	ASSERT(to_string(nested)==string("[z|<y:x>|z]$"));
+	ASSERT(to_string(Swapped(nested,Symbol("w")))==string("<w:[z|<y:x>|z]$>"));
+});
+
+Test printing_long("printing_long",[](){
+	// one pass over the output, however many children a node has
+	Expr sum = Add();
+	for(int_value_t n=0;n<50000;n++)
+		sum.add_child(Mul(Symbol("x"),Integer(n)));
+	clock_t start = clock();
+	string printed = to_string(sum);
+	double seconds = double(clock()-start)/CLOCKS_PER_SEC;
+	ASSERT(printed.substr(0,21)==string("x*0 + x*1 + x*2 + x*3"));
+	ASSERT(seconds<0.25);
+},5);
+
+Test printing_limits("printing_limits",[](){
+	Expr ex("a + b*(c + d*(e + f)) + g + h");
+	PrintLimits depth;
+	depth.max_depth = 2;
+	ASSERT(to_string(ex,depth)==string("a + b*(c + …[5 nodes]) + g + h"));
+	PrintLimits width;
+	width.max_width = 2;
+	ASSERT(to_string(ex,width)==string("a + b*(c + d*(e + f)) + …[2 nodes]"));
+	PrintLimits bytes;
+	bytes.max_bytes = 5;
+	ASSERT(to_string(ex,bytes)==string("a + b*…[7 nodes] + …[2 nodes]"));
+	// unlimited is the same as to_string
+	ASSERT(to_string(ex,PrintLimits())==to_string(ex));
+
+	// streamed in pieces, the same text comes out
+	Expr sum = Add();
+	for(int_value_t n=0;n<5000;n++)
+		sum.add_child(Mul(Symbol("x"),Integer(n)));
+	std::ostringstream streamed;
+	print(streamed,sum,PrintLimits());
+	ASSERT(streamed.str()==to_string(sum));
+});
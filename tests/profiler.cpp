@@ -0,0 +1,65 @@
+#include "tests.hpp"
+#include "Profiler.hpp"
+#include "actions.hpp"
+
+#include <sstream>
+
+// nothing is counted when profiling is compiled out
+#ifndef SYMBOLIC_NO_PROFILE
+
+Test profiler_counts("profiler_counts",[](){
+	Profiler::reset();
+	Profiler::set(true);
+	Expr ex("1 + 2*3 + x");
+	Expr result = perform(ex);
+	string printed = to_string(result);
+	Profiler::set(false);
+
+	Profiler::Counters parse = Profiler::get(Profiler::PARSE,nullptr);
+	ASSERT_EQUAL(parse.calls,uint64_t(1));
+	ASSERT_EQUAL(parse.nodes,uint64_t(6));
+	ASSERT(parse.allocations>=2);
+	ASSERT_EQUAL(Profiler::get(Profiler::PARSE,&Integer).calls,uint64_t(3));
+
+	ASSERT_EQUAL(Profiler::get(Profiler::PERFORM,nullptr).nodes,uint64_t(6));
+	ASSERT_EQUAL(Profiler::get(Profiler::PERFORM,&Mul).calls,uint64_t(1));
+	ASSERT_EQUAL(Profiler::get(Profiler::PERFORM,&Integer).calls,uint64_t(3));
+
+	// printed x + 7 (or 7 + x)
+	ASSERT_EQUAL(Profiler::get(Profiler::PRINT,nullptr).calls,uint64_t(1));
+	ASSERT_EQUAL(Profiler::get(Profiler::PRINT,&Add).nodes,uint64_t(1));
+	ASSERT_EQUAL(Profiler::get(Profiler::PRINT,&Integer).nodes,uint64_t(1));
+
+	std::ostringstream report;
+	Profiler::report(report);
+	ASSERT(report.str().find("perform: 1 calls, 6 nodes")!=string::npos);
+
+	// nothing counts while off
+	to_string(Expr("a + b"));
+	ASSERT_EQUAL(Profiler::get(Profiler::PARSE,nullptr).calls,uint64_t(1));
+	Profiler::reset();
+	ASSERT_EQUAL(Profiler::get(Profiler::PERFORM,&Mul).calls,uint64_t(0));
+});
+
+Test profiler_nested("profiler_nested",[](){
+	// every node is counted once, under its own type
+	Profiler::reset();
+	Profiler::set(true);
+	Expr sum = Add();
+	for(int_value_t n=0;n<2000;n++)
+		sum.add_child(Mul(Symbol("x"),Integer(n)));
+	Expr result = perform(sum);
+	Profiler::set(false);
+
+	uint64_t typed = 0;
+	for(const Type* type : std::initializer_list<const Type*>{&Add,&Mul,&Symbol,&Integer})
+		typed += Profiler::get(Profiler::PERFORM,type).nodes;
+	Profiler::Counters whole = Profiler::get(Profiler::PERFORM,nullptr);
+	ASSERT_EQUAL(whole.calls,uint64_t(1));
+	ASSERT_EQUAL(whole.nodes,uint64_t(6001));
+	ASSERT_EQUAL(Profiler::get(Profiler::PERFORM,&Mul).calls,uint64_t(2000));
+	ASSERT_EQUAL(typed,uint64_t(6001));
+	Profiler::reset();
+});
+
+#endif
@@ -0,0 +1,81 @@
+#include "tests.hpp"
+#include "Program.hpp"
+#include "actions.hpp"
+#include <cmath>
+
+// evaluates through perform_approx, with the given symbols replaced by Floats
+static Expr approx_with(Expr ex, const std::vector<string>& symbols, const std::vector<float_value_t>& values){
+	if(ex.type()==Symbol){
+		for(size_t n=0;n<symbols.size();n++){
+			if(Symbol.value(ex)==symbols[n])
+				return Float(values[n]);
+		}
+	}
+	for(Expr& child : ex)
+		child = approx_with(child,symbols,values);
+	return perform_approx(ex);
+}
+
+static void check_program(const string& str, const std::vector<float_value_t>& values){
+	Expr ex(str);
+	Program program(ex);
+	ASSERT_EQUAL(program.symbols().size(),values.size());
+	Expr expected = approx_with(ex,program.symbols(),values);
+	std::optional<float_value_t> actual = program(values.data());
+	if(expected.type()==Float){
+		ASSERT(actual.has_value());
+		ASSERT_EQUAL(Float(*actual),expected);
+	}
+	else{
+		ASSERT(!actual.has_value());
+	}
+}
+
+Test program_arith("program_arith",[](){
+	check_program("a+b*c-d/2",{1.5,2,3,4});
+	check_program("-a^2+3*a*b-b/a",{0.5,7});
+	check_program("a-b-c+2^a",{3,1,0.25});
+});
+
+Test program_undefined("program_undefined",[](){
+	check_program("a/(b-b)",{1,2});
+	check_program("a^b",{-2,2});
+	check_program("1+(a/0)*b",{1,2});
+	check_program("a^b",{2,-0.5});
+});
+
+Test program_batch("program_batch",[](){
+	Program program(Expr("x/y"),{"x","y"});
+	std::vector<float_value_t> rows{1,2, 3,0, 5,4};
+	float_value_t out[3];
+	bool defined[3];
+	program(rows.data(),3,out,defined);
+	ASSERT(defined[0] && !defined[1] && defined[2]);
+	ASSERT_EQUAL(Float(out[0]),Float(0.5));
+	ASSERT_EQUAL(Float(out[2]),Float(1.25));
+});
+
+Test program_columns("program_columns",[](){
+	Program program(Expr("x^2+3*x*y-y/(x-1)+2^y-x*y*-y+(x*y*2)"),{"x","y"});
+	// long enough for several blocks plus a ragged tail; includes zero divisors and negative bases
+	const size_t rows = program.block_rows()*3+7;
+	std::vector<float_value_t> x(rows),y(rows),out(rows);
+	std::vector<uint8_t> undefined(rows);
+	for(size_t n=0;n<rows;n++){
+		x[n] = (n%17)*0.25;
+		y[n] = (n%5)-2.0;
+	}
+	const float_value_t* columns[] = {x.data(),y.data()};
+	program.evaluate_columns(columns,rows,out.data(),undefined.data());
+	for(size_t n=0;n<rows;n++){
+		float_value_t row[] = {x[n],y[n]};
+		std::optional<float_value_t> expected = program(row);
+		ASSERT_EQUAL(undefined[n]==0,expected.has_value());
+		if(expected.has_value()){
+			ASSERT_EQUAL(Float(out[n]),Float(*expected));
+		}
+		else{
+			ASSERT(std::isnan(out[n]));
+		}
+	}
+});
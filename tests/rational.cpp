@@ -0,0 +1,58 @@
+#include "tests.hpp"
+#include "Expr.hpp"
+#include "actions.hpp"
+
+static string performed(const string& str){
+	return to_string(perform(Expr(str)));
+}
+
+Test rational_fold("rational_fold",[](){
+	ASSERT_EQUAL(performed("1/3+1/6"),string("1/2"));
+	ASSERT_EQUAL(perform(Expr("1/3+1/6")).type(),Rational);
+	ASSERT_EQUAL(perform(Expr("1/3*3")),Integer(1));
+	ASSERT_EQUAL(performed("-2/6"),string("-1/3"));
+	ASSERT_EQUAL(performed("2/(0-6)"),string("-1/3"));
+	ASSERT_EQUAL(performed("1/2-2/3"),string("-1/6"));
+	ASSERT_EQUAL(performed("(1/2)/(3/4)"),string("2/3"));
+	ASSERT_EQUAL(performed("(2/3)^(0-2)"),string("9/4"));
+	ASSERT_EQUAL(performed("2^(0-3)"),string("1/8"));
+	ASSERT_EQUAL(perform(Expr("0^(0-1)")),Undefined());
+	ASSERT_EQUAL(perform(Expr("(1/3)/0")),Undefined());
+	// rational exponents aren't folded
+	ASSERT_EQUAL(perform(Expr("4^(1/2)")).type(),Pow);
+	// folds past the int64 fast path
+	ASSERT_EQUAL(performed("(1/2)^70"),string("1/1180591620717411303424"));
+	ASSERT_EQUAL(performed("1/4294967296*1/4294967296*18446744073709551616"),string("1"));
+});
+
+Test rational_harmonic("rational_harmonic",[](){
+	Expr sum = Add();
+	for(int_value_t k=1;k<=20;k++)
+		sum.add_child(Div(Integer(1),Integer(k)));
+	ASSERT_EQUAL(to_string(perform(sum)),string("55835135/15519504"));
+	ASSERT_EQUAL(perform(Add(sum,Symbol("x"))).child_count(),2UL);
+	ASSERT_EQUAL(perform_approx(Expr("1/4")),Float(0.25));
+});
+
+Test rational_print("rational_print",[](){
+	// printed Rationals read back as a Div that performs to the same value
+	for(const string str : {"x*(1/3)","(1/3)^x","x^(1/3)","-(2/7)","x/(3/5)"}){
+		Expr ex = perform(Expr(str));
+		ASSERT_EQUAL(perform(Expr(to_string(ex))),ex);
+	}
+});
+
+Test rational_freed("rational_freed",[](){
+	Expr kept = perform(Expr("1/3"));
+	size_t before = live_rationals();
+	{
+		Expr sum = Add();
+		for(int_value_t k=1;k<=200;k++)
+			sum.add_child(Div(Integer(1),Integer(k)));
+		Expr result = perform(sum);
+		ASSERT_EQUAL(result.type(),Rational);
+		ASSERT(live_rationals()>before);
+	}
+	ASSERT_EQUAL(live_rationals(),before);
+	ASSERT_EQUAL(kept,perform(Expr("1/3")));
+});
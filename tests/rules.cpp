@@ -0,0 +1,73 @@
+#include "tests.hpp"
+#include "RuleSet.hpp"
+#include "Session.hpp"
+
+Test rule_match("rule_match",[](){
+	Bindings bindings;
+	Rule square(Expr("x_*x_"),Expr("x_^2"));
+	ASSERT(square.match(Expr("(a+b)*(a+b)"),bindings));
+	ASSERT_EQUAL(bindings.size(),size_t(1));
+	ASSERT_EQUAL(bindings[0].second,Expr("a+b"));
+	bindings.clear();
+	ASSERT(!square.match(Expr("a*b"),bindings));
+	ASSERT(bindings.empty());
+
+	// children of commutative types match in any order, backtracking through the bindings
+	Rule factor(Expr("x_*y_+x_*z_"),Expr("x_*(y_+z_)"));
+	ASSERT_EQUAL(factor(Expr("a*b+c*a")),Expr("a*(b+c)"));
+	ASSERT_EQUAL(Rule(Expr("x_-0"),Expr("x_"))(Expr("0-a")),Expr("0-a"));
+	ASSERT_EQUAL(Rule(Expr("x_*x_"),Expr("x_^2"))(Expr("b*b-c")),Expr("b^2-c"));
+	ASSERT_EQUAL(Rule(Expr("x_*0"),Expr("0"))(Expr("b+0*(a+c)")),Expr("b+0"));
+
+	bool threw = false;
+	try{
+		Rule(Expr("x_+1"),Expr("y_"));
+	}
+	catch(const ExprError&){
+		threw = true;
+	}
+	ASSERT(threw);
+});
+
+Test rule_rewrite("rule_rewrite",[](){
+	RuleSet rules;
+	rules.add(Rule(Expr("x_+0"),Expr("x_")));
+	rules.add(Rule(Expr("x_*1"),Expr("x_")));
+	rules.add(Rule(Expr("x_^1"),Expr("x_")));
+	// rewritten bottom up, pass after pass until nothing matches
+	ASSERT_EQUAL(rules(Expr("((a*1+0)^1)*1+0")),Expr("a"));
+	ASSERT_EQUAL(rules(Expr("a^(1*1)+0")),Expr("a"));
+	ASSERT_EQUAL(rules(Expr("a-0")),Expr("a-0"));
+	// the first rule added wins
+	rules.add(Rule(Expr("0+x_"),Expr("zero")));
+	ASSERT_EQUAL(rules(Expr("0+b")),Expr("b"));
+});
+
+Test rule_index("rule_index",[](){
+	// with many rules, each node is only matched against the few that could apply
+	const int_value_t count = 10000;
+	RuleSet rules;
+	for(int_value_t k=2;k<count+2;k++)
+		rules.add(Rule(Pow(Symbol("x_"),Integer(k)),Mul(Symbol("x_"),Integer(k))));
+	rules.add(Rule(Expr("x_+x_"),Expr("x_*2")));
+	ASSERT_EQUAL(rules.size(),size_t(count+1));
+	ASSERT_EQUAL(rules.candidates(Expr("a^5")).size(),size_t(1));
+	ASSERT_EQUAL(rules.candidates(Expr("a^1")).size(),size_t(0));
+	ASSERT_EQUAL(rules.candidates(Expr("a+b")).size(),size_t(1));
+
+	Expr sum = Add();
+	Expr expected = Add();
+	for(int_value_t n=0;n<2000;n++){
+		sum.add_child(Pow(Symbol("s"),Integer(2+n*5)));
+		expected.add_child(Mul(Symbol("s"),Integer(2+n*5)));
+	}
+	ASSERT_EQUAL(rules(sum),expected);
+},5);
+
+Test rewrite_keeps_rules("rewrite_keeps_rules",[](){
+	// $rewrite is redone when a changes, but with the rules there were when it ran
+	Session session;
+	for(const char* line : {"a: 1","e: x*0+a","$rule x_*0 -> 0","$rewrite e","$rule 0+y_ -> y_","a: 2"})
+		session.consume_line(line);
+	ASSERT_EQUAL(session.workspace["e"],Add(Integer(0),Integer(2)));
+});
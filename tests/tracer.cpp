@@ -0,0 +1,57 @@
+#include "tests.hpp"
+#include "Tracer.hpp"
+#include "Session.hpp"
+#include "actions.hpp"
+
+#include <sstream>
+
+// nothing is recorded when tracing is compiled out
+#ifndef SYMBOLIC_NO_PROFILE
+
+Test tracer_spans("tracer_spans",[](){
+	Session session;
+	Tracer::start();
+	session.consume_line("a: 1 + 2*x");
+	Expr result = perform(session.workspace["a"]);
+	Tracer::stop();
+	size_t count = Tracer::event_count();
+	// the line, its parse and print, and the perform
+	ASSERT(count>=4);
+
+	std::ostringstream out;
+	Tracer::write(out);
+	string json = out.str();
+	ASSERT(json.starts_with("{\"displayTimeUnit\""));
+	ASSERT(json.find("\"name\":\"line\"")!=string::npos);
+	ASSERT(json.find("\"text\":\"a: 1 + 2*x\"")!=string::npos);
+	ASSERT(json.find("\"name\":\"parse\"")!=string::npos);
+	ASSERT(json.find("\"name\":\"perform\"")!=string::npos);
+	ASSERT(json.find("\"ph\":\"X\"")!=string::npos);
+
+	// nothing more while off, and start throws the old spans away
+	Expr("b + c");
+	ASSERT_EQUAL(Tracer::event_count(),count);
+	Tracer::start();
+	Tracer::stop();
+	ASSERT_EQUAL(Tracer::event_count(),size_t(0));
+});
+
+Test tracer_threads("tracer_threads",[](){
+	// spans on other threads are collected too, and text is cut without splitting a character
+	Tracer::start();
+	std::thread other([](){
+		Tracer::set_thread_name("other");
+		Tracer::Span span("elsewhere");
+		span.set_text(string(46,'x')+"ééé");
+	});
+	other.join();
+	Tracer::stop();
+	std::ostringstream out;
+	Tracer::write(out);
+	string json = out.str();
+	ASSERT(json.find("\"name\":\"other\"")!=string::npos);
+	ASSERT(json.find("\"text\":\""+string(46,'x')+"\"")!=string::npos);
+	ASSERT_EQUAL(Tracer::dropped_count(),size_t(0));
+});
+
+#endif
@@ -0,0 +1,81 @@
+#include "tests.hpp"
+#include "Workspace.hpp"
+
+Test workspace_references("workspace_references",[](){
+	Workspace ws;
+	ws.define("y",Expr("x+1"));
+	// x isn't defined yet, so it's just a Symbol
+	ASSERT_EQUAL(ws["y"],Expr("x+1"));
+	ASSERT(ws.define("x",Expr("a*b"))==std::vector<string>({"y"}));
+	ASSERT_EQUAL(ws["y"],Expr("a*b+1"));
+	ASSERT_EQUAL(ws.definition("y"),Expr("x+1"));
+
+	ws.define("z",Expr("y*y"));
+	ws.define("w",Expr("2"));
+	// only what depends on x is recomputed, everything after what it depends on
+	ASSERT(ws.define("x",Expr("c"))==std::vector<string>({"y","z"}));
+	ASSERT_EQUAL(ws["z"],Expr("(c+1)*(c+1)"));
+	ASSERT(ws.define("w",Expr("3"))==std::vector<string>());
+
+	ASSERT(ws.erase("x")==std::vector<string>({"y","z"}));
+	ASSERT_EQUAL(ws["z"],Expr("(x+1)*(x+1)"));
+	ASSERT(!ws.contains("x"));
+});
+
+Test workspace_order("workspace_order",[](){
+	// d depends on b and c, and c depends on b, so c must be recomputed before d
+	Workspace ws;
+	ws.define("b",Expr("a"));
+	ws.define("c",Expr("b+1"));
+	ws.define("d",Expr("b+c"));
+	ws.define("e",Expr("d*c"));
+	ASSERT(ws.define("a",Expr("1"))==std::vector<string>({"b","c","d","e"}));
+	ASSERT_EQUAL(ws["e"],Mul(Add(Integer(1),Expr("1+1")),Expr("1+1")));
+});
+
+Test workspace_cycles("workspace_cycles",[](){
+	Workspace ws;
+	ws.define("y",Expr("x+1"));
+	ws.define("z",Expr("y*2"));
+	bool threw = false;
+	try{
+		ws.define("x",Expr("z-1"));
+	}
+	catch(const WorkspaceError& err){
+		threw = true;
+		ASSERT_EQUAL(string(err.what()),string("Defining 'x' would make a cycle of references: x -> z -> y -> x"));
+	}
+	ASSERT(threw);
+	// nothing changed
+	ASSERT(!ws.contains("x"));
+	ASSERT_EQUAL(ws["z"],Expr("(x+1)*2"));
+
+	threw = false;
+	try{
+		ws.define("y",Expr("y+1"));
+	}
+	catch(const WorkspaceError&){
+		threw = true;
+	}
+	ASSERT(threw);
+	ASSERT_EQUAL(ws["y"],Expr("x+1"));
+});
+
+Test workspace_transforms("workspace_transforms",[](){
+	Workspace ws;
+	ws.define("x",Expr("2"));
+	ws.define("y",Expr("(x+a)^2"));
+	ws.define("z",Expr("y+1"));
+	auto square = [](const Expr& value){ return Mul(value,value); };
+	ASSERT(ws.transform("y",square)==std::vector<string>({"z"}));
+	ASSERT_EQUAL(ws["y"],Expr("((2+a)^2)*((2+a)^2)"));
+	ASSERT_EQUAL(ws.definition("y"),Expr("(x+a)^2"));
+	// redefining what y references redoes its transforms
+	ASSERT(ws.define("x",Expr("5"))==std::vector<string>({"y","z"}));
+	ASSERT_EQUAL(ws["y"],Expr("((5+a)^2)*((5+a)^2)"));
+	ASSERT_EQUAL(ws["z"],Add(ws["y"],Integer(1)));
+	// and redefining y drops them
+	ws.define("y",Expr("x"));
+	ASSERT(!ws.has_transforms("y"));
+	ASSERT_EQUAL(ws["z"],Expr("5+1"));
+});
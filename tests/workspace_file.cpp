@@ -0,0 +1,96 @@
+#include "tests.hpp"
+#include "WorkspaceFile.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// with the pid, so runs at the same time don't use each other's files
+static string temp_path(const string& name){
+	return (std::filesystem::temp_directory_path()/("symbolic_test_"+name+"_"+std::to_string(getpid()))).string();
+}
+
+Test workspace_file_roundtrip("workspace_file_roundtrip",[](){
+	Workspace ws;
+	ws.define("z",Expr("y*2"));
+	ws.define("y",Expr("x^2-1/3"));
+	ws.define("x",Expr("a+2.5"));
+	ws.define("big",Expr("123456789012345678901234567890*q"));
+	ws.define("flag",Expr("maybe"));
+	string path = temp_path("roundtrip");
+	std::filesystem::remove(path);
+	WorkspaceFile::save(ws,path);
+	// a new file gets the mode creating it would, and saving over one keeps its mode
+	struct stat st;
+	mode_t mask = umask(0);
+	umask(mask);
+	ASSERT(stat(path.c_str(),&st)==0 && (st.st_mode&0777)==(0666&~mask));
+	ASSERT(chmod(path.c_str(),0640)==0);
+	WorkspaceFile::save(ws,path);
+	ASSERT(stat(path.c_str(),&st)==0 && (st.st_mode&0777)==0640);
+
+	Workspace loaded;
+	WorkspaceFile file(path);
+	ASSERT_EQUAL(file.entry_count(),size_t(5));
+	// references are saved before what references them
+	ASSERT_EQUAL(string(file.name(3)),string("y"));
+	ASSERT_EQUAL(string(file.name(4)),string("z"));
+	ASSERT_EQUAL(file.type(file.root(4)),Mul);
+	file.load_into(loaded);
+	for(const auto& [name,value] : ws){
+		ASSERT_EQUAL(loaded.definition(name),ws.definition(name));
+		ASSERT_EQUAL(loaded[name],value);
+	}
+	std::filesystem::remove(path);
+});
+
+Test workspace_file_invalid("workspace_file_invalid",[](){
+	Workspace ws;
+	ws.define("x",Expr("a*(b+c)"));
+	string path = temp_path("invalid");
+	WorkspaceFile::save(ws,path);
+	std::filesystem::resize_file(path,std::filesystem::file_size(path)-8);
+	bool threw = false;
+	try{
+		WorkspaceFile file(path);
+	}
+	catch(const WorkspaceFileError&){
+		threw = true;
+	}
+	ASSERT(threw);
+
+	std::ofstream(path,std::ios::trunc)<<"x: a*(b+c)\n";
+	threw = false;
+	try{
+		WorkspaceFile file(path);
+	}
+	catch(const WorkspaceFileError&){
+		threw = true;
+	}
+	ASSERT(threw);
+	std::filesystem::remove(path);
+});
+
+Test workspace_file_many("workspace_file_many",[](){
+	// loading skips the parser entirely; how much faster that is is measured by symbolic_bench
+	// (workspace_load against parse), and here only that it gives back the same exprs
+	std::vector<string> lines;
+	Workspace ws;
+	for(int n=0;n<200;n++){
+		string text = "x*"+std::to_string(n)+"*(y+"+std::to_string(n)+")^2-z/"+std::to_string(n+1)+"+w*(a-b)";
+		lines.push_back(text);
+		ws.define("e"+std::to_string(n),Expr(text));
+	}
+	string path = temp_path("many");
+	WorkspaceFile::save(ws,path);
+
+	WorkspaceFile file(path);
+	ASSERT_EQUAL(file.entry_count(),lines.size());
+	for(size_t n=0;n<file.entry_count();n++){
+		Expr loaded = file.to_expr(file.root(n));
+		ASSERT_EQUAL(ws.definition(string(file.name(n))),loaded);
+	}
+	std::filesystem::remove(path);
+},20);